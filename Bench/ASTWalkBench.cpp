@@ -0,0 +1,158 @@
+/*
+	AST traversal benchmark
+	walks the same parsed tree with a Visitor (accept + visit, two virtual calls per node) and with a StackWalker
+	( SAnalyzer/StackWalker.h, the CRTP walker sema and IRgen use: one switch on ASTNode::kind per node, plain calls
+	up to a fixed depth, its own stack past that), both walkers do the same tiny amount of work per node so the
+	difference is the dispatch
+
+	build: g++ -O2 -std=c++17 -pthread Bench/ASTWalkBench.cpp Lexer/?*.cpp Parser/?*.cpp Support/?*.cpp -o astwalkbench
+	run:   ./astwalkbench [file] [repetitions]
+	(pass "-" as the file to use a generated program of about 1M functions)
+*/
+#include "../Lexer/Lexer.h"
+#include "../Lexer/SourceManager.h"
+#include "../Parser/Parser.h"
+#include "../SAnalyzer/Visitor.h"
+#include "../SAnalyzer/StackWalker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// per node work: count it and fold its offset in, so neither walk can be optimized away
+struct WalkResult {
+	uint64_t nodes = 0;
+	uint64_t hash = 0;
+	void touch(ASTNode* node) { nodes++; hash = hash * 31 + node->offset; }
+};
+
+class DynamicWalker : public Visitor {
+public:
+	WalkResult result;
+	void walk(ASTNode* node) { if (node) node->accept(this); }
+	void visit(ProgramNode* node) override { result.touch(node); for (auto* decl : node->declarations) walk(decl); }
+	void visit(BlockNode* node) override { result.touch(node); for (auto* stmt : node->statements) walk(stmt); }
+	void visit(IfStatementNode* node) override { result.touch(node); walk(node->condition); walk(node->thenBranch); walk(node->elseBranch); }
+	void visit(WhileStatementNode* node) override { result.touch(node); walk(node->condition); walk(node->body); }
+	void visit(ReturnStatementNode* node) override { result.touch(node); walk(node->value); }
+	void visit(FunctionDeclNode* node) override { result.touch(node); walk(node->getBody()); }
+	void visit(VarDeclNode* node) override { result.touch(node); walk(node->initializer); }
+	void visit(StructDeclNode* node) override { result.touch(node); }
+	void visit(AssignmentNode* node) override { result.touch(node); walk(node->target); walk(node->value); }
+	void visit(ArrayDeclNode* node) override { result.touch(node); for (auto* init : node->initializers) walk(init); }
+	void visit(ExpressionStatementNode* node) override { result.touch(node); walk(node->expression); }
+	void visit(LiteralNode* node) override { result.touch(node); }
+	void visit(BinaryOpNode* node) override { result.touch(node); walk(node->left); walk(node->right); }
+	void visit(UnaryOpNode* node) override { result.touch(node); walk(node->expression); }
+	void visit(VariableExprNode* node) override { result.touch(node); }
+	void visit(ArrayIndexNode* node) override { result.touch(node); walk(node->base); walk(node->index); }
+	void visit(MemberAccessNode* node) override { result.touch(node); walk(node->structExpr); }
+	void visit(FunctionCallNode* node) override { result.touch(node); walk(node->callee); for (auto* arg : node->arguments) walk(arg); }
+};
+
+class StackedWalker final : public StackWalker<StackedWalker> {
+	friend class StackWalker<StackedWalker>;
+	// touches the node on its first resume, then hands out its children
+	ASTNode* children(WalkFrame& frame, std::initializer_list<ASTNode*> list) {
+		if (frame.step == 0) result.touch(frame.node);
+		return next(frame, list);
+	}
+	template <typename T>
+	ASTNode* items(WalkFrame& frame, const ArenaVector<T*>& list, uint32_t first = 0) {
+		if (frame.step == 0) result.touch(frame.node);
+		if (frame.step < first) frame.step = first;
+		while (frame.step - first < list.size()) {
+			ASTNode* item = list[frame.step++ - first];
+			if (pending(item)) return item;
+		}
+		return nullptr;
+	}
+	ASTNode* resume(ProgramNode* node, WalkFrame& frame) { return items(frame, node->declarations); }
+	ASTNode* resume(BlockNode* node, WalkFrame& frame) { return items(frame, node->statements); }
+	ASTNode* resume(IfStatementNode* node, WalkFrame& frame) { return children(frame, { node->condition, node->thenBranch, node->elseBranch }); }
+	ASTNode* resume(WhileStatementNode* node, WalkFrame& frame) { return children(frame, { node->condition, node->body }); }
+	ASTNode* resume(ReturnStatementNode* node, WalkFrame& frame) { return children(frame, { node->value }); }
+	ASTNode* resume(FunctionDeclNode* node, WalkFrame& frame) { return children(frame, { node->getBody() }); }
+	ASTNode* resume(VarDeclNode* node, WalkFrame& frame) { return children(frame, { node->initializer }); }
+	ASTNode* resume(StructDeclNode*, WalkFrame& frame) { return children(frame, {}); }
+	ASTNode* resume(AssignmentNode* node, WalkFrame& frame) { return children(frame, { node->target, node->value }); }
+	ASTNode* resume(ArrayDeclNode* node, WalkFrame& frame) { return items(frame, node->initializers); }
+	ASTNode* resume(ExpressionStatementNode* node, WalkFrame& frame) { return children(frame, { node->expression }); }
+	ASTNode* resume(LiteralNode*, WalkFrame& frame) { return children(frame, {}); }
+	ASTNode* resume(BinaryOpNode* node, WalkFrame& frame) { return children(frame, { node->left, node->right }); }
+	ASTNode* resume(UnaryOpNode* node, WalkFrame& frame) { return children(frame, { node->expression }); }
+	ASTNode* resume(VariableExprNode*, WalkFrame& frame) { return children(frame, {}); }
+	ASTNode* resume(ArrayIndexNode* node, WalkFrame& frame) { return children(frame, { node->base, node->index }); }
+	ASTNode* resume(MemberAccessNode* node, WalkFrame& frame) { return children(frame, { node->structExpr }); }
+	ASTNode* resume(FunctionCallNode* node, WalkFrame& frame) {
+		if (frame.step == 0) {
+			result.touch(node);
+			frame.step = 1;
+			if (pending(node->callee)) return node->callee;
+		}
+		return items(frame, node->arguments, 1);
+	}
+public:
+	WalkResult result;
+};
+
+static std::string generateProgram(int functions) {
+	std::string out = "struct Point { int x; int y; };\n";
+	for (int i = 0; i < functions; i++) {
+		std::string n = std::to_string(i);
+		out += "int f" + n + "(int a, int b) { int c = a * " + n + " + b % 7 - (a - b) / 3; Point p; p.x = c;"
+			" while (c < 10 && !(a == b)) { c = c + 1; } if (c == 3 || -a > b) { return f0(c, 2); } return c; }\n";
+	}
+	return out;
+}
+
+template <typename Walk>
+static double best(int reps, Walk walk) {
+	double fastest = 1e30;
+	for (int r = 0; r < reps; r++) {
+		auto t0 = std::chrono::steady_clock::now();
+		walk();
+		auto t1 = std::chrono::steady_clock::now();
+		fastest = std::min(fastest, std::chrono::duration<double>(t1 - t0).count());
+	}
+	return fastest;
+}
+
+int main(int argc, char** argv) {
+	SourceManager sources;
+	std::string generated;
+	FileID file;
+	if (argc > 1 && std::string(argv[1]) != "-") {
+		file = sources.addFile(argv[1]);
+		if (file == InvalidFileID) { std::fprintf(stderr, "cannot open %s\n", argv[1]); return 1; }
+	}
+	else {
+		generated = generateProgram(1000000);
+		file = sources.addBuffer("<generated>", generated.c_str(), generated.size(), true);
+	}
+	int reps = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	Lexer lexer(sources.file(file));
+	ASTContext context;
+	ProgramNode* ast;
+	{
+		Parser parser(lexer, context);
+		ast = (ProgramNode*)parser.ParseProgram();
+	}
+
+	DynamicWalker dynamicWalker;
+	StackedWalker stackedWalker;
+	double dynamicTime = best(reps, [&] { dynamicWalker.result = WalkResult(); dynamicWalker.walk(ast); });
+	double stackedTime = best(reps, [&] { stackedWalker.result = WalkResult(); stackedWalker.walk(ast); });
+	if (dynamicWalker.result.nodes != stackedWalker.result.nodes || dynamicWalker.result.hash != stackedWalker.result.hash) {
+		std::fprintf(stderr, "walks disagree\n");
+		return 1;
+	}
+
+	uint64_t nodes = stackedWalker.result.nodes;
+	std::printf("nodes: %llu\n", (unsigned long long)nodes);
+	std::printf("Visitor (accept + visit)   %8.2f ms  %6.2f ns/node\n", dynamicTime * 1e3, dynamicTime * 1e9 / nodes);
+	std::printf("StackWalker                %8.2f ms  %6.2f ns/node  %.2fx\n", stackedTime * 1e3, stackedTime * 1e9 / nodes, dynamicTime / stackedTime);
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+	Deep nesting stress
+	programs that are one chain N deep (1M by default): long sums, nested parentheses, unary and assignment
+	chains, nested calls and indexes, nested blocks, ifs and whiles. each goes through lexing, parsing, sema and
+	IR generation on the main thread's normal stack, the parser and both passes keep their own stacks so none of
+	it recurses past a fixed depth. then the same tree is flattened and the flat form checked and generated
+	( luciro --flat ), which has to give as many instructions as the tree did, and flattened once more with a node
+	limit below the chain length, which flatten() has to refuse (what it does for a kind past NodeRef::indexLimit)
+	prints the time per phase, fails (exit 1) if a program doesn't come out as expected
+
+	build: g++ -O2 -std=c++17 -pthread Bench/DeepNestBench.cpp Lexer/?*.cpp Parser/?*.cpp SAnalyzer/?*.cpp IRgen/?*.cpp Support/?*.cpp -o deepnestbench
+	run:   ./deepnestbench [depth]
+*/
+#include "../Lexer/Lexer.h"
+#include "../Lexer/SourceManager.h"
+#include "../Parser/Parser.h"
+#include "../Parser/FlatAST.h"
+#include "../SAnalyzer/SAnalyzer.h"
+#include "../IRgen/IRgen.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// a chain is before x depth, the core, after x depth
+struct Shape {
+	const char* name;
+	bool statements; // the chain is statements, otherwise it's the right side of x = ...;
+	const char* before;
+	const char* core;
+	const char* after;
+	int quads;       // instructions every link makes at least (parentheses and bare blocks make none)
+};
+
+static const Shape shapes[] = {
+	{ "left sum",    false, "",             "1",      " + 1",         2 },
+	{ "right sum",   false, "1 + (",        "1",      ")",            2 },
+	{ "parentheses", false, "(",            "1",      ")",            0 },
+	{ "unary",       false, "- ",           "1",      "",             1 },
+	{ "assignments", false, "x = ",         "1",      "",             2 },
+	{ "calls",       false, "f(",           "1",      ")",            2 },
+	{ "indexes",     false, "a[",           "0",      "]",            4 },
+	{ "blocks",      true,  "{ ",           "x = 1;", " }",           0 },
+	{ "ifs",         true,  "if (1) { ",    "x = 1;", " } else { }",  5 },
+	{ "whiles",      true,  "while (0) { ", "x = 1;", " }",           5 },
+};
+
+static std::string repeat(const char* text, int count) {
+	std::string out;
+	size_t length = std::strlen(text);
+	out.reserve(length * count);
+	for (int i = 0; i < count; i++) out.append(text, length);
+	return out;
+}
+
+// every shape sits in the same program, with a few names to refer to
+static std::string generate(const Shape& shape, int depth) {
+	std::string chain = repeat(shape.before, depth) + shape.core + repeat(shape.after, depth);
+	if (!shape.statements) chain = "x = " + chain + ";";
+	return "int f(int v) { return v; }\nvoid main() {\n    int x = 0;\n    int a[4];\n    " + chain + "\n}\n";
+}
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	int depth = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	if (depth < 1) depth = 1;
+	std::printf("depth %d\n%-12s %10s %10s %10s %10s %10s %10s %10s %10s %12s\n", depth, "shape", "MB", "lex+parse", "sema", "irgen",
+		"flatten", "flat sema", "flat irgen", "errors", "quads");
+
+	bool ok = true;
+	for (const Shape& shape : shapes) {
+		std::string source = generate(shape, depth);
+		SourceManager sources;
+		FileID file = sources.addBuffer(shape.name, source.c_str(), source.size(), true);
+
+		auto start = std::chrono::steady_clock::now();
+		Lexer lexer(sources.file(file));
+		ASTContext context;
+		Parser parser(lexer, context);
+		ASTNode* ast = parser.ParseProgram();
+		double parseMs = msSince(start);
+
+		start = std::chrono::steady_clock::now();
+		SAnalyzer analyzer(lexer.firstToken, &lexer.lineTable());
+		analyzer.walk(ast);
+		double semaMs = msSince(start);
+
+		start = std::chrono::steady_clock::now();
+		IRgen generator(analyzer.getStructLayouts(), lexer.interner());
+		generator.walk(ast);
+		double irMs = msSince(start);
+
+		// the --flat path over the same tree
+		start = std::chrono::steady_clock::now();
+		FlatAST flat(lexer.interner());
+		bool flattened = flatten(static_cast<ProgramNode*>(ast), flat);
+		double flattenMs = msSince(start);
+		// a chain of nodes (every shape but parentheses) has one kind at least depth long
+		FlatAST capped(lexer.interner());
+		bool cappedRefused = flat.nodeCount() < (size_t)depth || !flatten(static_cast<ProgramNode*>(ast), capped, (uint32_t)depth / 2);
+
+		start = std::chrono::steady_clock::now();
+		SAnalyzer flatAnalyzer(lexer.firstToken, &lexer.lineTable());
+		flatAnalyzer.analyze(flat);
+		double flatSemaMs = msSince(start);
+
+		start = std::chrono::steady_clock::now();
+		IRgen flatGenerator(lexer.interner());
+		flatGenerator.generate(flat);
+		double flatIrMs = msSince(start);
+
+		// fewer instructions than the links make means something got cut short
+		int errors = analyzer.errorCount() + flatAnalyzer.errorCount();
+		bool good = errors == 0 && generator.instructions.size() >= (size_t)shape.quads * depth &&
+			flattened && cappedRefused && flatGenerator.instructions.size() == generator.instructions.size();
+		ok = ok && good;
+		std::printf("%-12s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10d %12zu%s\n", shape.name, source.size() / 1048576.0,
+			parseMs, semaMs, irMs, flattenMs, flatSemaMs, flatIrMs, errors, generator.instructions.size(), good ? "" : "  FAILED");
+		std::fflush(stdout);
+	}
+	return ok ? 0 : 1;
+}
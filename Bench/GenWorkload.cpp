@@ -0,0 +1,77 @@
+/*
+	Workload generator, command line side ( Bench/Workload.h does the work )
+	writes a Luciro program of the asked shape to a file or stdout, the same options and seed always give the
+	same bytes. --size takes K, M or G and keeps adding functions until the program is that big
+
+	build: g++ -O2 -std=c++17 Bench/GenWorkload.cpp Bench/Workload.cpp -o genworkload
+	run:   ./genworkload [--seed N] [--structs N] [--nesting PCT] [--globals N] [--functions N] [--statements N]
+	                     [--arrays N] [--depth N] [--expression N] [--size N[K|M|G]] [-o file]
+	e.g.   ./genworkload --size 200M --seed 3 -o big.lc
+*/
+#include "Workload.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// 200M = 200 * 2^20 bytes
+static uint64_t parseSize(const char* text) {
+	char* end = nullptr;
+	uint64_t size = std::strtoull(text, &end, 10);
+	switch (*end) {
+	case 'k': case 'K': return size << 10;
+	case 'm': case 'M': return size << 20;
+	case 'g': case 'G': return size << 30;
+	default: return size;
+	}
+}
+
+int main(int argc, char** argv) {
+	WorkloadShape shape;
+	const char* path = nullptr;
+	for (int i = 1; i < argc; i++) {
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value) {
+			std::fprintf(stderr, "%s needs a value\n", argv[i]);
+			return 1;
+		}
+		if (std::strcmp(argv[i], "--seed") == 0) shape.seed = std::strtoull(value, nullptr, 10);
+		else if (std::strcmp(argv[i], "--structs") == 0) shape.structs = std::atoi(value);
+		else if (std::strcmp(argv[i], "--nesting") == 0) shape.nesting = std::atoi(value);
+		else if (std::strcmp(argv[i], "--globals") == 0) shape.globals = std::atoi(value);
+		else if (std::strcmp(argv[i], "--functions") == 0) shape.functions = std::atoi(value);
+		else if (std::strcmp(argv[i], "--statements") == 0) shape.statements = std::atoi(value);
+		else if (std::strcmp(argv[i], "--arrays") == 0) shape.arrays = std::atoi(value);
+		else if (std::strcmp(argv[i], "--depth") == 0) shape.depth = std::atoi(value);
+		else if (std::strcmp(argv[i], "--expression") == 0) shape.expression = std::atoi(value);
+		else if (std::strcmp(argv[i], "--size") == 0) shape.bytes = parseSize(value);
+		else if (std::strcmp(argv[i], "-o") == 0) path = value;
+		else {
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+		i++;
+	}
+
+	std::FILE* out = path ? std::fopen(path, "wb") : stdout;
+	if (!out) {
+		std::fprintf(stderr, "cannot open %s\n", path);
+		return 1;
+	}
+	// a declaration at a time, memory stays flat however big the program gets
+	WorkloadGenerator generator(shape);
+	std::string chunk;
+	while (generator.next(chunk)) {
+		if (chunk.size() >= (1 << 20)) {
+			std::fwrite(chunk.data(), 1, chunk.size(), out);
+			chunk.clear();
+		}
+	}
+	std::fwrite(chunk.data(), 1, chunk.size(), out);
+	if (path && std::fclose(out) != 0) {
+		std::fprintf(stderr, "cannot write %s\n", path);
+		return 1;
+	}
+	if (path) std::fprintf(stderr, "%s: %llu bytes\n", path, (unsigned long long)generator.written());
+	return 0;
+}
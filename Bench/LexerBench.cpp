@@ -0,0 +1,75 @@
+/*
+	Lexer throughput benchmark
+	lexes a file (or a built in program repeated until it is a few MB) several times and reports tokens/sec
+
+	build: g++ -O2 -std=c++17 -pthread Bench/LexerBench.cpp Lexer/Lexer.cpp Lexer/SimdScan.cpp Lexer/SourceManager.cpp Support/Trace.cpp Support/ThreadPool.cpp -o lexbench
+	run:   ./lexbench [file] [repetitions] [scalar|sse2|avx2] [sentinel|range]
+	(pass "-" as the file to use the built in program, range lexes [begin, end) without relying on the '\0')
+*/
+#include "../Lexer/Lexer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+static const char* sampleUnit = R"(
+struct Point {
+    int x;
+    int y;
+};
+
+double scale(double f, int k) {
+    double r = f * 2.5 + k % 3 - 1.0;
+    char c = 'a';
+    if (r >= 1.0 && k <= 3) { return r; } else { return 0; }
+}
+
+void main() {
+    Point campus[5];
+    int i = 0;
+    while (i < 5) {
+        campus[i].x = 101 + i * 7;
+        campus[i].y = campus[i].x / 2;
+        i = i + 1;
+    }
+}
+)";
+
+int main(int argc, char** argv) {
+	std::string source;
+	if (argc > 1 && std::string(argv[1]) != "-") {
+		std::ifstream file(argv[1], std::ios::binary);
+		if (!file) { std::fprintf(stderr, "cannot open %s\n", argv[1]); return 1; }
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		source = buffer.str();
+	}
+	else {
+		while (source.size() < (8u << 20)) source += sampleUnit;
+	}
+	int reps = argc > 2 ? std::atoi(argv[2]) : 5;
+	if (argc > 3) {
+		std::string level = argv[3];
+		setScanLevel(level == "scalar" ? ScanLevel::Scalar : level == "sse2" ? ScanLevel::SSE2 : ScanLevel::AVX2);
+	}
+	bool range = argc > 4 && std::string(argv[4]) == "range";
+
+	double best = 1e30;
+	size_t tokenCount = 0;
+	for (int r = 0; r < reps; r++) {
+		auto t0 = std::chrono::steady_clock::now();
+		Lexer lexer = range ? Lexer(source.data(), source.data() + source.size()) : Lexer(source.c_str());
+		size_t n = 0;
+		while (lexer.getToken().type != TokenType::Eof) n++;
+		auto t1 = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+		tokenCount = n;
+	}
+
+	std::printf("[%s/%s] bytes: %zu  tokens: %zu  best of %d: %.3f ms  %.2f Mtok/s  %.1f MB/s\n",
+		scanLevelName(scanKernels().level), range ? "range" : "sentinel", source.size(), tokenCount, reps, best * 1e3, tokenCount / best / 1e6, source.size() / best / 1e6);
+	return 0;
+}
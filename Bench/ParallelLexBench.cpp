@@ -0,0 +1,125 @@
+/*
+	Parallel lexing benchmark
+	lexes one big source with 1, 2, .. N threads (Lexer::useThreadPool) and reports time and speedup over 1 thread
+	also checks every run produced the same tokens and line table as the serial one, and before that two sources
+	that leave the chunker no safe newline to split at (one 2 MB line, a program followed by 1.5 MB of spaces)
+
+	build: g++ -O2 -std=c++17 -pthread Bench/ParallelLexBench.cpp Lexer/Lexer.cpp Lexer/SimdScan.cpp Lexer/SourceManager.cpp Support/Trace.cpp Support/ThreadPool.cpp -o parlexbench
+	run:   ./parlexbench [file] [max threads] [repetitions]
+	(pass "-" as the file to use a built in program repeated to 64 MB, max threads defaults to the core count)
+*/
+#include "../Lexer/Lexer.h"
+#include "../Lexer/SourceManager.h"
+#include "../Support/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* sampleUnit = R"(
+struct Point {
+    int x;
+    int y;
+};
+
+double scale(double f, int k) {
+    double r = f * 2.5 + k % 3 - 1.0;
+    char c = '\n';
+    if (r >= 1.0 && k <= 3) { return r; } else { return 0; }
+}
+
+void main() {
+    Point campus[5];
+    int i = 0;
+    while (i < 5) {
+        campus[i].x = 101 + i * 7;
+        campus[i].y = campus[i].x / 2;
+        i = i + 1;
+    }
+}
+)";
+
+static bool sameTokens(const std::vector<Token>& a, const std::vector<Token>& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].offset != b[i].offset || a[i].length != b[i].length || a[i].type != b[i].type) return false;
+	}
+	return true;
+}
+
+// tokens and line table of source lexed serially and on pool, the same or a message on stderr
+static bool sameAsSerial(SourceManager& sources, const char* name, const std::string& source, ThreadPool& pool) {
+	const SourceFile& file = sources.file(sources.addBuffer(name, source.c_str(), source.size(), true));
+	std::vector<Token> serial, parallel;
+	Lexer serialLexer(file);
+	serialLexer.tokenize(serial);
+	Lexer parallelLexer(file);
+	parallelLexer.useThreadPool(&pool);
+	parallelLexer.tokenize(parallel);
+	if (sameTokens(serial, parallel) && serialLexer.lineTable().starts() == parallelLexer.lineTable().starts()) return true;
+	std::fprintf(stderr, "%s: %zu tokens lexed on %u threads, %zu serially\n", name, parallel.size(), pool.size(), serial.size());
+	return false;
+}
+
+int main(int argc, char** argv) {
+	SourceManager sources;
+	std::string generated;
+	FileID file;
+
+	{
+		ThreadPool pool(4);
+		std::string line, trailing;
+		while (line.size() < (2u << 20)) line += "x = y + 1; ";
+		trailing = std::string(sampleUnit) + std::string(3u << 19, ' ');
+		if (!sameAsSerial(sources, "<one line>", line, pool) || !sameAsSerial(sources, "<trailing spaces>", trailing, pool)) return 1;
+	}
+	if (argc > 1 && std::string(argv[1]) != "-") {
+		file = sources.addFile(argv[1]);
+		if (file == InvalidFileID) { std::fprintf(stderr, "cannot open %s\n", argv[1]); return 1; }
+	}
+	else {
+		while (generated.size() < (64u << 20)) generated += sampleUnit;
+		file = sources.addBuffer("<generated>", generated.c_str(), generated.size(), true);
+	}
+	unsigned maxThreads = argc > 2 ? (unsigned)std::atoi(argv[2]) : std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+	int reps = argc > 3 ? std::atoi(argv[3]) : 3;
+
+	std::vector<Token> serialTokens;
+	std::vector<uint32_t> serialLines;
+	double serialTime = 0;
+
+	std::printf("bytes: %zu\n", sources.file(file).size);
+	std::printf("threads       ms   Mtok/s  speedup\n");
+	for (unsigned threads = 1; threads <= maxThreads; threads++) {
+		ThreadPool pool(threads);
+		double best = 1e30;
+		std::vector<Token> tokens;
+		std::vector<uint32_t> lines;
+		for (int r = 0; r < reps; r++) {
+			tokens.clear();
+			auto t0 = std::chrono::steady_clock::now();
+			Lexer lexer(sources.file(file));
+			lexer.useThreadPool(&pool);
+			lexer.tokenize(tokens);
+			auto t1 = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+			lines = lexer.lineTable().starts();
+		}
+		if (threads == 1) {
+			serialTokens = tokens;
+			serialLines = lines;
+			serialTime = best;
+		}
+		else if (!sameTokens(tokens, serialTokens) || lines != serialLines) {
+			std::fprintf(stderr, "%u threads: result differs from the serial lexer\n", threads);
+			return 1;
+		}
+		std::printf("%7u %8.2f %8.2f %8.2fx\n", threads, best * 1e3, tokens.size() / best / 1e6, serialTime / best);
+	}
+	return 0;
+}
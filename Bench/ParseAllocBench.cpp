@@ -0,0 +1,91 @@
+/*
+	Parser allocation benchmark
+	counts heap allocations (every operator new) made while lexing and while parsing, per 1000 source lines
+	the AST itself lives in arena blocks, so what's left is mostly the parser's temporary lists
+
+	build: g++ -O2 -std=c++17 -pthread Bench/ParseAllocBench.cpp Lexer/?*.cpp Parser/?*.cpp Support/?*.cpp -o parseallocbench
+	run:   ./parseallocbench [file]
+	(no file or "-" uses a built in program repeated to about 8 MB)
+*/
+#include "../Lexer/Lexer.h"
+#include "../Lexer/SourceManager.h"
+#include "../Parser/Parser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+static size_t allocations = 0;
+static size_t allocatedBytes = 0;
+
+void* operator new(size_t size) {
+	allocations++;
+	allocatedBytes += size;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static const char* sampleUnit = R"(
+struct Point {
+    int x;
+    int y;
+};
+
+struct Rect {
+    Point topLeft;
+    Point botRight;
+    int ID;
+};
+
+double scale(double f, int k) {
+    double r = f * 2.5 + k % 3 - 1.0;
+    int list[4] = { 1, 2, 3, 4 };
+    if (r >= 1.0 && k <= 3) { return r; } else { return 0; }
+}
+
+void main() {
+    Rect campus[5];
+    int i = 0;
+    while (i < 5) {
+        campus[i].ID = 101 + i * 7;
+        campus[i].botRight.y = scale(2.5, campus[i].ID) / 2;
+        i = i + 1;
+    }
+}
+)";
+
+int main(int argc, char** argv) {
+	SourceManager sources;
+	std::string generated;
+	FileID file;
+	if (argc > 1 && std::string(argv[1]) != "-") {
+		file = sources.addFile(argv[1]);
+		if (file == InvalidFileID) { std::fprintf(stderr, "cannot open %s\n", argv[1]); return 1; }
+	}
+	else {
+		while (generated.size() < (8u << 20)) generated += sampleUnit;
+		file = sources.addBuffer("<generated>", generated.c_str(), generated.size(), true);
+	}
+
+	Lexer lexer(sources.file(file));
+	ASTContext context;
+	size_t lexAllocs, lexBytes, parseAllocs, parseBytes;
+	{
+		size_t a0 = allocations, b0 = allocatedBytes;
+		Parser parser(lexer, context); // lexes everything
+		size_t a1 = allocations, b1 = allocatedBytes;
+		parser.ParseProgram();
+		lexAllocs = a1 - a0;
+		lexBytes = b1 - b0;
+		parseAllocs = allocations - a1;
+		parseBytes = allocatedBytes - b1;
+	}
+
+	double perK = 1000.0 / lexer.lineTable().lineCount();
+	std::printf("lines: %zu  arena: %zu bytes in %zu blocks\n", lexer.lineTable().lineCount(), context.bytesUsed(), context.blocks());
+	std::printf("lex    %10zu allocations  %8.1f per 1000 lines  %12zu bytes\n", lexAllocs, lexAllocs * perK, lexBytes);
+	std::printf("parse  %10zu allocations  %8.1f per 1000 lines  %12zu bytes\n", parseAllocs, parseAllocs * perK, parseBytes);
+	return 0;
+}
@@ -0,0 +1,343 @@
+/*
+	Per phase benchmark
+	times lexing, parsing, sema and IR generation one by one over a corpus, with warmup runs and repetitions
+	- lex is a standalone tokenize, parse is ParseProgram over tokens lexed beforehand, sema and irgen walk the
+	  tree the run before them made, so each number is that phase alone
+	- per phase: median and fastest time, what it produced per second (tokens, AST nodes, symbols declared,
+	  quads), peak RSS while it ran and the heap allocations it made (every operator new)
+	- peak RSS is reset before every phase on Linux (/proc/self/clear_refs), elsewhere it's the peak so far
+	- --json writes it all to a file, one object per input, so runs on different commits can be compared
+	- with no files it runs on two generated programs ( Bench/Workload.h ), 1M and 8M, seeds 1 and 2
+	- --jobs N checks function bodies on N threads ( SAnalyzer/ParallelSema.cpp ), the other phases stay serial
+	the IR dump isn't timed, it's only printing
+
+	build: g++ -O2 -std=c++17 -pthread Bench/PhaseBench.cpp Bench/Workload.cpp Lexer/?*.cpp Parser/?*.cpp SAnalyzer/?*.cpp IRgen/?*.cpp Support/?*.cpp -o phasebench
+	       (or the phasebench target in CMakeLists.txt)
+	run:   ./phasebench [--reps N] [--warmup N] [--jobs N] [--generate SIZE[K|M|G]]... [--json file] [--label text] [file]...
+	e.g.   ./phasebench --json bench.json --label $(git rev-parse --short HEAD) --generate 32M
+*/
+#include "../Lexer/Lexer.h"
+#include "../Lexer/SourceManager.h"
+#include "../Parser/Parser.h"
+#include "../SAnalyzer/SAnalyzer.h"
+#include "../SAnalyzer/StackWalker.h"
+#include "../IRgen/IRgen.h"
+#include "../Support/ThreadPool.h"
+#include "Workload.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// atomic, sema's workers allocate too with --jobs
+static std::atomic<size_t> allocations{ 0 };
+static std::atomic<size_t> allocatedBytes{ 0 };
+
+void* operator new(size_t size) {
+	allocations++;
+	allocatedBytes += size;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+// kept out of line, gcc inlines free() into a delete-expression and then flags it against the new-expression's operator new
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// start a new peak, only Linux can
+static void resetPeak() {
+#ifdef __linux__
+	if (std::FILE* f = std::fopen("/proc/self/clear_refs", "w")) {
+		std::fputs("5", f);
+		std::fclose(f);
+	}
+#endif
+}
+
+// peak resident set in KB, since the last resetPeak() on Linux
+static long peakKB() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return (long)(counters.PeakWorkingSetSize >> 10);
+	return 0;
+#else
+#ifdef __linux__
+	if (std::FILE* f = std::fopen("/proc/self/status", "r")) {
+		char line[256];
+		long kb = -1;
+		while (std::fgets(line, sizeof(line), f)) {
+			if (std::strncmp(line, "VmHWM:", 6) == 0) kb = std::atol(line + 6);
+		}
+		std::fclose(f);
+		if (kb >= 0) return kb;
+	}
+#endif
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss >> 10; // bytes there
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+enum Phase { Lex, Parse, Sema, IR, PhaseCount };
+static const char* const phaseNames[PhaseCount] = { "lex", "parse", "sema", "irgen" };
+static const char* const phaseUnits[PhaseCount] = { "tokens", "nodes", "symbols", "quads" };
+
+struct PhaseResult {
+	std::vector<double> ms;   // one per repetition
+	size_t count = 0;         // what the phase produced, in phaseUnits
+	long peakKB = 0;          // highest over the repetitions
+	size_t allocations = 0;   // in one run (every run makes the same ones)
+	size_t allocatedBytes = 0;
+
+	double median() const {
+		std::vector<double> sorted = ms;
+		std::sort(sorted.begin(), sorted.end());
+		size_t n = sorted.size();
+		return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+	}
+	double fastest() const { return *std::min_element(ms.begin(), ms.end()); }
+};
+
+struct Input {
+	std::string name;
+	FileID file;
+	size_t bytes;
+	PhaseResult phases[PhaseCount];
+};
+
+// counts AST nodes, on a StackWalker so a 1M deep program counts too
+class NodeCounter final : public StackWalker<NodeCounter> {
+	friend class StackWalker<NodeCounter>;
+	ASTNode* children(WalkFrame& frame, std::initializer_list<ASTNode*> list) {
+		if (frame.step == 0) count++;
+		return next(frame, list);
+	}
+	template <typename T>
+	ASTNode* items(WalkFrame& frame, const ArenaVector<T*>& list, uint32_t first = 0) {
+		if (frame.step == 0) count++;
+		if (frame.step < first) frame.step = first;
+		while (frame.step - first < list.size()) {
+			ASTNode* item = list[frame.step++ - first];
+			if (pending(item)) return item;
+		}
+		return nullptr;
+	}
+	ASTNode* resume(ProgramNode* node, WalkFrame& frame) { return items(frame, node->declarations); }
+	ASTNode* resume(BlockNode* node, WalkFrame& frame) { return items(frame, node->statements); }
+	ASTNode* resume(IfStatementNode* node, WalkFrame& frame) { return children(frame, { node->condition, node->thenBranch, node->elseBranch }); }
+	ASTNode* resume(WhileStatementNode* node, WalkFrame& frame) { return children(frame, { node->condition, node->body }); }
+	ASTNode* resume(ReturnStatementNode* node, WalkFrame& frame) { return children(frame, { node->value }); }
+	ASTNode* resume(FunctionDeclNode* node, WalkFrame& frame) { return children(frame, { node->getBody() }); }
+	ASTNode* resume(VarDeclNode* node, WalkFrame& frame) { return children(frame, { node->initializer }); }
+	ASTNode* resume(StructDeclNode*, WalkFrame& frame) { return children(frame, {}); }
+	ASTNode* resume(AssignmentNode* node, WalkFrame& frame) { return children(frame, { node->target, node->value }); }
+	ASTNode* resume(ArrayDeclNode* node, WalkFrame& frame) { return items(frame, node->initializers); }
+	ASTNode* resume(ExpressionStatementNode* node, WalkFrame& frame) { return children(frame, { node->expression }); }
+	ASTNode* resume(LiteralNode*, WalkFrame& frame) { return children(frame, {}); }
+	ASTNode* resume(BinaryOpNode* node, WalkFrame& frame) { return children(frame, { node->left, node->right }); }
+	ASTNode* resume(UnaryOpNode* node, WalkFrame& frame) { return children(frame, { node->expression }); }
+	ASTNode* resume(VariableExprNode*, WalkFrame& frame) { return children(frame, {}); }
+	ASTNode* resume(ArrayIndexNode* node, WalkFrame& frame) { return children(frame, { node->base, node->index }); }
+	ASTNode* resume(MemberAccessNode* node, WalkFrame& frame) { return children(frame, { node->structExpr }); }
+	ASTNode* resume(FunctionCallNode* node, WalkFrame& frame) {
+		if (frame.step == 0) {
+			count++;
+			frame.step = 1;
+			if (pending(node->callee)) return node->callee;
+		}
+		return items(frame, node->arguments, 1);
+	}
+public:
+	size_t count = 0;
+};
+
+template <typename Fn>
+static void timed(PhaseResult& phase, bool record, Fn&& fn) {
+	resetPeak();
+	size_t allocs = allocations, bytes = allocatedBytes;
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (!record) return; // a warmup run
+	phase.ms.push_back(ms);
+	phase.allocations = allocations - allocs;
+	phase.allocatedBytes = allocatedBytes - bytes;
+	phase.peakKB = std::max(phase.peakKB, peakKB());
+}
+
+static ThreadPool* semaPool = nullptr; // --jobs
+
+// the whole pipeline once, each phase timed on its own
+static void run(const SourceFile& file, Input& input, bool record) {
+	PhaseResult* phases = input.phases;
+	timed(phases[Lex], record, [&] {
+		Lexer lexer(file);
+		std::vector<Token> tokens;
+		lexer.tokenize(tokens);
+		phases[Lex].count = tokens.size();
+	});
+
+	Lexer lexer(file);
+	ASTContext context;
+	Parser parser(lexer, context); // lexes, that was the phase before
+	ProgramNode* ast = nullptr;
+	timed(phases[Parse], record, [&] { ast = (ProgramNode*)parser.ParseProgram(); });
+	if (record && phases[Parse].count == 0) {
+		NodeCounter counter;
+		counter.walk(ast);
+		phases[Parse].count = counter.count;
+	}
+
+	std::unique_ptr<SAnalyzer> analyzer;
+	timed(phases[Sema], record, [&] {
+		analyzer.reset(new SAnalyzer(lexer.firstToken, &lexer.lineTable()));
+		analyzer->useThreadPool(semaPool);
+		analyzer->analyze(ast);
+	});
+	phases[Sema].count = analyzer->symbolCount();
+
+	std::unique_ptr<IRgen> generator;
+	timed(phases[IR], record, [&] {
+		generator.reset(new IRgen(analyzer->getStructLayouts(), lexer.interner()));
+		generator->walk(ast);
+	});
+	phases[IR].count = generator->instructions.size();
+}
+
+static uint64_t parseSize(const char* text) {
+	char* end = nullptr;
+	uint64_t size = std::strtoull(text, &end, 10);
+	switch (*end) {
+	case 'k': case 'K': return size << 10;
+	case 'm': case 'M': return size << 20;
+	case 'g': case 'G': return size << 30;
+	default: return size;
+	}
+}
+
+static std::string jsonString(const std::string& text) {
+	std::string out = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') out += '\\';
+		if ((unsigned char)c < 0x20) continue;
+		out += c;
+	}
+	return out + "\"";
+}
+
+static bool writeJson(const char* path, const char* label, int reps, int warmup, const std::vector<Input>& inputs) {
+	std::FILE* out = std::fopen(path, "w");
+	if (!out) return false;
+	std::fprintf(out, "{\n  \"label\": %s,\n  \"repetitions\": %d,\n  \"warmup\": %d,\n  \"inputs\": [",
+		jsonString(label).c_str(), reps, warmup);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		const Input& input = inputs[i];
+		std::fprintf(out, "%s\n    {\n      \"name\": %s,\n      \"bytes\": %zu,\n      \"phases\": {", i ? "," : "",
+			jsonString(input.name).c_str(), input.bytes);
+		for (int p = 0; p < PhaseCount; p++) {
+			const PhaseResult& phase = input.phases[p];
+			std::fprintf(out, "%s\n        \"%s\": { \"median_ms\": %.3f, \"min_ms\": %.3f, \"%s\": %zu, \"%s_per_s\": %.0f, "
+				"\"peak_rss_kb\": %ld, \"allocations\": %zu, \"allocated_bytes\": %zu, \"ms\": [",
+				p ? "," : "", phaseNames[p], phase.median(), phase.fastest(), phaseUnits[p], phase.count, phaseUnits[p],
+				phase.count / (phase.median() / 1e3), phase.peakKB, phase.allocations, phase.allocatedBytes);
+			for (size_t r = 0; r < phase.ms.size(); r++) std::fprintf(out, "%s%.3f", r ? ", " : "", phase.ms[r]);
+			std::fprintf(out, "] }");
+		}
+		std::fprintf(out, "\n      }\n    }");
+	}
+	std::fprintf(out, "\n  ]\n}\n");
+	return std::fclose(out) == 0;
+}
+
+int main(int argc, char** argv) {
+	int reps = 5, warmup = 1;
+	unsigned jobs = 1;
+	const char* jsonPath = nullptr;
+	const char* label = "";
+	std::vector<uint64_t> generate;
+	std::vector<const char*> files;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--reps") == 0 && hasValue) reps = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) warmup = std::max(0, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--jobs") == 0 && hasValue) jobs = (unsigned)std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--generate") == 0 && hasValue) generate.push_back(parseSize(argv[++i]));
+		else if (std::strcmp(argv[i], "--json") == 0 && hasValue) jsonPath = argv[++i];
+		else if (std::strcmp(argv[i], "--label") == 0 && hasValue) label = argv[++i];
+		else if (argv[i][0] == '-') {
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+		else files.push_back(argv[i]);
+	}
+	if (files.empty() && generate.empty()) generate = { 1u << 20, 8u << 20 };
+	std::unique_ptr<ThreadPool> pool(jobs != 1 ? new ThreadPool(jobs) : nullptr);
+	semaPool = pool.get();
+
+	SourceManager sources;
+	std::deque<std::string> generated; // the buffers have to stay put
+	std::vector<Input> inputs;
+	for (const char* path : files) {
+		FileID file = sources.addFile(path);
+		if (file == InvalidFileID) {
+			std::fprintf(stderr, "cannot open %s\n", path);
+			return 1;
+		}
+		inputs.push_back({ path, file, sources.file(file).size, {} });
+	}
+	for (size_t i = 0; i < generate.size(); i++) {
+		WorkloadShape shape;
+		shape.seed = i + 1;
+		shape.bytes = generate[i];
+		generated.push_back(generateWorkload(shape));
+		std::string name = "generated " + std::to_string(generate[i] >> 10) + "K seed " + std::to_string(shape.seed);
+		FileID file = sources.addBuffer(name.c_str(), generated.back().c_str(), generated.back().size(), true);
+		inputs.push_back({ name, file, generated.back().size(), {} });
+	}
+
+	std::cerr.setstate(std::ios::failbit); // a program with errors would report them on every run
+	std::printf("%d repetitions after %d warmup\n", reps, warmup);
+	std::printf("%-28s %-6s %10s %10s %12s %10s %14s %10s %12s\n", "input", "phase", "median ms", "min ms",
+		"count", "unit", "per second", "peak MB", "allocations");
+	for (Input& input : inputs) {
+		const SourceFile& file = sources.file(input.file);
+		for (int r = 0; r < warmup + reps; r++) run(file, input, r >= warmup);
+		for (int p = 0; p < PhaseCount; p++) {
+			const PhaseResult& phase = input.phases[p];
+			std::printf("%-28s %-6s %10.2f %10.2f %12zu %10s %14.0f %10.1f %12zu\n", p ? "" : input.name.c_str(),
+				phaseNames[p], phase.median(), phase.fastest(), phase.count, phaseUnits[p],
+				phase.count / (phase.median() / 1e3), phase.peakKB / 1024.0, phase.allocations);
+		}
+		std::fflush(stdout);
+	}
+	std::cerr.clear();
+
+	if (jsonPath && !writeJson(jsonPath, label, reps, warmup, inputs)) {
+		std::fprintf(stderr, "cannot write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,401 @@
+#include "Workload.h"
+#include <charconv>
+
+// the usual names, numbered once they run out
+static const char* const structNames[] = { "Point", "Rect", "Color", "Item", "Node", "Span", "Cell", "Pair", "Range", "Entry" };
+static const char* const memberNames[] = { "x", "y", "id", "size", "count", "value", "weight", "tag" };
+static const int structNameCount = sizeof(structNames) / sizeof(structNames[0]);
+static const int memberNameCount = sizeof(memberNames) / sizeof(memberNames[0]);
+static const char* const arithmetic[] = { " + ", " - ", " * ", " / ", " + ", " - ", " * ", " % " };
+static const char* const comparisons[] = { " < ", " > ", " <= ", " >= ", " == ", " != " };
+static const size_t maxPaths = 24;
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadShape& shape) : shape(shape), state(shape.seed) {}
+
+// splitmix64, same numbers on every platform
+uint64_t WorkloadGenerator::random() {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+void WorkloadGenerator::number(int64_t value) {
+	char text[24];
+	auto result = std::to_chars(text, text + sizeof(text), value);
+	out->append(text, result.ptr - text);
+}
+
+void WorkloadGenerator::indent(int level) {
+	out->append(level * 4, ' ');
+}
+
+std::string WorkloadGenerator::newName(char prefix) {
+	return prefix + std::to_string(nextName++);
+}
+
+bool WorkloadGenerator::next(std::string& text) {
+	if (finished) return false;
+	out = &text;
+	size_t before = text.size();
+	if (!started) {
+		header();
+		started = true;
+	}
+	else if (shape.bytes ? total < shape.bytes : produced < shape.functions) {
+		function();
+	}
+	else {
+		mainFunction();
+		finished = true;
+	}
+	total += text.size() - before;
+	out = nullptr;
+	return true;
+}
+
+// structs (each can hold earlier ones) and globals
+void WorkloadGenerator::header() {
+	for (int i = 0; i < shape.structs; i++) {
+		StructInfo info;
+		info.name = structNames[i % structNameCount];
+		if (i >= structNameCount) info.name += std::to_string(i / structNameCount);
+		*out += "struct " + info.name + " {\n";
+
+		int members = 2 + below(5);
+		int first = below(memberNameCount);
+		for (int j = 0; j < members; j++) {
+			std::string member = memberNames[(first + j) % memberNameCount];
+			indent(1);
+			if (j > 0 && i > 0 && chance(shape.nesting)) {
+				const StructInfo& inner = structs[below(i)];
+				*out += inner.name + " " + member + ";\n";
+				for (const Path& path : inner.paths) {
+					if (info.paths.size() == maxPaths) break;
+					info.paths.push_back({ "." + member + path.text, path.type });
+				}
+				continue;
+			}
+			// the first member is always a number, so every struct has something to compute with
+			int pick = j == 0 ? below(75) : below(100);
+			if (pick < 45) {
+				*out += "int " + member + ";\n";
+				info.paths.push_back({ "." + member, Int });
+			}
+			else if (pick < 75) {
+				*out += "double " + member + ";\n";
+				info.paths.push_back({ "." + member, Double });
+			}
+			else if (pick < 90) {
+				*out += "char " + member + ";\n";
+				info.paths.push_back({ "." + member, Char });
+			}
+			else {
+				*out += "bool " + member + ";\n"; // there are no bool literals to assign, it only takes up room
+			}
+			if (info.paths.size() > maxPaths) info.paths.pop_back();
+		}
+		*out += "};\n\n";
+		structs.push_back(std::move(info));
+	}
+
+	for (int i = 0; i < shape.globals; i++) {
+		Var global = { "g" + std::to_string(i), chance(60) ? Int : Double, -1, 0 };
+		*out += global.type == Int ? "int " : "double ";
+		*out += global.name + " = ";
+		if (global.type == Int) number(below(100));
+		else {
+			number(below(100));
+			*out += '.';
+			number(below(10));
+		}
+		*out += ";\n";
+		globals.push_back(global);
+	}
+	*out += '\n';
+}
+
+void WorkloadGenerator::function() {
+	Function fn = { "f" + std::to_string(produced++), chance(60) ? Int : Double, below(4) };
+	visible = globals;
+	nextName = 0;
+
+	*out += fn.returns == Int ? "int " : "double ";
+	*out += fn.name + "(";
+	for (int i = 0; i < fn.params; i++) {
+		Var param = { "p" + std::to_string(i), chance(70) ? Int : Double, -1, 0 };
+		if (i) *out += ", ";
+		*out += param.type == Int ? "int " : "double ";
+		*out += param.name;
+		visible.push_back(param);
+	}
+	*out += ") {\n";
+	for (int i = 0; i < shape.arrays; i++) arrayDeclaration(1);
+	block(1, shape.statements);
+	indent(1);
+	*out += "return ";
+	expression(shape.expression, false);
+	*out += ";\n}\n\n";
+	functions.push_back(fn); // only later functions call it, nothing recurses
+}
+
+void WorkloadGenerator::mainFunction() {
+	*out += "int main() {\n    int total = 0;\n";
+	size_t first = functions.size() > 8 ? functions.size() - 8 : 0;
+	for (size_t i = first; i < functions.size(); i++) {
+		*out += "    total = total + ";
+		*out += functions[i].name + "(";
+		for (int k = 0; k < functions[i].params; k++) {
+			if (k) *out += ", ";
+			number(1 + below(9));
+		}
+		*out += ");\n";
+	}
+	*out += "    return total;\n}\n";
+}
+
+// mostly locals and parameters, the globals are always there and would crowd them out
+const WorkloadGenerator::Var& WorkloadGenerator::pickVisible() {
+	size_t own = visible.size() - globals.size();
+	if (own && chance(75)) return visible[globals.size() + below((int)own)];
+	return visible[below((int)visible.size())];
+}
+
+// count statements, whatever they declare is gone afterwards
+void WorkloadGenerator::block(int level, int count) {
+	size_t mark = visible.size();
+	for (int i = 0; i < count; i++) statement(level);
+	visible.resize(mark);
+}
+
+void WorkloadGenerator::statement(int level) {
+	int pick = below(100);
+	bool nest = level <= shape.depth;
+	int inner = shape.statements / 3 > 0 ? shape.statements / 3 : 1;
+
+	if (pick < 25) {
+		declaration(level);
+	}
+	else if (pick < 37 && nest) {
+		indent(level);
+		*out += "if (";
+		condition();
+		*out += ") {\n";
+		block(level + 1, 1 + below(inner));
+		indent(level);
+		if (chance(40)) {
+			*out += "} else {\n";
+			block(level + 1, 1 + below(inner));
+			indent(level);
+		}
+		*out += "}\n";
+	}
+	else if (pick < 45 && nest) {
+		indent(level);
+		*out += "while (";
+		condition();
+		*out += ") {\n";
+		block(level + 1, 1 + below(inner));
+		indent(level);
+		*out += "}\n";
+	}
+	else if (pick < 52 && !functions.empty()) {
+		indent(level);
+		call(functions[below((int)functions.size())]);
+		*out += ";\n";
+	}
+	else {
+		assignment(level);
+	}
+}
+
+// a number with its initializer, or a struct
+void WorkloadGenerator::declaration(int level) {
+	indent(level);
+	if (!structs.empty() && chance(30)) {
+		Var var = { newName('r'), Struct, below((int)structs.size()), 0 };
+		*out += structs[var.structId].name + " " + var.name + ";\n";
+		visible.push_back(var);
+		return;
+	}
+	// the initializer is checked before the name exists, so it can't use it
+	Var var = { newName('v'), chance(60) ? Int : Double, -1, 0 };
+	*out += var.type == Int ? "int " : "double ";
+	*out += var.name + " = ";
+	expression(shape.expression / 2 + below(shape.expression + 1), false);
+	*out += ";\n";
+	visible.push_back(var);
+}
+
+void WorkloadGenerator::arrayDeclaration(int level) {
+	indent(level);
+	if (!structs.empty() && chance(40)) {
+		Var var = { newName('a'), Struct, below((int)structs.size()), 2 + below(7) };
+		*out += structs[var.structId].name + " " + var.name + "[";
+		number(var.length);
+		*out += "];\n";
+		visible.push_back(var);
+		return;
+	}
+	Var var = { newName('a'), chance(60) ? Int : Double, -1, 4 + below(13) };
+	*out += var.type == Int ? "int " : "double ";
+	*out += var.name + "[";
+	number(var.length);
+	*out += "]";
+	if (chance(50)) {
+		*out += " = {";
+		for (int i = 0; i < var.length; i++) {
+			*out += i ? ", " : " ";
+			expression(below(2), false);
+		}
+		*out += " }";
+	}
+	*out += ";\n";
+	visible.push_back(var);
+}
+
+void WorkloadGenerator::assignment(int level) {
+	indent(level);
+	Type type;
+	if (!target(false, &type)) {
+		// nothing in scope yet (no globals, no parameters), declare something instead
+		out->resize(out->size() - level * 4);
+		declaration(level);
+		return;
+	}
+	*out += " = ";
+	if (type == Char) {
+		*out += '\'';
+		*out += (char)('a' + below(26));
+		*out += '\'';
+	}
+	else {
+		expression(shape.expression / 2 + below(shape.expression + 1), false);
+	}
+	*out += ";\n";
+}
+
+// a comparison or two
+void WorkloadGenerator::condition() {
+	int parts = chance(30) ? 2 : 1;
+	for (int i = 0; i < parts; i++) {
+		if (i) *out += chance(50) ? " && " : " || ";
+		expression(below(3), false);
+		*out += comparisons[below(6)];
+		expression(below(3), false);
+	}
+}
+
+// operators binary operators over operands, intOnly keeps it an int (array indexes have to be)
+void WorkloadGenerator::expression(int operators, bool intOnly) {
+	if (operators <= 0) {
+		operand(intOnly);
+		return;
+	}
+	int left = below(operators);
+	int right = operators - 1 - left;
+	bool parenLeft = left > 0 && chance(40);
+	bool parenRight = right > 0 && chance(60);
+	if (parenLeft) *out += '(';
+	expression(left, intOnly);
+	if (parenLeft) *out += ')';
+	*out += arithmetic[below(8)];
+	if (parenRight) *out += '(';
+	expression(right, intOnly);
+	if (parenRight) *out += ')';
+}
+
+void WorkloadGenerator::operand(bool intOnly) {
+	if (chance(5)) *out += '-'; // never twice, -- would be one token
+	int pick = below(100);
+	if (pick < 10 && !functions.empty() && callDepth < 2) {
+		const Function& fn = functions[below((int)functions.size())];
+		if (!intOnly || fn.returns == Int) {
+			call(fn);
+			return;
+		}
+	}
+	if (pick < 55) {
+		// something in scope, a few tries to find one that fits
+		for (int tries = 0; tries < 4 && !visible.empty(); tries++) {
+			const Var& var = pickVisible();
+			if (var.type == Struct) {
+				const Path& path = structs[var.structId].paths[below((int)structs[var.structId].paths.size())];
+				if (path.type == Char || (intOnly && path.type != Int)) continue;
+				*out += var.name;
+				if (var.length) {
+					*out += '[';
+					number(below(var.length));
+					*out += ']';
+				}
+				*out += path.text;
+				return;
+			}
+			if (intOnly && var.type != Int) continue;
+			*out += var.name;
+			if (var.length) {
+				*out += '[';
+				number(below(var.length));
+				*out += ']';
+			}
+			return;
+		}
+	}
+	if (!intOnly && pick >= 85) {
+		number(below(100));
+		*out += '.';
+		number(below(10));
+		return;
+	}
+	number(1 + below(99));
+}
+
+// something that can be assigned to, false if there's nothing in scope
+bool WorkloadGenerator::target(bool intOnly, Type* type) {
+	for (int tries = 0; tries < 8 && !visible.empty(); tries++) {
+		const Var& var = pickVisible();
+		if (var.type == Struct) {
+			const Path& path = structs[var.structId].paths[below((int)structs[var.structId].paths.size())];
+			if (intOnly && path.type != Int) continue;
+			*out += var.name;
+			if (var.length) {
+				*out += '[';
+				if (chance(50)) number(below(var.length));
+				else expression(1, true);
+				*out += ']';
+			}
+			*out += path.text;
+			*type = path.type;
+			return true;
+		}
+		if (intOnly && var.type != Int) continue;
+		*out += var.name;
+		if (var.length) {
+			*out += '[';
+			if (chance(50)) number(below(var.length));
+			else expression(1, true);
+			*out += ']';
+		}
+		*type = var.type;
+		return true;
+	}
+	return false;
+}
+
+void WorkloadGenerator::call(const Function& fn) {
+	callDepth++;
+	*out += fn.name + "(";
+	for (int i = 0; i < fn.params; i++) {
+		if (i) *out += ", ";
+		expression(below(3), false);
+	}
+	*out += ')';
+	callDepth--;
+}
+
+std::string generateWorkload(const WorkloadShape& shape) {
+	WorkloadGenerator generator(shape);
+	std::string source;
+	while (generator.next(source)) {}
+	return source;
+}
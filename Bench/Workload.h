@@ -0,0 +1,100 @@
+#pragma once
+/*
+	Workload generator
+	makes Luciro programs that parse and check without errors, for benchmarks that need big realistic inputs
+	- structs nest like Point inside Rect, functions have locals, struct variables, arrays (of numbers and of
+	  structs), member chains like campus[2].botRight.y, calls to earlier functions, ifs and whiles nested to a
+	  given depth and expressions of a given size, then a main() that calls the last few functions
+	- the same shape and seed always give the same program byte for byte, the random numbers come from a
+	  splitmix64 of our own (std distributions differ between standard libraries)
+	- next() hands the program out one top level declaration at a time, so hundreds of MB can go straight to
+	  a file without sitting in memory, generateWorkload() collects it all in a string
+	usage: WorkloadShape shape; shape.functions = 5000; shape.seed = 7;
+	       std::string source = generateWorkload(shape);
+	or from the command line: Bench/GenWorkload.cpp
+*/
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct WorkloadShape {
+	uint64_t seed = 1;
+	int structs = 16;     // struct declarations
+	int nesting = 40;     // chance in percent that a struct member is an earlier struct (Rect { Point topLeft; ... })
+	int globals = 8;      // global int and double variables
+	int functions = 1000; // function declarations, main() comes on top
+	int statements = 10;  // statements in a function body, nested blocks get a third of that
+	int arrays = 2;       // arrays per function, of numbers or of structs
+	int depth = 3;        // how deep ifs and whiles nest
+	int expression = 6;   // binary operators per expression, give or take half
+	uint64_t bytes = 0;   // if set, functions keep coming until the program is about this big (functions is ignored)
+};
+
+class WorkloadGenerator {
+public:
+	explicit WorkloadGenerator(const WorkloadShape& shape);
+	// appends the next top level piece (the structs and globals, a function, main), false once main is out
+	bool next(std::string& out);
+	uint64_t written() const { return total; }
+
+private:
+	enum Type : uint8_t { Int, Double, Char, Struct };
+	struct Path {
+		std::string text; // .topLeft.x
+		Type type;        // Int, Double or Char
+	};
+	struct StructInfo {
+		std::string name;
+		std::vector<Path> paths; // to every primitive member, nested ones included (a few dozen at most)
+	};
+	struct Function {
+		std::string name;
+		Type returns;
+		int params;
+	};
+	// something a statement or expression can name
+	struct Var {
+		std::string name;
+		Type type;      // of the variable, or of the elements for an array
+		int structId;   // for Struct
+		int length;     // 0 = not an array
+	};
+
+	WorkloadShape shape;
+	uint64_t state;
+	uint64_t total = 0;
+	int produced = 0;   // functions so far
+	bool started = false;
+	bool finished = false;
+	int nextName = 0;   // locals are numbered per function, nothing ever shadows anything
+	int callDepth = 0;
+	std::vector<StructInfo> structs;
+	std::vector<Function> functions;
+	std::vector<Var> globals;
+	std::vector<Var> visible; // globals, parameters and the locals in scope, a block truncates it back
+	std::string* out = nullptr;
+
+	uint64_t random();
+	int below(int n) { return n > 0 ? (int)(random() % (uint64_t)n) : 0; }
+	bool chance(int percent) { return below(100) < percent; }
+	void number(int64_t value);
+	void indent(int level);
+	std::string newName(char prefix);
+	const Var& pickVisible();
+
+	void header();
+	void function();
+	void mainFunction();
+	void block(int level, int count);
+	void statement(int level);
+	void declaration(int level);
+	void arrayDeclaration(int level);
+	void assignment(int level);
+	void condition();
+	void expression(int operators, bool intOnly);
+	void operand(bool intOnly);
+	bool target(bool intOnly, Type* type);
+	void call(const Function& fn);
+};
+
+std::string generateWorkload(const WorkloadShape& shape);
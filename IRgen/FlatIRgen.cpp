@@ -0,0 +1,322 @@
+/*
+    IR generation straight from a FlatAST, instruction for instruction what the visit functions in IRgen.cpp emit
+    struct sizes and the struct table come from the flat AST's side tables (SAnalyzer::analyze fills them in)
+    keep the two in step, both forms of a program have to produce the same IR
+*/
+#include "IRgen.h"
+#include "../Parser/FlatAST.h"
+#include "../Support/Trace.h"
+#include <string>
+
+template class FlatWalker<IRgen>; // like StackWalker<IRgen> in IRgen.cpp
+
+void IRgen::generate(const FlatAST& ast) {
+    flat = &ast;
+    for (uint32_t i = 0; i < ast.declarations.count; i++) {
+        walk(ast.ref(ast.declarations, i));
+    }
+    flat = nullptr;
+}
+
+// bytes of a struct by name, 8 (one slot) if there is no such struct
+int IRgen::flatStructSize(uint32_t name, int fallback) {
+    uint32_t entry = flat->structIndex(name);
+    return entry != FlatAST::NoStruct ? flat->structSize[entry] : fallback;
+}
+
+// every node kind in one resume, the case emits what the node's resume in IRgen.cpp does (see FlatWalker.h)
+// a child's value is in lastResultId after it
+NodeRef IRgen::resume(FlatFrame& frame) {
+    const FlatAST& ast = *flat;
+    uint32_t i = frame.node.index();
+    switch (frame.node.kind()) {
+    case NodeKind::Block: {
+        const FlatBlock& block = ast.blocks[i];
+        while (frame.step < block.statements.count) {
+            NodeRef statement = ast.ref(block.statements, frame.step++);
+            if (pending(statement)) return statement;
+        }
+        break;
+    }
+    case NodeKind::StructDecl:
+        break;
+    case NodeKind::If: {
+        const FlatIf& stmt = ast.ifs[i];
+        int& elseLabel = frame.saved[0];
+        int& endLabel = frame.saved[1];
+        switch (frame.step) {
+        case 0:
+            if (!stmt.condition.valid()) return NodeRef();
+            frame.step = 1;
+            if (pending(stmt.condition)) return stmt.condition;
+            [[fallthrough]];
+        case 1:
+            elseLabel = nextLabel();
+            endLabel = nextLabel();
+            emit(IROp::IF_FALSE_GOTO, elseLabel, this->lastResultId, -1);
+            frame.step = 2;
+            if (pending(stmt.thenBranch)) return stmt.thenBranch;
+            [[fallthrough]];
+        case 2:
+            emit(IROp::JUMP, endLabel, -1, -1);
+            emit(IROp::LABEL, elseLabel, -1, -1);
+            frame.step = 3;
+            if (pending(stmt.elseBranch)) return stmt.elseBranch;
+            [[fallthrough]];
+        default:
+            emit(IROp::LABEL, endLabel, -1, -1);
+        }
+        break;
+    }
+    case NodeKind::While: {
+        const FlatWhile& stmt = ast.whiles[i];
+        int& startLabel = frame.saved[0];
+        int& endLabel = frame.saved[1];
+        switch (frame.step) {
+        case 0:
+            if (!stmt.condition.valid()) return NodeRef();
+            startLabel = nextLabel();
+            endLabel = nextLabel();
+            emit(IROp::LABEL, startLabel, -1, -1);
+            frame.step = 1;
+            if (pending(stmt.condition)) return stmt.condition;
+            [[fallthrough]];
+        case 1:
+            emit(IROp::IF_FALSE_GOTO, endLabel, this->lastResultId, -1);
+            frame.step = 2;
+            if (pending(stmt.body)) return stmt.body;
+            [[fallthrough]];
+        default:
+            emit(IROp::JUMP, startLabel, -1, -1);
+            emit(IROp::LABEL, endLabel, -1, -1);
+        }
+        break;
+    }
+    case NodeKind::Return: {
+        NodeRef value = ast.returns[i].value;
+        if (frame.step == 0) {
+            frame.step = 1;
+            if (pending(value)) return value;
+        }
+        emit(IROp::RET, -1, value.valid() ? this->lastResultId : -1, -1);
+        break;
+    }
+    case NodeKind::Function: {
+        const FlatFunction& fn = ast.functions[i];
+        if (frame.step == 0) {
+            frame.step = 1;
+            emit(IROp::LABEL, Spool.symbol(ast.name(fn.name)), -1, -1);
+            for (uint32_t k = 0; k < fn.paramCount; k++) {
+                emit(IROp::PARAM, Spool.symbol(ast.name(ast.params[fn.firstParam + k].name)), -1, -1);
+            }
+            if (pending(fn.body)) return fn.body;
+        }
+        emit(IROp::RET, -1, -1, -1);
+        break;
+    }
+    case NodeKind::VarDecl: {
+        const FlatVarDecl& var = ast.varDecls[i];
+        if (frame.step == 0) {
+            frame.step = 1;
+            if (pending(var.initializer)) return var.initializer;
+        }
+        int varID = Spool.symbol(ast.name(var.name));
+        int size = var.type == TokenType::Struct ? flatStructSize(var.structType, 8) : primitiveSize(ast.layoutMode, var.type);
+        emit(IROp::ALLOC, varID, size, -1);
+        if (var.initializer.valid()) emit(IROp::ASSIGN, varID, size, this->lastResultId);
+        break;
+    }
+    case NodeKind::ArrayDecl: {
+        const FlatArrayDecl& arr = ast.arrayDecls[i];
+        int arrayID = Spool.symbol(ast.name(arr.name));
+        if (frame.step == 0) {
+            int elementSize = arr.type == TokenType::Struct ? flatStructSize(arr.structType, 8) : primitiveSize(ast.layoutMode, arr.type);
+            emit(IROp::ALLOC, arrayID, arr.size, elementSize);
+        }
+        else {
+            emit(IROp::STORE, arrayID, (int)frame.step - 1, this->lastResultId);
+        }
+        while (frame.step < arr.initializers.count) {
+            NodeRef init = ast.ref(arr.initializers, frame.step++);
+            if (pending(init)) return init;
+            emit(IROp::STORE, arrayID, (int)frame.step - 1, this->lastResultId);
+        }
+        break;
+    }
+    case NodeKind::ExprStmt:
+        return next(frame, { ast.exprStmts[i].expression });
+    case NodeKind::Literal: {
+        int targetReg = nextTemp();
+        emit(IROp::LOAD_CONST, targetReg, addConstant(ast.literals[i].value), -1);
+        this->lastResultId = targetReg;
+        break;
+    }
+    case NodeKind::Variable: {
+        int targetReg = nextTemp();
+        emit(IROp::LOAD, targetReg, Spool.symbol(ast.name(ast.variables[i].name)), -1);
+        this->lastResultId = targetReg;
+        break;
+    }
+    case NodeKind::Assign: {
+        const FlatAssign& assign = ast.assigns[i];
+        int& sourceValReg = frame.saved[0];
+        switch (frame.step) {
+        case 0:
+            frame.step = 1;
+            if (pending(assign.value)) return assign.value;
+            [[fallthrough]];
+        case 1:
+            sourceValReg = this->lastResultId;
+            frame.step = 2;
+            if (pending(assign.target)) return assign.target;
+        }
+        bool member = assign.target.valid() && assign.target.kind() == NodeKind::MemberAccess;
+        int size = member ? ast.accessSize[assign.target.index()] : valueSize(ast.layoutMode, ast.type(assign.target));
+        emit(IROp::STORE, this->lastResultId, sourceValReg, size);
+        this->lastResultId = sourceValReg;
+        break;
+    }
+    case NodeKind::Binary: {
+        const FlatBinary& bin = ast.binaries[i];
+        if (bin.op == TokenType::OpAnd || bin.op == TokenType::OpOr) {
+            int& resultReg = frame.saved[0];
+            int& skipLabel = frame.saved[1];
+            int& endLabel = frame.saved[2];
+            switch (frame.step) {
+            case 0:
+                resultReg = nextTemp();
+                skipLabel = nextLabel();
+                endLabel = nextLabel();
+                frame.step = 1;
+                if (pending(bin.left)) return bin.left;
+                [[fallthrough]];
+            case 1: {
+                int leftVal = this->lastResultId;
+                frame.step = 2;
+                if (bin.op == TokenType::OpAnd) {
+                    emit(IROp::IF_FALSE_GOTO, skipLabel, leftVal, -1);
+                    if (pending(bin.right)) return bin.right;
+                    break;
+                }
+                int evalRightLabel = nextLabel();
+                emit(IROp::IF_FALSE_GOTO, evalRightLabel, leftVal, -1);
+                int oReg = nextTemp();
+                emit(IROp::LOAD_CONST, oReg, intConstant(1), -1);
+                emit(IROp::ASSIGN, resultReg, -1, oReg);
+                emit(IROp::JUMP, endLabel, -1, -1);
+                emit(IROp::LABEL, evalRightLabel, -1, -1);
+                if (pending(bin.right)) return bin.right;
+            }
+            }
+            if (bin.op == TokenType::OpAnd) {
+                emit(IROp::ASSIGN, resultReg, -1, this->lastResultId);
+                emit(IROp::JUMP, endLabel, -1, -1);
+                emit(IROp::LABEL, skipLabel, -1, -1);
+                int zReg = nextTemp();
+                emit(IROp::LOAD_CONST, zReg, intConstant(0), -1);
+                emit(IROp::ASSIGN, resultReg, -1, zReg);
+            }
+            else {
+                emit(IROp::ASSIGN, resultReg, -1, this->lastResultId);
+            }
+            emit(IROp::LABEL, endLabel, -1, -1);
+            this->lastResultId = resultReg;
+            break;
+        }
+        int& leftReg = frame.saved[0];
+        switch (frame.step) {
+        case 0:
+            frame.step = 1;
+            if (pending(bin.left)) return bin.left;
+            [[fallthrough]];
+        case 1:
+            leftReg = this->lastResultId;
+            frame.step = 2;
+            if (pending(bin.right)) return bin.right;
+        }
+        int rightReg = this->lastResultId;
+        int resultReg = nextTemp();
+        emit(opConvert(bin.op), resultReg, leftReg, rightReg);
+        this->lastResultId = resultReg;
+        break;
+    }
+    case NodeKind::Unary: {
+        const FlatUnary& un = ast.unaries[i];
+        if (frame.step == 0) {
+            frame.step = 1;
+            if (pending(un.operand)) return un.operand;
+        }
+        int operandReg = this->lastResultId;
+        int resultReg = nextTemp();
+        if (opConvert(un.op) == IROp::NOT) emit(IROp::NOT, resultReg, operandReg, -1);
+        else if (un.op == TokenType::OpMinus) emit(IROp::NEG, resultReg, operandReg, -1);
+        this->lastResultId = resultReg;
+        break;
+    }
+    case NodeKind::ArrayIndex: {
+        const FlatArrayIndex& idx = ast.arrayIndexes[i];
+        int& baseAddr = frame.saved[0];
+        switch (frame.step) {
+        case 0:
+            frame.step = 1;
+            if (pending(idx.base)) return idx.base;
+            [[fallthrough]];
+        case 1:
+            baseAddr = this->lastResultId;
+            frame.step = 2;
+            if (pending(idx.index)) return idx.index;
+        }
+        int indexReg = this->lastResultId;
+        int offsetReg = nextTemp();
+        int sizeID = intConstant(ast.indexStride[i]);
+        int eightReg = nextTemp();
+        emit(IROp::LOAD_CONST, eightReg, sizeID, -1);
+        emit(IROp::MUL, offsetReg, indexReg, eightReg);
+        int finalAddr = nextTemp();
+        emit(IROp::ADD, finalAddr, baseAddr, offsetReg);
+        this->lastResultId = finalAddr;
+        break;
+    }
+    case NodeKind::MemberAccess: {
+        const FlatMemberAccess& access = ast.memberAccesses[i];
+        if (frame.step == 0) {
+            frame.step = 1;
+            if (pending(access.base)) return access.base;
+        }
+        int baseAddr = this->lastResultId;
+        int offset = ast.accessOffset[i]; // sema looked the member up
+        if (offset < 0) break; // sema already complained, lastResultId stays the base
+        int offsetReg = nextTemp();
+        emit(IROp::LOAD_CONST, offsetReg, intConstant(offset), -1);
+        int memberAddr = nextTemp();
+        emit(IROp::ADD, memberAddr, baseAddr, offsetReg);
+        this->lastResultId = memberAddr;
+        break;
+    }
+    case NodeKind::Call: {
+        const FlatCall& call = ast.calls[i];
+        // argument registers go on argStack from saved[0] up, like the tree's calls
+        if (frame.step == 0) frame.saved[0] = (int)argStack.size();
+        else argStack.push_back(this->lastResultId);
+        while (frame.step < call.arguments.count) {
+            NodeRef arg = ast.ref(call.arguments, frame.step++);
+            if (pending(arg)) return arg;
+            argStack.push_back(this->lastResultId);
+        }
+        int first = frame.saved[0];
+        int count = (int)argStack.size() - first;
+        for (int k = 0; k < count; ++k) {
+            emit(IROp::PARAM, argStack[first + k], k, -1);
+        }
+        argStack.resize(first);
+        int funcID = Spool.symbol(ast.nameOf(call.callee));
+        int returnReg = nextTemp();
+        emit(IROp::CALL, returnReg, funcID, count);
+        this->lastResultId = returnReg;
+        break;
+    }
+    default:
+        break;
+    }
+    return NodeRef();
+}
@@ -4,18 +4,46 @@
 #include <string>
 #include "../SAnalyzer/Visitor.h"
 #include "../Parser/AST.h"
+#include "../Support/Trace.h"
 #include <iostream>
 
+template class StackWalker<IRgen>; // the walk loop lives here, next to the resume functions it inlines
+
+const StructLayouts IRgen::noStructs;
+
 // Generates a new unique temporary variable like "t4"
 int IRgen::nextTemp() {
     std::string name = "t" + std::to_string(tempCount++);
-    return Spool.getOrCreate(name);
+    return Spool.fresh(name);
 }
 
 // Generates a new unique jump target like "L2"
 int IRgen::nextLabel() {
     std::string name = "L" + std::to_string(labelCount++);
-    return Spool.getOrCreate(name);
+    return Spool.fresh(name);
+}
+
+// literal values go in as they are, no dedup since every literal is its own LOAD_CONST anyway
+int IRgen::addConstant(const Constant& value) {
+    constants.push_back(value);
+    return (int)constants.size() - 1;
+}
+
+int IRgen::intConstant(int64_t value) {
+    auto it = intConstants.find(value);
+    if (it != intConstants.end()) return it->second;
+    int id = addConstant(Constant::integer(value));
+    intConstants[value] = id;
+    return id;
+}
+
+static std::string constantText(const Constant& c) {
+    if (c.type == TokenType::Double) return std::to_string(c.d);
+    if (c.type == TokenType::Char) {
+        if (c.i >= 32 && c.i < 127) return std::string("'") + (char)c.i + "'";
+        return "char " + std::to_string(c.i);
+    }
+    return std::to_string(c.i);
 }
 
 // print everything out
@@ -56,11 +84,12 @@ void IRgen::Dump() {
         case IROp::LOAD:   std::cout << safeName(q.res) << " = LOAD " << safeName(q.arg1); break;
         case IROp::STORE:  std::cout << "STORE " << safeName(q.res) << " <- " << safeName(q.arg1) << " (size: " << q.arg2 << ")"; break;
         case IROp::LOAD_CONST:
-            std::cout << safeName(q.res) << " = CONST (" << safeName(q.arg1) << ")";
+            std::cout << safeName(q.res) << " = CONST (" << constantText(constants[q.arg1]) << ")";
             break;
         case IROp::ALLOC: {
-            int stride = (q.arg2 == -1) ? 8 : q.arg2; // Standard size is 8
-            int count = (q.arg1 == -1) ? 1 : q.arg1;
+            // an array is count x element size, a variable or struct is one of its size (arg2 = -1)
+            int stride = (q.arg2 == -1) ? q.arg1 : q.arg2;
+            int count = (q.arg2 == -1) ? 1 : q.arg1;
             std::cout << safeName(q.res) << " ALLOC total_size=" << (count * stride)
                 << " (" << count << " x " << stride << " bytes)";
             break;
@@ -98,51 +127,66 @@ void Error(int line, int col, const std::string& message){
     std::cout << message << line << col << std::endl;
 }
 
-void IRgen::visit(ProgramNode* node)  {
-    for (auto* decl : node->declarations) {
-        if (decl) decl->accept(this);
+// every resume emits what comes before its next child and hands it to pending(), returning it only if the walker
+// has to take it, nullptr once the node is done (see StackWalker.h). a child's value is in lastResultId after it
+ASTNode* IRgen::resume(ProgramNode* node, WalkFrame& frame) {
+    while (frame.step < node->declarations.size()) {
+        ASTNode* decl = node->declarations[frame.step++];
+        if (pending(decl)) return decl;
     }
+    return nullptr;
 }
-void IRgen::visit(BlockNode* node)  {
-    for (auto* statement : node->statements) {
-        if (statement) { statement->accept(this); }
+ASTNode* IRgen::resume(BlockNode* node, WalkFrame& frame) {
+    while (frame.step < node->statements.size()) {
+        ASTNode* statement = node->statements[frame.step++];
+        if (pending(statement)) return statement;
     }
+    return nullptr;
 }
 
-void IRgen::visit(StructDeclNode* node) {
- // blank to satisfy linker
+ASTNode* IRgen::resume(StructDeclNode*, WalkFrame&) {
+    return nullptr; // blank to satisfy linker
 }
 
 // if statement
-void IRgen::visit(IfStatementNode* node) {
-    if (!node->condition) return;
-
-    // 1. Evaluate the condition
-    node->condition->accept(this);
-    int condResult = this->lastResultId;
-
-    // Create our "Bookmarker" Labels
-    int elseLabel = nextLabel(); // Where the else starts
-    int endLabel = nextLabel();  // Where the whole IF ends
-
-    // The Fork: If condition is false, skip to else
-    emit(IROp::IF_FALSE_GOTO, elseLabel, condResult, -1);
-
-    //  The "Then" Branch
-    if (node->thenBranch) {
-        node->thenBranch->accept(this);
+ASTNode* IRgen::resume(IfStatementNode* node, WalkFrame& frame) {
+    int& elseLabel = frame.saved[0];
+    int& endLabel = frame.saved[1];
+    switch (frame.step) {
+    case 0:
+        if (!node->condition) return nullptr;
+        // 1. Evaluate the condition
+        frame.step = 1;
+        if (pending(node->condition)) return node->condition;
+        [[fallthrough]];
+    case 1: {
+        int condResult = this->lastResultId;
+
+        // Create our "Bookmarker" Labels
+        elseLabel = nextLabel(); // Where the else starts
+        endLabel = nextLabel();  // Where the whole IF ends
+
+        // The Fork: If condition is false, skip to else
+        emit(IROp::IF_FALSE_GOTO, elseLabel, condResult, -1);
+
+        //  The "Then" Branch
+        frame.step = 2;
+        if (pending(node->thenBranch)) return node->thenBranch;
     }
-
-    // The Escape: After 'then', jump to the very end
-    emit(IROp::JUMP, endLabel, -1, -1);
-
-    // The Else Branch
-    emit(IROp::LABEL, elseLabel, -1, -1); // Mark the start of Else
-    if (node->elseBranch) {
-        node->elseBranch->accept(this);
+        [[fallthrough]];
+    case 2:
+        // The Escape: After 'then', jump to the very end
+        emit(IROp::JUMP, endLabel, -1, -1);
+
+        // The Else Branch
+        emit(IROp::LABEL, elseLabel, -1, -1); // Mark the start of Else
+        frame.step = 3;
+        if (pending(node->elseBranch)) return node->elseBranch;
+        [[fallthrough]];
+    default:
+        emit(IROp::LABEL, endLabel, -1, -1); // Mark the end of the IF
+        return nullptr;
     }
-    
-    emit(IROp::LABEL, endLabel, -1, -1); // Mark the end of the IF
 }
 
 IROp IRgen::opConvert(TokenType op) {
@@ -177,6 +221,8 @@ IROp IRgen::opConvert(TokenType op) {
     { return IROp::AND; }
     case TokenType::OpOr:
     { return IROp::OR; }
+    default:
+    { return IROp::NOP; }
     }
 }
 
@@ -194,83 +240,95 @@ struct Quad {
 };*/
 // 	std::vector <Quad> instructions;
 // while statement
-void IRgen::visit(WhileStatementNode* node) {
-    if (!node->condition) return;
-
-    // Create the location stamps
-    int startLabel = nextLabel(); // Top of the loop
-    int endLabel = nextLabel();   // Past the loop
-
-    // Mark the Start
-    emit(IROp::LABEL, startLabel, -1, -1);
-
-    // Evaluate the condition
-    node->condition->accept(this);
-    int condResult = this->lastResultId;
-
-    // The Exit: If condition is 0, leave the loop
-    emit(IROp::IF_FALSE_GOTO, endLabel, condResult, -1);
-
-    // Run the body
-    if (node->body) {
-        node->body->accept(this);
+ASTNode* IRgen::resume(WhileStatementNode* node, WalkFrame& frame) {
+    int& startLabel = frame.saved[0];
+    int& endLabel = frame.saved[1];
+    switch (frame.step) {
+    case 0:
+        if (!node->condition) return nullptr;
+
+        // Create the location stamps
+        startLabel = nextLabel(); // Top of the loop
+        endLabel = nextLabel();   // Past the loop
+
+        // Mark the Start
+        emit(IROp::LABEL, startLabel, -1, -1);
+
+        // Evaluate the condition
+        frame.step = 1;
+        if (pending(node->condition)) return node->condition;
+        [[fallthrough]];
+    case 1: {
+        int condResult = this->lastResultId;
+
+        // The Exit: If condition is 0, leave the loop
+        emit(IROp::IF_FALSE_GOTO, endLabel, condResult, -1);
+
+        // Run the body
+        frame.step = 2;
+        if (pending(node->body)) return node->body;
     }
+        [[fallthrough]];
+    default:
+        //  The Loop-back: Jump to the Start LABEL
+        emit(IROp::JUMP, startLabel, -1, -1);
 
-    //  The Loop-back: Jump to the Start LABEL
-    emit(IROp::JUMP, startLabel, -1, -1);
-
-    // Mark the End
-    emit(IROp::LABEL, endLabel, -1, -1);
+        // Mark the End
+        emit(IROp::LABEL, endLabel, -1, -1);
+        return nullptr;
+    }
 }
 // return statement
-void IRgen::visit(ReturnStatementNode* node) {
+ASTNode* IRgen::resume(ReturnStatementNode* node, WalkFrame& frame) {
+    if (frame.step == 0) {
+        // Calculate the math/expression first
+        frame.step = 1;
+        if (pending(node->value)) return node->value;
+    }
     int returnValId = -1; // Default for "void" returns
-
     if (node->value) {
-        // Calculate the math/expression first
-        node->value->accept(this);
         // Grab the result from the "Clipboard"
         returnValId = this->lastResultId;
     }
 
     // Emit the RET instruction with the actual value ID
     emit(IROp::RET, -1, returnValId, -1);
+    return nullptr;
 }
 
 // function
-void IRgen::visit(FunctionDeclNode* node)  {
-    std::string FName = { node->name.data, node->name.size };
-    int funcID = Spool.getOrCreate(FName);
-    emit(IROp::LABEL, funcID, -1, -1);
-    // go thorugh params
-    for (auto& param : node->parameters) {
-        auto type = std::get<0>(param);
-        auto name = std::get<1>(param);
-        // param id
-        int paramID = Spool.getOrCreate(std::string{ name.data, name.size });
-        emit(IROp::PARAM, paramID, -1, -1);
-    }
-    if (node->body) {
-        node->body->accept(this);
+ASTNode* IRgen::resume(FunctionDeclNode* node, WalkFrame& frame)  {
+    if (frame.step == 0) {
+        frame.step = 1;
+        int funcID = Spool.symbol(node->name);
+        emit(IROp::LABEL, funcID, -1, -1);
+        // go thorugh params
+        for (auto& param : node->parameters) {
+            // param id
+            int paramID = Spool.symbol(param.name);
+            emit(IROp::PARAM, paramID, -1, -1);
+        }
+        BlockNode* body = node->getBody();
+        if (pending(body)) return body;
     }
     emit(IROp::RET, -1, -1, -1); // default to save user if they forgot on ein body
+    return nullptr;
 }
 
-void IRgen::visit(VarDeclNode* node) {
-    std::string varName = { node->name.data, node->name.size };
-    int varID = Spool.getOrCreate(varName);
+ASTNode* IRgen::resume(VarDeclNode* node, WalkFrame& frame) {
+    if (frame.step == 0) {
+        frame.step = 1;
+        if (pending(node->initializer)) return node->initializer;
+    }
+    int varID = Spool.symbol(node->name);
 
-    int size = 8; // Default: not a struct (or standard 1-slot)
+    int size = structLayouts->primitiveSize(node->type); // Default: not a struct (a slot, or its own size under --layout natural/packed)
 
     if (node->type == TokenType::Struct) {
-        auto it = structRegistry->find(node->structTypeName);
-        if (it != structRegistry->end()) {
-            size = it->second->totalSize;
-        }
+        size = structLayouts->sizeOf(node->structTypeName.id, 8);
     }
 
     if (node->initializer) {
-        node->initializer->accept(this);
         int initVal = this->lastResultId;
         // for mat emit ( IROp command, variable ID, size of variable, init value so -1 means none)
         // arg1 = value, arg2 = size metadata
@@ -281,91 +339,140 @@ void IRgen::visit(VarDeclNode* node) {
         // No value (arg1 = -1), but we still pass the size (arg2)
         emit(IROp::ALLOC, varID, size, -1);
     }
+    return nullptr;
 }
 
-// variable assignment
-void IRgen::visit(AssignmentNode* node) {
-    // 1. Evaluate the Right-Hand Side (The Value)
-    node->value->accept(this);
-    int sourceValReg = this->lastResultId;
-
-    node->target->accept(this);
-    int destAddr = this->lastResultId;
-
-    int size = 8;
-
-    // Emit the store
-    emit(IROp::STORE, destAddr, sourceValReg, size);
-
-    // Pass value
-    this->lastResultId = sourceValReg;
+// bytes a store into target writes: a primitive struct member is as wide as its layout made it, a char or bool
+// as wide as the layout mode makes it, the rest is a slot
+int IRgen::storeSize(ExpressionNode* target) {
+    if (target->kind != NodeKind::MemberAccess) return structLayouts->valueSize(target->resolvedType);
+    auto* access = static_cast<MemberAccessNode*>(target);
+    const StructLayout* layout = structLayouts->ofType(access->structExpr->resolvedType);
+    const MemberLayout* member = layout ? layout->member(access->memberName) : nullptr;
+    return member && member->type != TokenType::Struct ? member->size : 8;
 }
-void IRgen::visit(ArrayDeclNode* node) {
 
-    std::string arrayName = { node->name.data, node->name.size };
-    int arrayID = Spool.getOrCreate(arrayName);
-
-    // We need to pass the size to the backend.
-    int numElements = node->size;
-    int elementSize = 8; // Everything is 8 bytes in this wonky world
-    if (node->type == TokenType::Struct) {
-        auto it = structRegistry->find(node->structTypeName);
-        elementSize = it->second->totalSize;
-        std::cout << elementSize << std::endl << std::endl;
+// variable assignment
+ASTNode* IRgen::resume(AssignmentNode* node, WalkFrame& frame) {
+    int& sourceValReg = frame.saved[0];
+    switch (frame.step) {
+    case 0:
+        // 1. Evaluate the Right-Hand Side (The Value)
+        frame.step = 1;
+        if (pending(node->value)) return node->value;
+        [[fallthrough]];
+    case 1:
+        sourceValReg = this->lastResultId;
+        frame.step = 2;
+        if (pending(node->target)) return node->target;
+        [[fallthrough]];
+    default: {
+        int destAddr = this->lastResultId;
+
+        int size = storeSize(node->target);
+
+        // Emit the store
+        emit(IROp::STORE, destAddr, sourceValReg, size);
+
+        // Pass value
+        this->lastResultId = sourceValReg;
+        return nullptr;
     }
+    }
+}
+ASTNode* IRgen::resume(ArrayDeclNode* node, WalkFrame& frame) {
+    int& arrayID = frame.saved[0];
+    if (frame.step == 0) {
+        arrayID = Spool.symbol(node->name);
+
+        // We need to pass the size to the backend.
+        int numElements = node->size;
+        int elementSize = structLayouts->primitiveSize(node->type); // 8 bytes in this wonky world, unless the layout mode says otherwise
+        if (node->type == TokenType::Struct) {
+            elementSize = structLayouts->sizeOf(node->structTypeName.id, 8);
+            TRACE_LOG(IRgen, 1, "array '" << std::string(node->name.data, node->name.size) << "' element size " << elementSize);
+        }
 
-    // Emit the ALLOC instruction
-    emit(IROp::ALLOC, arrayID, numElements, elementSize);
-
-
+        // Emit the ALLOC instruction
+        emit(IROp::ALLOC, arrayID, numElements, elementSize);
+    }
+    else {
+        // the initializer just evaluated goes into its slot
+        int valueReg = this->lastResultId;
+        emit(IROp::STORE, arrayID, (int)frame.step - 1, valueReg);
+    }
 
-    // If there are are initlizaers
-    if (!node->initializers.empty()) {
-        for (int i = 0; i < node->initializers.size(); ++i) {
-            // Evaluate the initializer expression
-            node->initializers[i]->accept(this);
-            int valueReg = this->lastResultId;
-            emit(IROp::STORE, arrayID, i, valueReg);
-        }
+    // If there are are initlizaers, evaluate the next one
+    while (frame.step < node->initializers.size()) {
+        ASTNode* init = node->initializers[frame.step++];
+        if (pending(init)) return init;
+        emit(IROp::STORE, arrayID, (int)frame.step - 1, this->lastResultId);
     }
+    return nullptr;
 }
-void IRgen::visit(ExpressionStatementNode* node)  {
-    node->expression->accept(this);
-    this->nextLabel();
+ASTNode* IRgen::resume(ExpressionStatementNode* node, WalkFrame& frame)  {
+    return next(frame, { node->expression });
 }
-void IRgen::visit(LiteralNode* node) {
-
-
-    std::string valueStr = { node->getName().data, node->getName().size };
-
-
-    // std::cout << "DEBUG: Literal value is '" << valueStr << "' length: " << node->getName().size << "\n";
-    std::cout << "DEBUG: Literal Name Size: " << node->getName().size << std::endl;
-    int valueID = Spool.getOrCreate(valueStr);
+ASTNode* IRgen::resume(LiteralNode* node, WalkFrame&) {
+    TRACE_LOG(IRgen, 2, "literal " << constantText(node->value));
+    int valueID = addConstant(node->value);
     int targetReg = nextTemp();
 
     emit(IROp::LOAD_CONST, targetReg, valueID, -1);
     this->lastResultId = targetReg;
+    return nullptr;
 }
 
 // this->lastResultId = Spool.getOrCreate({ node->getName().data, node->getName().size });
-void IRgen::visit(BinaryOpNode* node) {
+ASTNode* IRgen::resume(BinaryOpNode* node, WalkFrame& frame) {
     // 1. Handle Short-Circuiting Logical Operators
     if (node->op == TokenType::OpAnd || node->op == TokenType::OpOr) {
-        int resultReg = nextTemp();
-        int skipLabel = nextLabel();
-        int endLabel = nextLabel();
+        int& resultReg = frame.saved[0];
+        int& skipLabel = frame.saved[1];
+        int& endLabel = frame.saved[2];
+        switch (frame.step) {
+        case 0:
+            resultReg = nextTemp();
+            skipLabel = nextLabel();
+            endLabel = nextLabel();
+
+            // Evaluate the Left side
+            frame.step = 1;
+            if (pending(node->left)) return node->left;
+            [[fallthrough]];
+        case 1: {
+            int leftVal = this->lastResultId;
+            frame.step = 2;
+
+            if (node->op == TokenType::OpAnd) {
+                // Logical AND: If Left is FALSE, jump to skipLabel (set to 0)
+                emit(IROp::IF_FALSE_GOTO, skipLabel, leftVal, -1);
+
+                // Evaluate the Right side
+                if (pending(node->right)) return node->right;
+                break;
+            }
+            // Logical OR
+            // If Left is TRUE, we skip Right. 
+            // reuse IF_FALSE by jumping to evalRight if false, 
+            // otherwise set result to 1 and jump to end.
+            int evalRightLabel = nextLabel();
+            emit(IROp::IF_FALSE_GOTO, evalRightLabel, leftVal, -1);
 
-        // Evaluate the Left side
-        node->left->accept(this);
-        int leftVal = this->lastResultId;
+            // Left was True: Set result to 1 and jump to end
+            int oneID = intConstant(1);
+            int oReg = nextTemp();
+            emit(IROp::LOAD_CONST, oReg, oneID, -1);
+            emit(IROp::ASSIGN, resultReg, -1, oReg);
+            emit(IROp::JUMP, endLabel, -1, -1);
 
-        if (node->op == TokenType::OpAnd) {
-            // Logical AND: If Left is FALSE, jump to skipLabel (set to 0)
-            emit(IROp::IF_FALSE_GOTO, skipLabel, leftVal, -1);
+            // Left was False: Eval right
+            emit(IROp::LABEL, evalRightLabel, -1, -1);
+            if (pending(node->right)) return node->right;
+        }
+        }
 
-            // Evaluate the Right side
-            node->right->accept(this);
+        if (node->op == TokenType::OpAnd) {
             int rightVal = this->lastResultId;
 
             // Result is just whatever Right is (since Left was true)
@@ -374,41 +481,32 @@ void IRgen::visit(BinaryOpNode* node) {
 
             // Skip Path: Set result to 0
             emit(IROp::LABEL, skipLabel, -1, -1);
-            int zeroID = Spool.getOrCreate("0");
+            int zeroID = intConstant(0);
             int zReg = nextTemp();
             emit(IROp::LOAD_CONST, zReg, zeroID, -1);
             emit(IROp::ASSIGN, resultReg, -1, zReg);
         }
-        else { // Logical OR
-            // If Left is TRUE, we skip Right. 
-            // reuse IF_FALSE by jumping to evalRight if false, 
-            // otherwise set result to 1 and jump to end.
-            int evalRightLabel = nextLabel();
-            emit(IROp::IF_FALSE_GOTO, evalRightLabel, leftVal, -1);
-
-            // Left was True: Set result to 1 and jump to end
-            int oneID = Spool.getOrCreate("1");
-            int oReg = nextTemp();
-            emit(IROp::LOAD_CONST, oReg, oneID, -1);
-            emit(IROp::ASSIGN, resultReg, -1, oReg);
-            emit(IROp::JUMP, endLabel, -1, -1);
-
-            // Left was False: Eval right
-            emit(IROp::LABEL, evalRightLabel, -1, -1);
-            node->right->accept(this);
+        else {
             emit(IROp::ASSIGN, resultReg, -1, this->lastResultId);
         }
 
         emit(IROp::LABEL, endLabel, -1, -1);
         this->lastResultId = resultReg;
-        return;
+        return nullptr;
     }
 
     // 2. Handle Standard Arithmetic/Comparison Operators
-    node->left->accept(this);
-    int leftReg = this->lastResultId;
-
-    node->right->accept(this);
+    int& leftReg = frame.saved[0];
+    switch (frame.step) {
+    case 0:
+        frame.step = 1;
+        if (pending(node->left)) return node->left;
+        [[fallthrough]];
+    case 1:
+        leftReg = this->lastResultId;
+        frame.step = 2;
+        if (pending(node->right)) return node->right;
+    }
     int rightReg = this->lastResultId;
 
     int resultReg = nextTemp();
@@ -416,10 +514,14 @@ void IRgen::visit(BinaryOpNode* node) {
     emit(Lop, resultReg, leftReg, rightReg);
 
     this->lastResultId = resultReg;
+    return nullptr;
 }
 
-void IRgen::visit(UnaryOpNode* node)  {
-    node->expression->accept(this);
+ASTNode* IRgen::resume(UnaryOpNode* node, WalkFrame& frame)  {
+    if (frame.step == 0) {
+        frame.step = 1;
+        if (pending(node->expression)) return node->expression;
+    }
     int leftReg = this->lastResultId;
     int resultReg = nextTemp();
     if (opConvert(node->op) == IROp::NOT) {
@@ -430,33 +532,39 @@ void IRgen::visit(UnaryOpNode* node)  {
     }
     // pass it up
     this->lastResultId = resultReg;
+    return nullptr;
 }
 
-void IRgen::visit(VariableExprNode* node)  {
-    std::string name = { node->getName().data, node->getName().size };
-    int nameID = Spool.getOrCreate(name);
+ASTNode* IRgen::resume(VariableExprNode* node, WalkFrame&)  {
+    int nameID = Spool.symbol(node->name);
     int targetReg = nextTemp();
     emit(IROp::LOAD, targetReg, nameID, -1);
     this->lastResultId = targetReg;
+    return nullptr;
 }
-void IRgen::visit(ArrayIndexNode* node) {
-    // 1. Get the base address of the array (e.g., 'arr' in 'arr[i]')
-    node->base->accept(this);
-    int baseAddr = this->lastResultId;
-
-    // 2. Get the index value (e.g., 'i')
-    node->index->accept(this);
+ASTNode* IRgen::resume(ArrayIndexNode* node, WalkFrame& frame) {
+    int& baseAddr = frame.saved[0];
+    switch (frame.step) {
+    case 0:
+        // 1. Get the base address of the array (e.g., 'arr' in 'arr[i]')
+        frame.step = 1;
+        if (pending(node->base)) return node->base;
+        [[fallthrough]];
+    case 1:
+        baseAddr = this->lastResultId;
+        // 2. Get the index value (e.g., 'i')
+        frame.step = 2;
+        if (pending(node->index)) return node->index;
+    }
     int indexReg = this->lastResultId;
 
     // 3. Calculate the byte offset (Offset = index * 8)
     int offsetReg = nextTemp();
     
-    int sizeID = Spool.getOrCreate("8"); // Assuming 8-byte slots
+    int sizeID = intConstant(structLayouts->valueSize(node->resolvedType)); // 8-byte slots, a char or bool by the layout mode
 
-    if (node->resolvedStructName.data != nullptr) {
-        auto size = structRegistry->find(node->resolvedStructName);
-        StructDeclNode* blueprint = size->second;
-        sizeID = Spool.getOrCreate(std::to_string(blueprint->totalSize));
+    if (const StructLayout* layout = structLayouts->ofType(node->resolvedType)) {
+        sizeID = intConstant(layout->totalSize);
     }
 
     int eightReg = nextTemp();
@@ -470,65 +578,66 @@ void IRgen::visit(ArrayIndexNode* node) {
 
     // Pass it up
     this->lastResultId = finalAddr;
+    return nullptr;
 }
-void IRgen::visit(MemberAccessNode* node) {
+ASTNode* IRgen::resume(MemberAccessNode* node, WalkFrame& frame) {
     // base address
-    node->structExpr->accept(this);
+    if (frame.step == 0) {
+        frame.step = 1;
+        if (pending(node->structExpr)) return node->structExpr;
+    }
     int baseAddr = this->lastResultId;
 
-    // 2. Look up the blueprint using the name SAnalyzer "stamped" on the expression
-    auto it = structRegistry->find(node->structExpr->resolvedStructName);
-    StructDeclNode* blueprint = it->second;
-
-    int offset = 0;
-    // Walk the members to find the target and sum the sizes of preceding members
-    for (auto& member : blueprint->members) {
-        if (member.name == node->memberName) {
-            break;
-        }
-
-        // If this preceding member is a struct, we need its full size
-        if (member.type == TokenType::Struct) {
-            auto nested = structRegistry->find(member.structTypeName);
-            offset += (nested != structRegistry->end()) ? nested->second->totalSize : 8;
-        }
-        else {
-            offset += 8; // Simple types are always 8
-        }
+    // 2. Look up the layout of the type SAnalyzer "stamped" on the expression
+    const StructLayout* layout = structLayouts->ofType(node->structExpr->resolvedType);
+    if (!layout) { // SAnalyzer already complained (or BaJav mode let it through)
+        this->lastResultId = baseAddr;
+        return nullptr;
     }
 
+    // 3. The member's offset was worked out with the layout, a missing one (BaJav) lands just past the struct
+    const MemberLayout* member = layout->member(node->memberName);
+    int offset = member ? member->offset : layout->totalSize;
+
     // 4. Resulting Address = Base + Offset
-    int memberAddr = nextTemp();
-    int offsetConstId = Spool.getOrCreate(std::to_string(offset));
+    int offsetReg = nextTemp();
+    emit(IROp::LOAD_CONST, offsetReg, intConstant(offset), -1);
 
-    emit(IROp::ADD, memberAddr, baseAddr, offsetConstId);
+    int memberAddr = nextTemp();
+    emit(IROp::ADD, memberAddr, baseAddr, offsetReg);
 
     this->lastResultId = memberAddr;
+    return nullptr;
 }
-void IRgen::visit(FunctionCallNode* node) {
-    // Visit arguments first to get their values into registers
-    std::vector<int> argRegisters;
-    for (auto* arg : node->arguments) {
-        arg->accept(this);
-        argRegisters.push_back(this->lastResultId);
+ASTNode* IRgen::resume(FunctionCallNode* node, WalkFrame& frame) {
+    // Visit arguments first to get their values into registers (on argStack, from saved[0] up)
+    if (frame.step == 0) frame.saved[0] = (int)argStack.size();
+    else argStack.push_back(this->lastResultId);
+    while (frame.step < node->arguments.size()) {
+        ASTNode* arg = node->arguments[frame.step++];
+        if (pending(arg)) return arg;
+        argStack.push_back(this->lastResultId);
     }
+    int first = frame.saved[0];
+    int count = (int)argStack.size() - first;
 
     // Emit PARAM instructions for each argument
-    for (int i = 0; i < argRegisters.size(); ++i) {
+    for (int i = 0; i < count; ++i) {
         // res: the value, arg1: the argument index (optional but helpful)
-        emit(IROp::PARAM, argRegisters[i], i, -1);
+        emit(IROp::PARAM, argStack[first + i], i, -1);
     }
+    argStack.resize(first);
 
     // Get the function name (callee)
-    std::string funcName = { node->callee->getName().data, node->callee->getName().size };
-    int funcID = Spool.getOrCreate(funcName);
+    int funcID = Spool.symbol(node->callee->getName());
 
     //  Create a register for the return value
     int returnReg = nextTemp();
 
     //  Emit the CALL instruction
-    emit(IROp::CALL, returnReg, funcID, (int)argRegisters.size());
+    emit(IROp::CALL, returnReg, funcID, count);
 
     //  Pass the return value up the tree
     this->lastResultId = returnReg;
+    return nullptr;
 }
\ No newline at end of file
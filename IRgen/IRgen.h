@@ -2,8 +2,11 @@
 
 #include <vector>
 #include "../SAnalyzer/HashTables.h"
-#include "../SAnalyzer/Visitor.h"
+#include "../SAnalyzer/StructLayout.h"
+#include "../SAnalyzer/StackWalker.h"
+#include "../SAnalyzer/FlatWalker.h"
 #include "../Parser/AST.h"
+#include "../Parser/FlatAST.h"
 
 enum class IROp {
     // Math
@@ -40,54 +43,99 @@ struct Quad {
     int res;   // Where the result goes (the temporary)
 };
 
+// operand names for the IR
+// ids below base are the lexer's symbol ids, so a source name is its own operand id and never gets hashed here,
+// everything IRgen makes up itself (temps, labels) is numbered after them, constants have their own table in IRgen
 class StringPool {
+    const Interner* names;
+    int base;
     std::vector<std::string> pool;
-    std::unordered_map<std::string, int> lookup;
+    std::unordered_map<std::string, int> lookup; // leftover non-identifier names only, temps and labels are unique anyway
 public:
+    StringPool(const Interner& symbols) : names(&symbols), base((int)symbols.size()) {}
+    int symbol(const StringView& name) {
+        if (name.id != NoSymbol) return (int)name.id;
+        return getOrCreate(std::string(name.data ? name.data : "", name.size)); // not an identifier (shouldn't happen)
+    }
+    int fresh(std::string name) {
+        pool.push_back(name);
+        return base + (int)pool.size() - 1;
+    }
     int getOrCreate(std::string name) {
-        if (lookup.count(name)) return lookup[name];
-        int id = pool.size();
+        auto it = lookup.find(name);
+        if (it != lookup.end()) return it->second;
+        int id = fresh(name);
         lookup[name] = id;
-        pool.push_back(name);
         return id;
     }
-    std::string getName(int id) { return pool[id]; }
+    std::string getName(int id) {
+        if (id < base) return std::string(names->text(id), names->length(id));
+        return pool[id - base];
+    }
 };
 
-class IRgen : public Visitor{
+// same as SAnalyzer: walks with StackWalker::walk (a flat program with FlatWalker's), accept() is only there for
+// callers that want it
+class IRgen final : public StackWalker<IRgen>, public FlatWalker<IRgen> {
+    friend class StackWalker<IRgen>;
+    friend class FlatWalker<IRgen>;
+    using StackWalker<IRgen>::pending;
+    using FlatWalker<IRgen>::pending;
+    using StackWalker<IRgen>::next;
+    using FlatWalker<IRgen>::next;
 private:
     int labelCount = 0; 
     int tempCount = 0;  
     int lastResultId = -1; 
-    const std::unordered_map<StringView, StructDeclNode*, StringViewHasher>* structRegistry;
+    const StructLayouts* structLayouts; // sizes and member offsets, from SAnalyzer::getStructLayouts
+    std::unordered_map<int64_t, int> intConstants; // the ints IRgen makes up itself (0, 1, sizes, offsets), shared
+    const FlatAST* flat = nullptr; // the flat program generate() is working on ( FlatIRgen.cpp )
+    NodeRef resume(FlatFrame& frame); // any flat node ( FlatIRgen.cpp )
+    int flatStructSize(uint32_t name, int fallback);
+    int storeSize(ExpressionNode* target);
+    std::vector<int> argStack; // call arguments' registers until the CALL, nested calls stack on top
+    // one node's share of the walk, see StackWalker.h
+    ASTNode* resume(ProgramNode* node, WalkFrame& frame);
+    ASTNode* resume(BlockNode* node, WalkFrame& frame);
+    ASTNode* resume(IfStatementNode* node, WalkFrame& frame);
+    ASTNode* resume(WhileStatementNode* node, WalkFrame& frame);
+    ASTNode* resume(ReturnStatementNode* node, WalkFrame& frame);
+    ASTNode* resume(FunctionDeclNode* node, WalkFrame& frame);
+    ASTNode* resume(VarDeclNode* node, WalkFrame& frame);
+    ASTNode* resume(StructDeclNode* node, WalkFrame& frame);
+    ASTNode* resume(AssignmentNode* node, WalkFrame& frame);
+    ASTNode* resume(ArrayDeclNode* node, WalkFrame& frame);
+    ASTNode* resume(ExpressionStatementNode* node, WalkFrame& frame);
+    ASTNode* resume(LiteralNode* node, WalkFrame& frame);
+    ASTNode* resume(BinaryOpNode* node, WalkFrame& frame);
+    ASTNode* resume(UnaryOpNode* node, WalkFrame& frame);
+    ASTNode* resume(VariableExprNode* node, WalkFrame& frame);
+    ASTNode* resume(ArrayIndexNode* node, WalkFrame& frame);
+    ASTNode* resume(MemberAccessNode* node, WalkFrame& frame);
+    ASTNode* resume(FunctionCallNode* node, WalkFrame& frame);
 public:
+    using StackWalker<IRgen>::walk;
+    using FlatWalker<IRgen>::walk;
     StringPool Spool;
     std::vector <Quad> instructions;
-    IRgen(const std::unordered_map<StringView, StructDeclNode*, StringViewHasher>& registry)
-        : structRegistry(&registry) {
+    std::vector<Constant> constants; // LOAD_CONST's arg1 is an index in here, not a string
+    IRgen(const StructLayouts& layouts, const Interner& names)
+        : structLayouts(&layouts), Spool(names) {
     }
+    // for flat programs only, the struct table comes from the FlatAST then
+    explicit IRgen(const Interner& names) : structLayouts(&noStructs), Spool(names) {}
+    static const StructLayouts noStructs;
+    // IR for a flat program that SAnalyzer::analyze already went over
+    void generate(const FlatAST& ast);
     int nextTemp();
     int nextLabel();
+    int addConstant(const Constant& value);
+    int intConstant(int64_t value);
     void emit(IROp op, int res, int arg1, int arg2);
     void Error(int line, int col, const std::string& message);
-    void visit(ProgramNode* node) override;
-    void visit(BlockNode* node) override;
-    void visit(IfStatementNode* node) override;
-    void visit(WhileStatementNode* node) override;
-    void visit(ReturnStatementNode* node) override;
-    void visit(FunctionDeclNode* node) override;
-    void visit(VarDeclNode* node) override;
-    void visit(StructDeclNode* node) override;
-    void visit(AssignmentNode* node) override;
-    void visit(ArrayDeclNode* node) override;
-    void visit(ExpressionStatementNode* node) override;
-    void visit(LiteralNode* node) override;
-    void visit(BinaryOpNode* node) override;
-    void visit(UnaryOpNode* node) override;
-    void visit(VariableExprNode* node) override;
-    void visit(ArrayIndexNode* node) override;
-    void visit(MemberAccessNode* node) override;
-    void visit(FunctionCallNode* node) override;
     IROp opConvert(TokenType op);
     void Dump();
-};
\ No newline at end of file
+};
+
+extern template class StackWalker<IRgen>; // instantiated in IRgen.cpp
+extern template class FlatWalker<IRgen>; // instantiated in FlatIRgen.cpp
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+/*
+	Decoded literal values
+	the lexer turns every number and char literal into its value right away, the token only keeps an index into
+	this pool (Token::payload, with TF_Literal set), so nobody after the lexer parses digits or allocates strings for them
+	chars are stored as their (unsigned) code in i
+*/
+#include "Token.h"
+#include <cstdint>
+#include <vector>
+
+struct Constant {
+	TokenType type; // Integer, Double or Char
+	union {
+		int64_t i;
+		double d;
+	};
+	static Constant integer(int64_t v) { Constant c; c.type = TokenType::Integer; c.i = v; return c; }
+	static Constant real(double v) { Constant c; c.type = TokenType::Double; c.d = v; return c; }
+	static Constant character(int64_t v) { Constant c; c.type = TokenType::Char; c.i = v; return c; }
+};
+
+class ConstantPool {
+	std::vector<Constant> values;
+public:
+	uint32_t add(const Constant& c) {
+		values.push_back(c);
+		return (uint32_t)(values.size() - 1);
+	}
+	void pop() { values.pop_back(); }
+	const Constant& operator[](uint32_t index) const { return values[index]; }
+	uint32_t size() const { return (uint32_t)values.size(); }
+	// appends another pool (parallel lexing), returns where its first entry landed
+	uint32_t append(const ConstantPool& other) {
+		uint32_t base = size();
+		values.insert(values.end(), other.values.begin(), other.values.end());
+		return base;
+	}
+};
@@ -0,0 +1,81 @@
+#pragma once
+/*
+	Identifier interner
+	the lexer hands every identifier it finds to intern() once, equal spellings get the same dense id (0, 1, 2 ..)
+	in the order they first show up. The id rides along on the token and on the AST StringViews, so sema and
+	irgen key their tables by integer and never look at (or hash) the characters again
+
+	the interner doesn't copy anything, entries point into the source buffer (the SourceManager keeps it alive)
+*/
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+const uint32_t NoSymbol = UINT32_MAX; // "this name isn't an interned identifier"
+
+class Interner {
+	struct Entry {
+		const char* text;
+		uint32_t length;
+		uint32_t hash;
+	};
+	std::vector<Entry> entries;   // indexed by id
+	std::vector<uint32_t> slots;  // open addressing, id + 1 (0 = empty), size is a power of two
+	uint32_t mask = 0;
+
+	void insertSlot(uint32_t id) {
+		uint32_t i = entries[id].hash & mask;
+		while (slots[i]) i = (i + 1) & mask;
+		slots[i] = id + 1;
+	}
+	void grow();
+public:
+	Interner() { slots.assign(256, 0); mask = 255; }
+
+	static uint32_t hash(const char* text, uint32_t length) {
+		// 8 bytes per step, identifiers are short so this is a couple of multiplies
+		uint64_t h = 0x9E3779B97F4A7C15ull ^ length;
+		while (length >= 8) {
+			uint64_t word;
+			std::memcpy(&word, text, 8);
+			h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+			text += 8;
+			length -= 8;
+		}
+		if (length) {
+			uint64_t word = 0;
+			std::memcpy(&word, text, length);
+			h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+		}
+		// the multiplies only push bits upwards, fold the top back down since the table uses the low bits
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		return (uint32_t)(h ^ (h >> 33));
+	}
+
+	uint32_t intern(const char* text, uint32_t length) { return intern(text, length, hash(text, length)); }
+	uint32_t intern(const char* text, uint32_t length, uint32_t h) {
+		for (uint32_t i = h & mask;; i = (i + 1) & mask) {
+			uint32_t slot = slots[i];
+			if (slot == 0) break;
+			const Entry& e = entries[slot - 1];
+			if (e.hash == h && e.length == length && std::memcmp(e.text, text, length) == 0) return slot - 1;
+		}
+		uint32_t id = (uint32_t)entries.size();
+		entries.push_back({ text, length, h });
+		if (entries.size() * 2 > slots.size()) grow(); // keep it at most half full
+		else insertSlot(id);
+		return id;
+	}
+
+	uint32_t size() const { return (uint32_t)entries.size(); }
+	const char* text(uint32_t id) const { return entries[id].text; }
+	uint32_t length(uint32_t id) const { return entries[id].length; }
+	uint32_t hashOf(uint32_t id) const { return entries[id].hash; }
+};
+
+inline void Interner::grow() {
+	slots.assign(slots.size() * 2, 0);
+	mask = (uint32_t)slots.size() - 1;
+	for (uint32_t id = 0; id < entries.size(); id++) insertSlot(id);
+}
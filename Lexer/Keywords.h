@@ -0,0 +1,103 @@
+#pragma once
+/*
+	Keyword recognition
+	keywordList is the one place keywords are defined, everything else is generated from it at compile time:
+	a perfect hash on (first char, last char, length) that lands every keyword in its own slot, so checking
+	an identifier is one table read plus one memcmp against the source buffer (no std::string, no allocation)
+*/
+#include "Token.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+struct Keyword {
+	const char* text;
+	uint8_t length;
+	TokenType type;
+	constexpr Keyword() : text(""), length(0), type(TokenType::Identifier) {}
+	constexpr Keyword(const char* t, TokenType ty) : text(t), length(0), type(ty) {
+		while (t[length] != '\0') length++;
+	}
+};
+
+inline constexpr Keyword keywordList[] = {
+	{ "def", TokenType::Def },
+	{ "struct", TokenType::Struct },
+	{ "import", TokenType::Import },
+	{ "return", TokenType::Return },
+	{ "if", TokenType::If },
+	{ "else", TokenType::Else },
+	{ "while", TokenType::While },
+	{ "for", TokenType::For },
+	{ "double", TokenType::Double },
+	{ "int", TokenType::Integer },
+	{ "char", TokenType::Char },
+	{ "bool", TokenType::Bool },
+	{ "array", TokenType::List },
+	{ "True", TokenType::Bool },
+	{ "False", TokenType::Bool },
+};
+
+inline constexpr size_t keywordCount = sizeof(keywordList) / sizeof(keywordList[0]);
+
+// table size: smallest power of two with room for twice the keywords
+constexpr size_t keywordTableSizeFor(size_t count) {
+	size_t size = 1;
+	while (size < count * 2) size *= 2;
+	return size;
+}
+inline constexpr size_t keywordTableSize = keywordTableSizeFor(keywordCount);
+
+struct KeywordHashParams {
+	uint32_t firstMul = 0; // 0 = no perfect hash found
+	uint32_t lastMul = 0;
+};
+
+constexpr uint32_t keywordHash(uint8_t first, uint8_t last, size_t length, KeywordHashParams p) {
+	return (uint32_t)(first * p.firstMul + last * p.lastMul + length) & (uint32_t)(keywordTableSize - 1);
+}
+
+// first pair of multipliers that gives every keyword its own slot
+constexpr KeywordHashParams findKeywordHash() {
+	for (uint32_t lastMul = 1; lastMul < 64; lastMul++) {
+		for (uint32_t firstMul = 1; firstMul < 64; firstMul++) {
+			KeywordHashParams p{ firstMul, lastMul };
+			bool used[keywordTableSize] = {};
+			bool ok = true;
+			for (const Keyword& k : keywordList) {
+				uint32_t h = keywordHash((uint8_t)k.text[0], (uint8_t)k.text[k.length - 1], k.length, p);
+				if (used[h]) { ok = false; break; }
+				used[h] = true;
+			}
+			if (ok) return p;
+		}
+	}
+	return KeywordHashParams{};
+}
+inline constexpr KeywordHashParams keywordHashParams = findKeywordHash();
+static_assert(keywordHashParams.firstMul != 0, "no perfect hash for the keyword list, make keywordTableSize bigger");
+
+struct KeywordTable {
+	Keyword slots[keywordTableSize]; // empty slots have length 0 so they never match
+	uint8_t minLength = 255;
+	uint8_t maxLength = 0;
+};
+
+constexpr KeywordTable makeKeywordTable() {
+	KeywordTable t{};
+	for (const Keyword& k : keywordList) {
+		t.slots[keywordHash((uint8_t)k.text[0], (uint8_t)k.text[k.length - 1], k.length, keywordHashParams)] = k;
+		if (k.length < t.minLength) t.minLength = k.length;
+		if (k.length > t.maxLength) t.maxLength = k.length;
+	}
+	return t;
+}
+inline constexpr KeywordTable keywordTable = makeKeywordTable();
+
+// keyword type for the identifier text [s, s + length), or TokenType::Identifier if it is not one
+inline TokenType keywordType(const char* s, size_t length) {
+	if (length < keywordTable.minLength || length > keywordTable.maxLength) return TokenType::Identifier;
+	const Keyword& k = keywordTable.slots[keywordHash((uint8_t)s[0], (uint8_t)s[length - 1], length, keywordHashParams)];
+	if (k.length == length && std::memcmp(k.text, s, length) == 0) return k.type;
+	return TokenType::Identifier;
+}
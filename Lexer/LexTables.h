@@ -0,0 +1,171 @@
+#pragma once
+/*
+	Lookup tables for the lexer
+	every byte gets a character class from one 256 entry table, and tokens are recognized by walking
+	a small state machine over those classes instead of isdigit/isalpha/strchr chains per character
+	everything here is built at compile time so there is no startup cost
+*/
+#include "Token.h"
+#include <cstdint>
+#include <initializer_list>
+
+// character classes, one per byte value
+enum CharClass : uint8_t {
+	CC_End,      // '\0'
+	CC_Space,    // ' ' '\t' '\r'
+	CC_Newline,  // '\n'
+	CC_Digit,    // 0-9
+	CC_Alpha,    // a-z A-Z _
+	CC_Quote,    // '
+	CC_Dot,      // .
+	CC_Punct,    // ( ) { } [ ] , ;
+	CC_Single,   // + - * / %  (operators that are always one character)
+	CC_Eq,       // =
+	CC_Bang,     // !
+	CC_Less,     // <
+	CC_Greater,  // >
+	CC_Amp,      // &
+	CC_Pipe,     // |
+	CC_Hash,     // # (BaJav mode marker)
+	CC_Other,    // anything else is an error
+	CC_Count
+};
+
+// lexer states, LS_Start is only used to pick the first state from the first character
+enum LexState : uint8_t {
+	LS_Start,
+	LS_Ident,
+	LS_Int,
+	LS_IntDot,    // digits followed by '.', fraction not seen yet
+	LS_Frac,
+	LS_Single,    // one character token, type comes from singleType[]
+	LS_Eq, LS_Bang, LS_Less, LS_Greater, LS_Amp, LS_Pipe,
+	LS_EqEq, LS_BangEq, LS_LessEq, LS_GreaterEq, LS_AmpAmp, LS_PipePipe,
+	LS_Count,
+	// special results of the start transition
+	LS_Eof = 0xF0,
+	LS_CharLit,
+	LS_Error,
+	LS_Stop = 0xFF // stop without consuming the current character
+};
+
+struct LexTables {
+	uint8_t charClass[256];
+	uint8_t delta[LS_Count][CC_Count]; // next state, or LS_Stop
+	TokenType acceptType[LS_Count];    // token produced when stopping in a state (UNKNOWN = error)
+	uint8_t acceptBackup[LS_Count];    // characters to give back when stopping (the '.' in "5.x")
+	TokenType singleType[256];         // punctuation and one character operators
+};
+
+constexpr LexTables makeLexTables() {
+	LexTables t{};
+
+	// --- character classes ---
+	for (int c = 0; c < 256; c++) t.charClass[c] = CC_Other;
+	t.charClass[0] = CC_End;
+	t.charClass[(uint8_t)' '] = CC_Space;
+	t.charClass[(uint8_t)'\t'] = CC_Space;
+	t.charClass[(uint8_t)'\r'] = CC_Space;
+	t.charClass[(uint8_t)'\n'] = CC_Newline;
+	for (int c = '0'; c <= '9'; c++) t.charClass[c] = CC_Digit;
+	for (int c = 'a'; c <= 'z'; c++) t.charClass[c] = CC_Alpha;
+	for (int c = 'A'; c <= 'Z'; c++) t.charClass[c] = CC_Alpha;
+	t.charClass[(uint8_t)'_'] = CC_Alpha;
+	t.charClass[(uint8_t)'\''] = CC_Quote;
+	t.charClass[(uint8_t)'.'] = CC_Dot;
+	for (char c : { '(', ')', '{', '}', '[', ']', ',', ';' }) t.charClass[(uint8_t)c] = CC_Punct;
+	for (char c : { '+', '-', '*', '/', '%' }) t.charClass[(uint8_t)c] = CC_Single;
+	t.charClass[(uint8_t)'='] = CC_Eq;
+	t.charClass[(uint8_t)'!'] = CC_Bang;
+	t.charClass[(uint8_t)'<'] = CC_Less;
+	t.charClass[(uint8_t)'>'] = CC_Greater;
+	t.charClass[(uint8_t)'&'] = CC_Amp;
+	t.charClass[(uint8_t)'|'] = CC_Pipe;
+	t.charClass[(uint8_t)'#'] = CC_Hash;
+
+	// --- one character token types ---
+	for (int c = 0; c < 256; c++) t.singleType[c] = TokenType::UNKNOWN;
+	t.singleType[(uint8_t)'('] = TokenType::LParen;
+	t.singleType[(uint8_t)')'] = TokenType::RParen;
+	t.singleType[(uint8_t)'{'] = TokenType::LBrace;
+	t.singleType[(uint8_t)'}'] = TokenType::RBrace;
+	t.singleType[(uint8_t)'['] = TokenType::LBrack;
+	t.singleType[(uint8_t)']'] = TokenType::RBrack;
+	t.singleType[(uint8_t)','] = TokenType::Comma;
+	t.singleType[(uint8_t)';'] = TokenType::Semicolon;
+	t.singleType[(uint8_t)'.'] = TokenType::Dot;
+	t.singleType[(uint8_t)'+'] = TokenType::OpPlus;
+	t.singleType[(uint8_t)'-'] = TokenType::OpMinus;
+	t.singleType[(uint8_t)'*'] = TokenType::OpStar;
+	t.singleType[(uint8_t)'/'] = TokenType::OpSlash;
+	t.singleType[(uint8_t)'%'] = TokenType::OpMod;
+
+	// --- transitions --- (default: stop)
+	for (int s = 0; s < LS_Count; s++)
+		for (int c = 0; c < CC_Count; c++) t.delta[s][c] = LS_Stop;
+
+	// first character
+	t.delta[LS_Start][CC_End] = LS_Eof;
+	t.delta[LS_Start][CC_Quote] = LS_CharLit;
+	t.delta[LS_Start][CC_Other] = LS_Error;
+	t.delta[LS_Start][CC_Hash] = LS_Error;
+	t.delta[LS_Start][CC_Space] = LS_Error;   // whitespace is skipped before the machine runs
+	t.delta[LS_Start][CC_Newline] = LS_Error;
+	t.delta[LS_Start][CC_Alpha] = LS_Ident;
+	t.delta[LS_Start][CC_Digit] = LS_Int;
+	t.delta[LS_Start][CC_Dot] = LS_Single;
+	t.delta[LS_Start][CC_Punct] = LS_Single;
+	t.delta[LS_Start][CC_Single] = LS_Single;
+	t.delta[LS_Start][CC_Eq] = LS_Eq;
+	t.delta[LS_Start][CC_Bang] = LS_Bang;
+	t.delta[LS_Start][CC_Less] = LS_Less;
+	t.delta[LS_Start][CC_Greater] = LS_Greater;
+	t.delta[LS_Start][CC_Amp] = LS_Amp;
+	t.delta[LS_Start][CC_Pipe] = LS_Pipe;
+
+	// identifiers: letters, digits and _
+	t.delta[LS_Ident][CC_Alpha] = LS_Ident;
+	t.delta[LS_Ident][CC_Digit] = LS_Ident;
+
+	// numbers: 12  12.5  and "12." followed by a non digit is still a double (the dot is given back)
+	t.delta[LS_Int][CC_Digit] = LS_Int;
+	t.delta[LS_Int][CC_Dot] = LS_IntDot;
+	t.delta[LS_IntDot][CC_Digit] = LS_Frac;
+	t.delta[LS_Frac][CC_Digit] = LS_Frac;
+
+	// two character operators
+	t.delta[LS_Eq][CC_Eq] = LS_EqEq;
+	t.delta[LS_Bang][CC_Eq] = LS_BangEq;
+	t.delta[LS_Less][CC_Eq] = LS_LessEq;
+	t.delta[LS_Greater][CC_Eq] = LS_GreaterEq;
+	t.delta[LS_Amp][CC_Amp] = LS_AmpAmp;
+	t.delta[LS_Pipe][CC_Pipe] = LS_PipePipe;
+
+	// --- what each state produces ---
+	for (int s = 0; s < LS_Count; s++) t.acceptType[s] = TokenType::UNKNOWN;
+	t.acceptType[LS_Ident] = TokenType::Identifier; // keywords are sorted out after
+	t.acceptType[LS_Int] = TokenType::Integer;
+	t.acceptType[LS_IntDot] = TokenType::Double;
+	t.acceptBackup[LS_IntDot] = 1;
+	t.acceptType[LS_Frac] = TokenType::Double;
+	t.acceptType[LS_Eq] = TokenType::OpAssign;
+	t.acceptType[LS_Less] = TokenType::OpLess;
+	t.acceptType[LS_Greater] = TokenType::OpGreater;
+	t.acceptType[LS_EqEq] = TokenType::OpIsEqual;
+	t.acceptType[LS_BangEq] = TokenType::OpIsNotEqual;
+	t.acceptType[LS_LessEq] = TokenType::OpIsLessEqual;
+	t.acceptType[LS_GreaterEq] = TokenType::OpIsGreaterEqual;
+	t.acceptType[LS_AmpAmp] = TokenType::OpAnd;
+	t.acceptType[LS_PipePipe] = TokenType::OpOr;
+	t.acceptType[LS_Bang] = TokenType::Not;
+	// LS_Amp, LS_Pipe on their own stay UNKNOWN -> "Unknown operator"
+	// LS_Single takes its type from singleType[]
+
+	return t;
+}
+
+inline constexpr LexTables lexTables = makeLexTables();
+
+inline CharClass charClassOf(char c) {
+	return (CharClass)lexTables.charClass[(uint8_t)c];
+}
@@ -1,235 +1,193 @@
 #include "Lexer.h"
-#include <unordered_map>
-#include <string>
-#include <cctype>
+#include "LexTables.h"
+#include "Keywords.h"
+#include "../Support/Trace.h"
+#include "../Support/ThreadPool.h"
+#include <algorithm>
+#include <charconv>
 #include <cstring>
+#include <string>
+#include <string_view>
 #include <iostream>
 
 using namespace std;
 
+Lexer::Lexer(const char* src) : source(src), end(src + strlen(src)), sentinel(true), current(src) {
+    init();
+}
+
+Lexer::Lexer(const char* begin, const char* end) : source(begin), end(end), sentinel(false), current(begin) {
+    init();
+}
+
+Lexer::Lexer(const SourceFile& file) : source(file.data), end(file.data + file.size), sentinel(file.sentinel), current(file.data) {
+    init();
+}
+
+Lexer::Lexer(const Lexer& parent, const char* begin)
+    : source(parent.source), end(parent.end), sentinel(parent.sentinel), current(begin) {
+    scan = parent.scan;
+    directives = begin == source;
+    deferErrors = true;
+    if (!directives) {
+        lines.restart(offsetOf(begin)); // the chunk before records this line start, merging drops it here
+    }
+}
+
+void Lexer::init() {
+    // tokens store 32 bit offsets
+    if ((size_t)(end - source) > UINT32_MAX) {
+        error("Source file is larger than 4 GB");
+    }
+}
+
+// ==========================
+// Input policies
+// ==========================
+
+/*
+    getToken's hot loop is written once against one of these, so the bounds handling is decided at compile time
+    SentinelInput: there is a '\0' at end, reading it is what stops every run, so the loop never looks at end
+    RangeInput: nothing may be read at end, every read is checked and end reads as CC_End
+*/
+struct SentinelInput {
+    static CharClass classAt(const char* p, const char*) { return charClassOf(*p); }
+    static const char* identifier(const ScanKernels& k, const char* p, const char*) { return k.identifier(p); }
+    static const char* digits(const ScanKernels& k, const char* p, const char*) { return k.digits(p); }
+    static const char* whitespace(const ScanKernels& k, const char* p, const char*, const char* base, vector<uint32_t>& lineStarts) {
+        return k.whitespace(p, base, lineStarts);
+    }
+};
+
+struct RangeInput {
+    static CharClass classAt(const char* p, const char* end) { return p < end ? charClassOf(*p) : CC_End; }
+    static const char* identifier(const ScanKernels& k, const char* p, const char* end) { return k.identifierIn(p, end); }
+    static const char* digits(const ScanKernels& k, const char* p, const char* end) { return k.digitsIn(p, end); }
+    static const char* whitespace(const ScanKernels& k, const char* p, const char* end, const char* base, vector<uint32_t>& lineStarts) {
+        return k.whitespaceIn(p, end, base, lineStarts);
+    }
+};
+
 // ==========================
 // Core movement
 // ==========================
 
+// columns are never tracked, a newline just records where the next line starts
 void Lexer::advance() {
-    if (*current == '\0') return;
-    if (*current == '\n') {
-        Tline++;
-        Tcolumn = 1;
-    }
-    else {
-        Tcolumn++;
+    char c = at(current);
+    if (c == '\0') return;
+    if (c == '\n') {
+        lines.addLine(offsetOf(current + 1));
     }
     current++;
 }
 
 char Lexer::peek() const {
-    if (*current == '\0')
+    if (at(current) == '\0')
         return '\0';
-    return *(current + 1);
+    return at(current + 1);
 }
 
 // ==========================
 // Literals
 // ==========================
 
-Token Lexer::IntLiteral() {
-    const char* start = current;
-    int startLine = Tline;
-    int startColumn = Tcolumn;
-
-    while (isdigit(*current)) {
-        advance();
-    }
-
-    return Token(TokenType::Integer, start, current - start, startLine, startColumn);
-}
-
-Token Lexer::DecLiteral() {
-    const char* start = current;
-    int startLine = Tline;
-    int startColumn = Tcolumn;
-
-    while (isdigit(*current))
-        advance();
-
-    if (*current == '.' && isdigit(peek())) {
-        advance(); // consume '.'
-        while (isdigit(*current))
-            advance();
+// what '\c' stands for, anything that isn't a known escape is just the char itself ('\q' is 'q')
+static int64_t escapeValue(char c) {
+    switch (c) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case '0': return '\0';
+    default: return (uint8_t)c;
     }
-
-    return Token(TokenType::Double, start, current - start, startLine, startColumn);
 }
 
 Token Lexer::CharLiteral() {
-    if (*current != '\'')
+    if (at(current) != '\'')
         error("CharLiteral called on non-quote character");
 
-    int startLine = Tline;
-    int startColumn = Tcolumn;
-
     advance(); // skip opening '
 
-    if (*current == '\0')
+    if (at(current) == '\0')
         error("Unterminated char literal");
 
     const char* start = current;
+    int64_t value;
 
-    if (*current == '\\') {
+    if (at(current) == '\\') {
         advance(); // skip '\'
-        if (*current == '\0')
+        if (at(current) == '\0')
             error("Invalid escape sequence");
+        value = escapeValue(at(current));
         advance(); // consume escaped char
     }
     else {
+        value = (uint8_t)at(current);
         advance(); // normal character
     }
 
-    if (*current != '\'')
+    if (at(current) != '\'')
         error("Expected closing '");
 
     advance(); // skip closing '
 
-    // Length is current - start, but note that the token value 
-    // usually excludes the quotes depending on your Token implementation
-    return Token(TokenType::Char, start, current - start - 1, startLine, startColumn);
+    // the token covers what is between the quotes, the value itself goes into the constant pool
+    return Token(TokenType::Char, offsetOf(start), (uint32_t)(current - start - 1), constants.add(Constant::character(value)), TF_Literal);
 }
 
-// ==========================
-// Punctuation
-// ==========================
-
-Token Lexer::Punctuation_literal() {
-    static const std::unordered_map<char, TokenType> punct = {
-        {'(', TokenType::LParen},
-        {')', TokenType::RParen},
-        {'{', TokenType::LBrace},
-        {'}', TokenType::RBrace},
-        {'[', TokenType::LBrack},
-        {']', TokenType::RBrack},
-        {',', TokenType::Comma},
-        {';', TokenType::Semicolon},
-        {'.', TokenType::Dot}
-    };
-    auto it = punct.find(*current);
-    if (it == punct.end()) {
-        // Handle unexpected characters to avoid infinite loops
-        char err[] = { *current, '\0' };
-        error("Unknown punctuation: ");
-        advance();
-        return Token(TokenType::UNKNOWN, current - 1, 1, Tline, Tcolumn);
-    }
-    const char* start = current;
-    int line = Tline;
-    int col = Tcolumn;
-
-    advance();
-    return Token(it->second, start, 1, line, col);
-}
-
-Token Lexer::operator_literal() {
-    const char* start = current;
-    int startLine = Tline;
-    int startColumn = Tcolumn;
-
-    char first = *current;
-    advance();
-    char second = *current; // Lookahead (Peek)
-
-    TokenType type = TokenType::UNKNOWN;
-
-    // Direct character dispatch
-    switch (first) {
-    case '+': type = TokenType::OpPlus; break;
-    case '-': type = TokenType::OpMinus; break;
-    case '*': type = TokenType::OpStar; break;
-    case '/': type = TokenType::OpSlash; break;
-    case '%': type = TokenType::OpMod; break;
-    case '=':
-        if (second == '=') { type = TokenType::OpIsEqual; advance(); }
-        else { type = TokenType::OpAssign; }
-        break;
-    case '!':
-        if (second == '=') { type = TokenType::OpIsNotEqual; advance(); }
-        break;
-    case '<':
-        if (second == '=') { type = TokenType::OpIsLessEqual; advance(); }
-        else { type = TokenType::OpLess; }
-        break;
-    case '>':
-        if (second == '=') { type = TokenType::OpIsGreaterEqual; advance(); }
-        else { type = TokenType::OpGreater; }
-        break;
-    case '&':
-        if (second == '&') { type = TokenType::OpAnd; advance(); }
-        break;
-    case '|':
-        if (second == '|') { type = TokenType::OpOr; advance(); }
-        break;
+// start..current is a run of digits (maybe with a '.'), the state machine already checked the shape
+Token Lexer::number_literal(TokenType type, const char* start) {
+    Token tok = makeToken(type, start);
+    Constant value;
+    if (type == TokenType::Integer) {
+        int64_t v = 0;
+        if (std::from_chars(start, current, v).ec == std::errc::result_out_of_range) {
+            error("Integer literal is too large");
+        }
+        value = Constant::integer(v);
     }
-
-    if (type == TokenType::UNKNOWN) {
-        error("Unknown operator");
+    else {
+        double v = 0;
+        if (std::from_chars(start, current, v).ec == std::errc::result_out_of_range) {
+            error("Floating point literal is out of range");
+        }
+        value = Constant::real(v);
     }
-
-    return Token(type, start, (int)(current - start), startLine, startColumn);
+    tok.flags = TF_Literal;
+    tok.payload = constants.add(value);
+    return tok;
 }
 
-Token Lexer::identifier_literal() {
-    const char* start = current;
-    int startLine = Tline;
-    int startColumn = Tcolumn;
-
-    // Consume all valid identifier characters
-    while (isalnum(*current) || *current == '_') {
-        advance();
+// start..current was already matched by the state machine in getToken, this only sorts out keywords
+Token Lexer::identifier_literal(const char* start) {
+    size_t length = current - start;
+    TRACE_LOG(Lexer, 2, "word='" << std::string_view(start, length) << "' length=" << length);
+    if (TRACE_ON(Lexer, 3)) {
+        std::ostream& out = Trace::begin(TraceSys::Lexer);
+        out << "word='";
+        for (const char* c = start; c < current; c++) out << (int)*c << " ";
+        out << "' len=" << length;
+        Trace::end();
     }
 
-    std::string word(start, current);
-    std::cout << "word='" << word << "' length=" << word.size() << std::endl;
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"def", TokenType::Def},
-        {"struct", TokenType::Struct},
-        {"import", TokenType::Import},
-        {"return", TokenType::Return},
-        {"if", TokenType::If},
-        {"else", TokenType::Else},
-        {"while", TokenType::While},
-        {"for", TokenType::For},
-        {"double", TokenType::Double},
-        {"int", TokenType::Integer},
-        {"char", TokenType::Char},
-        {"bool", TokenType::Bool},
-        {"array", TokenType::List},
-        {"True", TokenType::Bool},
-        {"False", TokenType::Bool},
-    };
-    TokenType type;
-    std::cout << "word='";
-    for (char c : word) std::cout << (int)c << " ";
-    std::cout << "' len=" << word.size() << std::endl;
-    auto it = keywords.find(word);
-    if (it != keywords.end()) {
-        type = it->second; // keyword matched
-    }
-    else {
-        type = TokenType::Identifier; // default
+    // keyword check straight against the source buffer (see Keywords.h)
+    Token tok = makeToken(keywordType(start, length), start);
+    if (tok.type == TokenType::Identifier) {
+        tok.payload = names.intern(start, (uint32_t)length);
     }
-    return Token(type, start, current - start, startLine, startColumn);
+    return tok;
 }
 
 void Lexer::BaJav_literal() {
     const char* start = current;
-    int startLine = Tline;
-    int startColumn = Tcolumn;
     // Consume all valid identifier characters
-    while ((isalnum(*current) || *current == '_') && *current!= '#') {
+    while (charClassOf(at(current)) == CC_Alpha || charClassOf(at(current)) == CC_Digit) {
         advance();
     }
     std::string word(start, current);
 	advance(); // skip ending #
-    cout << word;
+    TRACE_LOG(Lexer, 1, "directive '" << word << "'");
     if (word == "BaJav") {
         firstToken = true;
         return;
@@ -245,49 +203,228 @@ void Lexer::BaJav_literal() {
 // ==========================
 
 Token Lexer::getToken() {
-    // Skip whitespace
-	if (*current == '#' && Tline == 1) { // BaJav mode
-		cout << "Entering BaJav mode!" << endl;
-        advance(); // skip #
-		cout << "Processing BaJav token..." << endl;
-		BaJav_literal();
-		Tline = 1;  // now that we processed the Bajav token, reset line and column
-		Tcolumn = 1;
-		cout << "BaJav mode set to " << (firstToken ? "true" : "false") << endl;
+    return sentinel ? next<SentinelInput>() : next<RangeInput>();
+}
+
+// below this a chunk isn't worth handing to another thread
+static const size_t minChunkBytes = 256 * 1024;
+
+void Lexer::tokenize(vector<Token>& out) {
+    if (pool && pool->size() > 1 && current == source && (size_t)(end - source) >= 2 * minChunkBytes) {
+        size_t mark = out.size();
+        if (tokenizeParallel(out)) return;
+        out.resize(mark); // some chunk hit an error, lex serially so it's reported exactly like it always was
+    }
+    // failed only ever gets set on chunk lexers, for everyone else this is just the Eof check
+    if (sentinel) {
+        do out.push_back(next<SentinelInput>()); while (out.back().type != TokenType::Eof && !failed);
     }
+    else {
+        do out.push_back(next<RangeInput>()); while (out.back().type != TokenType::Eof && !failed);
+    }
+}
 
-    while (*current != '\0' && (*current == ' ' || *current == '\t' || *current == '\r' || *current == '\n')) {
-        advance();
+// ==========================
+// Parallel lexing
+// ==========================
+
+// first place at or after p where a chunk may begin: right after a newline that can't sit inside a char literal
+// (no other token spans a newline, and a raw newline only ends up in a char literal as '<nl> or '\<nl>)
+static const char* chunkStart(const char* p, const char* end) {
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if (!nl) return end;
+        if (nl[-1] != '\'' && nl[-1] != '\\') return nl + 1; // p is never the start of the source, so nl[-1] exists
+        p = nl + 1;
     }
+    return end;
+}
 
-    // End of file
-    if (*current == '\0') {
-        return Token(TokenType::Eof, current, 0, Tline, Tcolumn);
+/*
+    A chunk lexer still sees the whole source (and keeps the sentinel fast path), it just stops at the first
+    token that starts at or past stop. Chunks begin right after a newline, so no token straddles the boundary
+    and the one token it peeks at is the next chunk's first one
+    hitting Eof before stop (a '\0' inside the source) or an error marks the chunk failed
+*/
+template <class Input>
+void Lexer::lexChunk(vector<Token>& out, const char* stop) {
+    uint32_t stopOffset = offsetOf(stop);
+    bool last = stop == end;
+    while (true) {
+        Token tok = next<Input>();
+        if (failed) return;
+        if (tok.type == TokenType::Eof) {
+            if (last) out.push_back(tok);
+            else failed = true; // let the serial lexer deal with it
+            return;
+        }
+        if (tok.offset >= stopOffset) {
+            if (tok.isLiteral()) constants.pop(); // the next chunk owns that one
+            break;
+        }
+        out.push_back(tok);
     }
+    // the whitespace skip in front of that last token may have recorded line starts of the next chunk
+    vector<uint32_t>& starts = lines.starts();
+    while (starts.size() > 1 && starts.back() > stopOffset) starts.pop_back();
+}
 
-    // Character literal
-    if (*current == '\'') {
-        return CharLiteral();
+/*
+    split the source at safe newlines, lex every chunk on the pool, then stitch the results together
+    - offsets are already absolute (every chunk lexer shares our source pointer), so tokens need no fixing
+    - each chunk has its own line table, a prefix sum over the chunk sizes says where its tokens and line starts
+      go in the merged arrays, and the copies run in parallel too
+    - the first chunk lexes straight into out, and it's the only one that can see #BaJav# (it holds all of line 1)
+    returns false if any chunk failed, out only grew then and nothing else has been changed
+*/
+bool Lexer::tokenizeParallel(vector<Token>& out) {
+    size_t size = end - source;
+    size_t count = std::min<size_t>(pool->size(), size / minChunkBytes);
+
+    // no safe newline left (one long line, a long run of trailing spaces) means no more chunks, not empty ones:
+    // only the chunk that ends at end may add the Eof
+    vector<const char*> bounds = { source };
+    for (size_t k = 1; k < count; k++) {
+        const char* next = chunkStart(std::max(bounds.back(), source + size / count * k), end);
+        if (next == end) break;
+        if (next > bounds.back()) bounds.push_back(next);
+    }
+    bounds.push_back(end);
+    count = bounds.size() - 1;
+    if (count < 2) return false;
+
+    struct Chunk {
+        vector<Token> tokens;
+        vector<uint32_t> lineStarts;
+        Interner names;
+        ConstantPool constants;
+        vector<uint32_t> remap; // chunk symbol id -> merged id
+        uint32_t constantBase = 0; // where the chunk's constants start in the merged pool
+        bool failed = false;
+        bool bajav = false;
+    };
+    vector<Chunk> chunks(count);
+    out.reserve(out.size() + size / 3); // room for everything, so merging never reallocates chunk 0's tokens
+
+    pool->run(count, [&](size_t k) {
+        Lexer lexer(*this, bounds[k]);
+        Chunk& chunk = chunks[k];
+        if (k == 0) {
+            lexer.names = std::move(names);
+            lexer.constants = std::move(constants);
+        }
+        vector<Token>& tokens = k == 0 ? out : chunk.tokens;
+        if (k > 0) tokens.reserve((bounds[k + 1] - bounds[k]) / 3); // about one token every 3 bytes in real code
+        if (sentinel) lexer.lexChunk<SentinelInput>(tokens, bounds[k + 1]);
+        else lexer.lexChunk<RangeInput>(tokens, bounds[k + 1]);
+        chunk.lineStarts = std::move(lexer.lines.starts());
+        chunk.names = std::move(lexer.names);
+        chunk.constants = std::move(lexer.constants);
+        chunk.failed = lexer.failed;
+        chunk.bajav = lexer.firstToken;
+    });
+
+    for (const Chunk& chunk : chunks) {
+        if (chunk.failed) {
+            // hand ours back, they only hold what the rerun would add first anyway
+            names = std::move(chunks[0].names);
+            constants = std::move(chunks[0].constants);
+            return false;
+        }
     }
 
-    // Numbers
-    if (isdigit(*current)) {
-        const char* look = current;
-        while (isdigit(*look)) look++;
+    names = std::move(chunks[0].names);
+    constants = std::move(chunks[0].constants);
+    for (size_t k = 1; k < count; k++) {
+        chunks[k].constantBase = constants.append(chunks[k].constants);
+        const Interner& local = chunks[k].names;
+        chunks[k].remap.resize(local.size());
+        for (uint32_t id = 0; id < local.size(); id++) {
+            chunks[k].remap[id] = names.intern(local.text(id), local.length(id), local.hashOf(id));
+        }
+    }
 
-        if (*look == '.') {
-            return DecLiteral();
+    // where each chunk goes, every chunk but the first repeats the line start the chunk before it recorded
+    vector<size_t> tokenAt(count + 1), lineAt(count + 1);
+    tokenAt[0] = 0;
+    tokenAt[1] = out.size();
+    lineAt[0] = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (k > 0) tokenAt[k + 1] = tokenAt[k] + chunks[k].tokens.size();
+        lineAt[k + 1] = lineAt[k] + chunks[k].lineStarts.size() - (k ? 1 : 0);
+    }
+    out.resize(tokenAt[count]);
+    vector<uint32_t>& merged = lines.starts();
+    merged.resize(lineAt[count]);
+
+    pool->run(count, [&](size_t k) {
+        const Chunk& chunk = chunks[k];
+        if (k > 0) {
+            Token* dest = &out[tokenAt[k]];
+            for (Token tok : chunk.tokens) {
+                if (tok.type == TokenType::Identifier) tok.payload = chunk.remap[tok.payload];
+                else if (tok.isLiteral()) tok.payload += chunk.constantBase;
+                *dest++ = tok;
+            }
         }
-        return IntLiteral();
+        std::copy(chunk.lineStarts.begin() + (k ? 1 : 0), chunk.lineStarts.end(), merged.begin() + lineAt[k]);
+    });
+
+    firstToken = chunks[0].bajav;
+    current = source + out.back().offset; // where the Eof was found, like the serial loop leaves it
+    return true;
+}
+
+template <class Input>
+Token Lexer::next() {
+	if (directives && at(current) == '#' && lines.lineCount() == 1) { // BaJav mode
+		TRACE_LOG(Lexer, 1, "Entering BaJav mode!");
+        advance(); // skip #
+		BaJav_literal();
+		lines.restart(offsetOf(current));  // now that we processed the Bajav token, reset line and column
+		TRACE_LOG(Lexer, 1, "BaJav mode set to " << (firstToken ? "true" : "false"));
+    }
+
+    // Skip whitespace in bulk, the kernel records the line starts it crosses
+    current = Input::whitespace(*scan, current, end, source, lines.starts());
+
+    const char* start = current;
+
+    uint8_t state = lexTables.delta[LS_Start][Input::classAt(current, end)];
+    switch (state) {
+    case LS_Eof:
+        return makeToken(TokenType::Eof, start);
+    case LS_CharLit:
+        return CharLiteral();
+    case LS_Error:
+        error("Unknown punctuation: ");
+        return Token(TokenType::UNKNOWN, offsetOf(current), 1);
+    }
+
+    // Run the state machine
+    // identifier and digit runs are handed to the bulk scanners, the table only decides what comes after them
+    const char* p = current + 1;
+    while (true) {
+        if (state == LS_Ident) p = Input::identifier(*scan, p, end);
+        else if (state == LS_Int || state == LS_Frac) p = Input::digits(*scan, p, end);
+        uint8_t next = lexTables.delta[state][Input::classAt(p, end)];
+        if (next == LS_Stop) break;
+        state = next;
+        p++;
     }
+    current = p - lexTables.acceptBackup[state];
 
-    // Identifiers / Keywords
-    if (isalpha(*current) || *current == '_') {
-        return identifier_literal();
+    if (state == LS_Ident) {
+        return identifier_literal(start);
+    }
+
+    if (state == LS_Int || state == LS_IntDot || state == LS_Frac) {
+        return number_literal(lexTables.acceptType[state], start);
+    }
+
+    TokenType type = state == LS_Single ? lexTables.singleType[(uint8_t)*start] : lexTables.acceptType[state];
+    if (type == TokenType::UNKNOWN) {
+        error("Unknown operator");
     }
-    //operators
-    if (strchr("+-*/%=!<>|&", *current)) {
-        return operator_literal();
-	}
-    return Punctuation_literal();
+    return makeToken(type, start);
 }
\ No newline at end of file
@@ -1,33 +1,78 @@
 #pragma once
 
 #include "Token.h"
+#include "SimdScan.h"
+#include "SourceLocation.h"
+#include "SourceManager.h"
+#include "Interner.h"
+#include "Constants.h"
+#include <cstdint>
 #include <iostream>
+#include <vector>
 
 using namespace std;
 
+class ThreadPool;
+
 class Lexer {
 private:
 	const char* source;
-	int Tline = 1;
-	int Tcolumn = 1;
+	const char* end;       // one past the last char, the lexer works on [source, end)
+	bool sentinel = false; // *end is a readable '\0', lets the hot loop skip every end check (see next())
+	LineTable lines; // where each line starts, only consulted when a line:col is asked for
+	Interner names;  // every identifier gets its symbol id here, once
+	ConstantPool constants; // decoded number/char literals, indexed by their token's payload
+	const ScanKernels* scan = &scanKernels(); // whitespace/identifier/digit run scanners for this CPU
+	ThreadPool* pool = nullptr; // set -> big sources are lexed in chunks on it (see tokenize)
+	// chunk lexers (parallel mode) only: the chunk that doesn't hold line 1 must never see #BaJav#,
+	// and errors just mark the chunk as failed, the whole file is then lexed again serially to report them
+	bool directives = true;
+	bool deferErrors = false;
+	bool failed = false;
+	uint32_t offsetOf(const char* p) const { return (uint32_t)(p - source); }
+	Token makeToken(TokenType type, const char* start) {
+		if (current - start > UINT16_MAX) error("Token is longer than 65535 characters");
+		return Token(type, offsetOf(start), (uint32_t)(current - start));
+	}
+	char at(const char* p) const { return p < end ? *p : '\0'; } // checked read for the slow paths, end reads as '\0'
+	void init();
+	template <class Input> Token next();
+	Lexer(const Lexer& parent, const char* begin); // a chunk lexer starting at begin in parent's source
+	template <class Input> void lexChunk(std::vector<Token>& out, const char* stop);
+	bool tokenizeParallel(std::vector<Token>& out);
 public:
 	bool firstToken = false;  // to track which mode the compiler is in
-	Lexer(const char* src) : source(src), current(&source[0]) {}
+	Lexer(const char* src);                         // '\0' terminated string
+	Lexer(const char* begin, const char* end);      // plain range, nothing at or past end is touched
+	Lexer(const SourceFile& file);                  // a file from the SourceManager (sentinel path when the mapping allows it)
 	void advance();
 	char peek()const;
 	// bool isSpace();
 	// void skipWhitespace();
 	void error(const char* message) {
-		cerr << "[Lexer Error] Line " << Tline << ", Column " << Tcolumn << ": " << message << endl;
+		if (deferErrors) {
+			failed = true;
+			return;
+		}
+		SourceLoc loc = lines.locate(offsetOf(current));
+		cerr << "[Lexer Error] Line " << loc.line << ", Column " << loc.column << ": " << message << endl;
 		exit(1);
 	}
 	const char* current;
-	Token operator_literal();
-	Token IntLiteral();
-	Token Punctuation_literal();
-	Token DecLiteral();
-	Token CharLiteral();;
-	Token identifier_literal();
+	// token text and position
+	const char* text(const Token& tok) const { return source + tok.offset; }
+	SourceLoc location(uint32_t offset) const { return lines.locate(offset); }
+	const LineTable& lineTable() const { return lines; }
+	const Interner& interner() const { return names; }
+	const ConstantPool& constantPool() const { return constants; }
+	const Constant& constant(const Token& tok) const { return constants[tok.payload]; } // tok must be a literal
+	Token CharLiteral();
+	Token identifier_literal(const char* start);
+	Token number_literal(TokenType type, const char* start);
 	void BaJav_literal();
 	Token getToken();
+	// lex everything up to and including Eof, picks the input policy once instead of per token
+	void tokenize(std::vector<Token>& out);
+	// let tokenize split big sources into chunks and lex them on this pool (nullptr = always serial)
+	void useThreadPool(ThreadPool* threads) { pool = threads; }
 };
\ No newline at end of file
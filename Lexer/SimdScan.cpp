@@ -0,0 +1,440 @@
+#include "SimdScan.h"
+#include "LexTables.h"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LUCIRO_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// AddressSanitizer flags the aligned block loads of the sentinel kernels (see below) as reads past the buffer,
+// so a sanitized build swaps them for the scalar loops, the range kernels only read inside [p, end) and stay
+#if defined(__SANITIZE_ADDRESS__)
+#define LUCIRO_SCAN_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define LUCIRO_SCAN_ASAN 1
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LUCIRO_TARGET_SSE2 __attribute__((target("sse2")))
+#define LUCIRO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LUCIRO_TARGET_SSE2
+#define LUCIRO_TARGET_AVX2
+#endif
+
+// ==========================
+// Bit helpers
+// ==========================
+
+static inline int lowestBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// ==========================
+// Scalar fallback
+// ==========================
+
+static const char* identifierScalar(const char* p) {
+    while (charClassOf(*p) == CC_Alpha || charClassOf(*p) == CC_Digit) p++;
+    return p;
+}
+
+static const char* digitsScalar(const char* p) {
+    while (charClassOf(*p) == CC_Digit) p++;
+    return p;
+}
+
+static const char* whitespaceScalar(const char* p, const char* base, std::vector<uint32_t>& lineStarts) {
+    while (true) {
+        CharClass cls = charClassOf(*p);
+        if (cls == CC_Newline) {
+            lineStarts.push_back((uint32_t)(p + 1 - base));
+        }
+        else if (cls != CC_Space) {
+            return p;
+        }
+        p++;
+    }
+}
+
+// range versions, nothing at or past end is read
+static const char* identifierInScalar(const char* p, const char* end) {
+    while (p < end && (charClassOf(*p) == CC_Alpha || charClassOf(*p) == CC_Digit)) p++;
+    return p;
+}
+
+static const char* digitsInScalar(const char* p, const char* end) {
+    while (p < end && charClassOf(*p) == CC_Digit) p++;
+    return p;
+}
+
+static const char* whitespaceInScalar(const char* p, const char* end, const char* base, std::vector<uint32_t>& lineStarts) {
+    for (; p < end; p++) {
+        CharClass cls = charClassOf(*p);
+        if (cls == CC_Newline) {
+            lineStarts.push_back((uint32_t)(p + 1 - base));
+        }
+        else if (cls != CC_Space) {
+            return p;
+        }
+    }
+    return p;
+}
+
+#ifdef LUCIRO_SCAN_X86
+
+// most runs are a handful of chars (x, i, 0, a line of indentation), setting up a vector costs more than
+// just looking at them, so the vector kernels only kick in once a run is longer than this
+static const int shortRun = 8;
+
+/*
+    Every kernel works the same way: start at the aligned block holding p, build a bitmask of the chars that
+    END the run, throw away the bits in front of p and stop at the lowest set bit
+    '\0' is never part of a run, so the scan always stops inside the block that holds the terminator
+
+    That block can reach up to 15 (31) bytes past the '\0' and past the end of the mapping or allocation. It's
+    still a legal read: an aligned 16 or 32 byte block never crosses a page boundary, so every byte of it is on
+    the page that holds the terminator, which is mapped. Don't turn these into unaligned loads, that invariant
+    is the only thing keeping them off the next (maybe unmapped) page
+
+    The range versions (...In) can't lean on a terminator, they do unaligned loads while a whole vector
+    still fits before end and leave the last few bytes to the scalar loop
+*/
+
+// ==========================
+// SSE2 (16 bytes per step)
+// ==========================
+
+LUCIRO_TARGET_SSE2 static inline uint32_t identMask16(__m128i v) {
+    // signed compares are fine here, bytes >= 0x80 are negative and fall outside every range
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+LUCIRO_TARGET_SSE2 static inline uint32_t digitMask16(__m128i v) {
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    return (uint32_t)_mm_movemask_epi8(digit);
+}
+
+#ifndef LUCIRO_SCAN_ASAN
+LUCIRO_TARGET_SSE2 static const char* identifierSSE2(const char* p) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (!(charClassOf(*p) == CC_Alpha || charClassOf(*p) == CC_Digit)) return p;
+    }
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)15);
+    uint32_t stop = ~identMask16(_mm_load_si128((const __m128i*)block)) & (0xFFFFu & (0xFFFFu << (p - block)));
+    while (!stop) {
+        block += 16;
+        stop = ~identMask16(_mm_load_si128((const __m128i*)block)) & 0xFFFFu;
+    }
+    return block + lowestBit(stop);
+}
+
+LUCIRO_TARGET_SSE2 static const char* digitsSSE2(const char* p) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (!(charClassOf(*p) == CC_Digit)) return p;
+    }
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)15);
+    uint32_t stop = ~digitMask16(_mm_load_si128((const __m128i*)block)) & (0xFFFFu & (0xFFFFu << (p - block)));
+    while (!stop) {
+        block += 16;
+        stop = ~digitMask16(_mm_load_si128((const __m128i*)block)) & 0xFFFFu;
+    }
+    return block + lowestBit(stop);
+}
+
+LUCIRO_TARGET_SSE2 static const char* whitespaceSSE2(const char* p, const char* base, std::vector<uint32_t>& lineStarts) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        CharClass cls = charClassOf(*p);
+        if (cls == CC_Newline) {
+            lineStarts.push_back((uint32_t)(p + 1 - base));
+        }
+        else if (cls != CC_Space) {
+            return p;
+        }
+    }
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)15);
+    uint32_t keep = 0xFFFFu & (0xFFFFu << (p - block));
+    while (true) {
+        __m128i v = _mm_load_si128((const __m128i*)block);
+        __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), nl));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(ws) & keep;
+        uint32_t nlMask = (uint32_t)_mm_movemask_epi8(nl) & keep;
+        if (stop) nlMask &= (1u << lowestBit(stop)) - 1; // only the newlines before the end of the run
+        for (; nlMask; nlMask &= nlMask - 1) {
+            lineStarts.push_back((uint32_t)(block + lowestBit(nlMask) + 1 - base));
+        }
+        if (stop) return block + lowestBit(stop);
+        block += 16;
+        keep = 0xFFFFu;
+    }
+}
+#endif
+
+LUCIRO_TARGET_SSE2 static const char* identifierInSSE2(const char* p, const char* end) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (p == end || !(charClassOf(*p) == CC_Alpha || charClassOf(*p) == CC_Digit)) return p;
+    }
+    for (; end - p >= 16; p += 16) {
+        uint32_t stop = ~identMask16(_mm_loadu_si128((const __m128i*)p)) & 0xFFFFu;
+        if (stop) return p + lowestBit(stop);
+    }
+    return identifierInScalar(p, end);
+}
+
+LUCIRO_TARGET_SSE2 static const char* digitsInSSE2(const char* p, const char* end) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (p == end || !(charClassOf(*p) == CC_Digit)) return p;
+    }
+    for (; end - p >= 16; p += 16) {
+        uint32_t stop = ~digitMask16(_mm_loadu_si128((const __m128i*)p)) & 0xFFFFu;
+        if (stop) return p + lowestBit(stop);
+    }
+    return digitsInScalar(p, end);
+}
+
+LUCIRO_TARGET_SSE2 static const char* whitespaceInSSE2(const char* p, const char* end, const char* base, std::vector<uint32_t>& lineStarts) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (p == end) return p;
+        CharClass cls = charClassOf(*p);
+        if (cls == CC_Newline) {
+            lineStarts.push_back((uint32_t)(p + 1 - base));
+        }
+        else if (cls != CC_Space) {
+            return p;
+        }
+    }
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), nl));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(ws) & 0xFFFFu;
+        uint32_t nlMask = (uint32_t)_mm_movemask_epi8(nl);
+        if (stop) nlMask &= (1u << lowestBit(stop)) - 1;
+        for (; nlMask; nlMask &= nlMask - 1) {
+            lineStarts.push_back((uint32_t)(p + lowestBit(nlMask) + 1 - base));
+        }
+        if (stop) return p + lowestBit(stop);
+    }
+    return whitespaceInScalar(p, end, base, lineStarts);
+}
+
+// ==========================
+// AVX2 (32 bytes per step)
+// ==========================
+
+LUCIRO_TARGET_AVX2 static inline uint32_t identMask32(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+LUCIRO_TARGET_AVX2 static inline uint32_t digitMask32(__m256i v) {
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    return (uint32_t)_mm256_movemask_epi8(digit);
+}
+
+#ifndef LUCIRO_SCAN_ASAN
+LUCIRO_TARGET_AVX2 static const char* identifierAVX2(const char* p) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (!(charClassOf(*p) == CC_Alpha || charClassOf(*p) == CC_Digit)) return p;
+    }
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)31);
+    uint32_t stop = ~identMask32(_mm256_load_si256((const __m256i*)block)) & (0xFFFFFFFFu << (p - block));
+    while (!stop) {
+        block += 32;
+        stop = ~identMask32(_mm256_load_si256((const __m256i*)block));
+    }
+    return block + lowestBit(stop);
+}
+
+LUCIRO_TARGET_AVX2 static const char* digitsAVX2(const char* p) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (!(charClassOf(*p) == CC_Digit)) return p;
+    }
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)31);
+    uint32_t stop = ~digitMask32(_mm256_load_si256((const __m256i*)block)) & (0xFFFFFFFFu << (p - block));
+    while (!stop) {
+        block += 32;
+        stop = ~digitMask32(_mm256_load_si256((const __m256i*)block));
+    }
+    return block + lowestBit(stop);
+}
+
+LUCIRO_TARGET_AVX2 static const char* whitespaceAVX2(const char* p, const char* base, std::vector<uint32_t>& lineStarts) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        CharClass cls = charClassOf(*p);
+        if (cls == CC_Newline) {
+            lineStarts.push_back((uint32_t)(p + 1 - base));
+        }
+        else if (cls != CC_Space) {
+            return p;
+        }
+    }
+    const char* block = (const char*)((uintptr_t)p & ~(uintptr_t)31);
+    uint32_t keep = 0xFFFFFFFFu << (p - block);
+    while (true) {
+        __m256i v = _mm256_load_si256((const __m256i*)block);
+        __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), nl));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(ws) & keep;
+        uint32_t nlMask = (uint32_t)_mm256_movemask_epi8(nl) & keep;
+        if (stop) nlMask &= (uint32_t)((1ull << lowestBit(stop)) - 1);
+        for (; nlMask; nlMask &= nlMask - 1) {
+            lineStarts.push_back((uint32_t)(block + lowestBit(nlMask) + 1 - base));
+        }
+        if (stop) return block + lowestBit(stop);
+        block += 32;
+        keep = 0xFFFFFFFFu;
+    }
+}
+#endif
+
+LUCIRO_TARGET_AVX2 static const char* identifierInAVX2(const char* p, const char* end) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (p == end || !(charClassOf(*p) == CC_Alpha || charClassOf(*p) == CC_Digit)) return p;
+    }
+    for (; end - p >= 32; p += 32) {
+        uint32_t stop = ~identMask32(_mm256_loadu_si256((const __m256i*)p));
+        if (stop) return p + lowestBit(stop);
+    }
+    return identifierInScalar(p, end);
+}
+
+LUCIRO_TARGET_AVX2 static const char* digitsInAVX2(const char* p, const char* end) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (p == end || !(charClassOf(*p) == CC_Digit)) return p;
+    }
+    for (; end - p >= 32; p += 32) {
+        uint32_t stop = ~digitMask32(_mm256_loadu_si256((const __m256i*)p));
+        if (stop) return p + lowestBit(stop);
+    }
+    return digitsInScalar(p, end);
+}
+
+LUCIRO_TARGET_AVX2 static const char* whitespaceInAVX2(const char* p, const char* end, const char* base, std::vector<uint32_t>& lineStarts) {
+    for (int i = 0; i < shortRun; i++, p++) {
+        if (p == end) return p;
+        CharClass cls = charClassOf(*p);
+        if (cls == CC_Newline) {
+            lineStarts.push_back((uint32_t)(p + 1 - base));
+        }
+        else if (cls != CC_Space) {
+            return p;
+        }
+    }
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), nl));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(ws);
+        uint32_t nlMask = (uint32_t)_mm256_movemask_epi8(nl);
+        if (stop) nlMask &= (uint32_t)((1ull << lowestBit(stop)) - 1);
+        for (; nlMask; nlMask &= nlMask - 1) {
+            lineStarts.push_back((uint32_t)(p + lowestBit(nlMask) + 1 - base));
+        }
+        if (stop) return p + lowestBit(stop);
+    }
+    return whitespaceInScalar(p, end, base, lineStarts);
+}
+
+#endif // LUCIRO_SCAN_X86
+
+// ==========================
+// Runtime selection
+// ==========================
+
+static const ScanKernels scalarKernels = { ScanLevel::Scalar, identifierScalar, digitsScalar, whitespaceScalar,
+    identifierInScalar, digitsInScalar, whitespaceInScalar };
+#ifdef LUCIRO_SCAN_X86
+#ifdef LUCIRO_SCAN_ASAN
+static const ScanKernels sse2Kernels = { ScanLevel::SSE2, identifierScalar, digitsScalar, whitespaceScalar,
+    identifierInSSE2, digitsInSSE2, whitespaceInSSE2 };
+static const ScanKernels avx2Kernels = { ScanLevel::AVX2, identifierScalar, digitsScalar, whitespaceScalar,
+    identifierInAVX2, digitsInAVX2, whitespaceInAVX2 };
+#else
+static const ScanKernels sse2Kernels = { ScanLevel::SSE2, identifierSSE2, digitsSSE2, whitespaceSSE2,
+    identifierInSSE2, digitsInSSE2, whitespaceInSSE2 };
+static const ScanKernels avx2Kernels = { ScanLevel::AVX2, identifierAVX2, digitsAVX2, whitespaceAVX2,
+    identifierInAVX2, digitsInAVX2, whitespaceInAVX2 };
+#endif
+#endif
+
+static ScanLevel detectScanLevel() {
+#ifdef LUCIRO_SCAN_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6); // OSXSAVE + AVX + YMM state
+    bool avx2 = false;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return ScanLevel::AVX2;
+    if (sse2) return ScanLevel::SSE2;
+#endif
+    return ScanLevel::Scalar;
+}
+
+static const ScanKernels* kernelsFor(ScanLevel level) {
+#ifdef LUCIRO_SCAN_X86
+    if (level == ScanLevel::AVX2) return &avx2Kernels;
+    if (level == ScanLevel::SSE2) return &sse2Kernels;
+#endif
+    return &scalarKernels;
+}
+
+static const ScanKernels*& activeKernels() {
+    static const ScanKernels* active = kernelsFor(detectScanLevel());
+    return active;
+}
+
+const ScanKernels& scanKernels() {
+    return *activeKernels();
+}
+
+ScanLevel setScanLevel(ScanLevel level) {
+    ScanLevel best = detectScanLevel();
+    if ((int)level > (int)best) level = best;
+    activeKernels() = kernelsFor(level);
+    return level;
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+    case ScanLevel::AVX2: return "avx2";
+    case ScanLevel::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+/*
+	Bulk scanning kernels for the lexer
+	these find the end of a whitespace / identifier / digit run 16 or 32 bytes at a time instead of one advance() per char
+	the best instruction set is picked once at runtime (AVX2 -> SSE2 -> plain scalar loops)
+
+	the plain kernels need a '\0' after the source, the vector versions only do aligned loads so they never touch
+	a page past the one holding the terminator (AddressSanitizer builds use the scalar loops for these, see SimdScan.cpp)
+	the ...In kernels take an end pointer instead and never read at or past it (sources without a terminator)
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class ScanLevel {
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+struct ScanKernels {
+	ScanLevel level;
+	// returns the first char that is not [A-Za-z0-9_]
+	const char* (*identifier)(const char* p);
+	// returns the first char that is not [0-9]
+	const char* (*digits)(const char* p);
+	// returns the first char that is not ' ' '\t' '\r' '\n', and appends the offset (from base) of the
+	// line after every newline it skipped to lineStarts
+	const char* (*whitespace)(const char* p, const char* base, std::vector<uint32_t>& lineStarts);
+
+	// same three for a [p, end) range, they stop at end at the latest
+	const char* (*identifierIn)(const char* p, const char* end);
+	const char* (*digitsIn)(const char* p, const char* end);
+	const char* (*whitespaceIn)(const char* p, const char* end, const char* base, std::vector<uint32_t>& lineStarts);
+};
+
+// kernels for the best level this CPU supports (chosen on first use)
+const ScanKernels& scanKernels();
+
+// force a level (clamped to what the CPU supports), mainly for benchmarks, returns the level actually used
+ScanLevel setScanLevel(ScanLevel level);
+
+const char* scanLevelName(ScanLevel level);
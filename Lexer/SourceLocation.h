@@ -0,0 +1,34 @@
+#pragma once
+/*
+	Source locations
+	tokens and AST nodes only remember a byte offset into the source, line:col is worked out from the
+	line table when someone actually needs it (error messages), so the lexer never counts columns
+*/
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+struct SourceLoc {
+	int line;
+	int column;
+};
+
+class LineTable {
+	std::vector<uint32_t> lineStarts = { 0 }; // offset of the first character of every line
+public:
+	void addLine(uint32_t start) { lineStarts.push_back(start); }
+	// forget everything and start line 1 at offset start (used after the #BaJav# directive)
+	void restart(uint32_t start) { lineStarts.assign(1, start); }
+	size_t lineCount() const { return lineStarts.size(); }
+	std::vector<uint32_t>& starts() { return lineStarts; }
+	const std::vector<uint32_t>& starts() const { return lineStarts; }
+
+	SourceLoc locate(uint32_t offset) const {
+		auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+		if (it == lineStarts.begin()) {
+			return { 1, (int)offset + 1 }; // in front of a restarted first line
+		}
+		size_t line = (it - lineStarts.begin()) - 1;
+		return { (int)line + 1, (int)(offset - lineStarts[line]) + 1 };
+	}
+};
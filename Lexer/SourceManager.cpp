@@ -0,0 +1,103 @@
+#include "SourceManager.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t pageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+FileID SourceManager::addFile(const std::string& path) {
+    SourceFile file;
+    file.name = path;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return InvalidFileID;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return InvalidFileID;
+    }
+    file.size = (size_t)size.QuadPart;
+    if (file.size > 0) {
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(handle);
+            return InvalidFileID;
+        }
+        file.data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); // the view keeps the mapping alive
+    }
+    CloseHandle(handle);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return InvalidFileID;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return InvalidFileID;
+    }
+    file.size = (size_t)st.st_size;
+    if (file.size > 0) {
+        void* map = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        file.data = map == MAP_FAILED ? nullptr : (const char*)map;
+#ifdef MADV_SEQUENTIAL
+        if (file.data) madvise(map, file.size, MADV_SEQUENTIAL); // lexing reads it front to back once
+#endif
+    }
+    close(fd); // the mapping stays valid after the descriptor is closed
+#endif
+
+    if (file.size == 0) {
+        file.data = "";
+        file.sentinel = true;
+    }
+    else if (!file.data) {
+        return InvalidFileID;
+    }
+    else {
+        file.mapped = true;
+        file.mappedSize = file.size;
+        // the tail of the last page is zero filled, if there is one we get a free '\0' after the file
+        file.sentinel = file.size % pageSize() != 0;
+    }
+
+    files.push_back(file);
+    return (FileID)(files.size() - 1);
+}
+
+FileID SourceManager::addBuffer(const std::string& name, const char* data, size_t size, bool sentinel) {
+    SourceFile file;
+    file.name = name;
+    file.data = data;
+    file.size = size;
+    file.sentinel = sentinel;
+    files.push_back(file);
+    return (FileID)(files.size() - 1);
+}
+
+SourceManager::~SourceManager() {
+    for (SourceFile& file : files) {
+        if (!file.mapped) continue;
+#ifdef _WIN32
+        UnmapViewOfFile(file.data);
+#else
+        munmap((void*)file.data, file.mappedSize);
+#endif
+    }
+}
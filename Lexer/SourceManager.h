@@ -0,0 +1,44 @@
+#pragma once
+/*
+	SourceManager
+	owns every source buffer the compiler looks at, files are memory mapped read-only (never copied)
+	so tokens and the StringViews in the AST point straight into the mapping
+	-> the SourceManager has to outlive the AST and anything else holding those views
+
+	each file gets a FileID (its index), the lexer takes a SourceFile and works on [data, data + size)
+*/
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using FileID = uint32_t;
+const FileID InvalidFileID = UINT32_MAX;
+
+struct SourceFile {
+	std::string name;
+	const char* data = nullptr;
+	size_t size = 0;
+	// data[size] is a readable '\0', so the lexer can use its sentinel fast path
+	// (true for in-memory strings and for mappings whose last page has room left over, the OS zero fills it)
+	bool sentinel = false;
+	bool mapped = false;
+	size_t mappedSize = 0;
+};
+
+class SourceManager {
+	std::vector<SourceFile> files;
+public:
+	SourceManager() = default;
+	SourceManager(const SourceManager&) = delete;
+	SourceManager& operator=(const SourceManager&) = delete;
+	~SourceManager();
+
+	// map a file from disk, returns InvalidFileID if it can't be opened
+	FileID addFile(const std::string& path);
+	// register a buffer the caller keeps alive, '\0' terminated buffers should pass sentinel = true
+	FileID addBuffer(const std::string& name, const char* data, size_t size, bool sentinel);
+
+	const SourceFile& file(FileID id) const { return files[id]; }
+	size_t fileCount() const { return files.size(); }
+};
@@ -1,7 +1,8 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     Identifier,
     // primitive data types
     Double,
@@ -38,15 +39,35 @@ enum class TokenType {
     BaJav // keyword to disable logic and grammar check in Semantic Analyzer >:)
 };
 
+// 12 bytes: where the token is in the source and what it is
+// the text is source + offset (Lexer::text), line/column come from the lexer's line table (Lexer::location)
+// Token::flags
+enum TokenFlags : uint8_t {
+    TF_None = 0,
+    TF_Literal = 1, // number/char literal (not the int/double/char keyword), payload indexes the lexer's ConstantPool
+};
+
 struct Token {
+    uint32_t offset;  // byte offset of the first character in the source buffer
+    uint16_t length;  // number of characters (the lexer refuses anything longer)
     TokenType type;
-    const char* value;
-    int line;
-    int column;
-    size_t Vsize;
+    uint8_t flags;    // TF_* bits
+    uint32_t payload; // Identifier: interned symbol id (Lexer/Interner.h), literal: constant index (Lexer/Constants.h)
 	Token() = default; // This brings back the "empty" struct ability
-    Token(TokenType type, const char* lexeme, size_t size, int line, int column)
-        : type(type), value(lexeme), Vsize(size), line(line), column(column) { }
+    Token(TokenType type, uint32_t offset, uint32_t length, uint32_t payload = 0, uint8_t flags = TF_None)
+        : offset(offset), length((uint16_t)length), type(type), flags(flags), payload(payload) { }
+    bool isLiteral() const { return (flags & TF_Literal) != 0; }
 
 };
+static_assert(sizeof(Token) == 12, "Token should stay 12 bytes, the parser keeps every one of them");
 
+// the keyword a primitive type is spelled with, for reports ( a struct prints its own name )
+inline const char* typeName(TokenType type) {
+    switch (type) {
+    case TokenType::Integer: return "int";
+    case TokenType::Double:  return "double";
+    case TokenType::Char:    return "char";
+    case TokenType::Bool:    return "bool";
+    default:                 return "?";
+    }
+}
@@ -1,12 +1,20 @@
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "Lexer/Lexer.h"
+#include "Lexer/SourceManager.h"
 #include "Parser/Parser.h"
+#include "Parser/ASTCache.h"
 #include "SAnalyzer/SAnalyzer.h"
 #include "IRgen/IRgen.h"
+#include "Support/ThreadPool.h"
 
-int main() {
-    // 1. Your source code as a raw C-string for your Lexer
+int main(int argc, char** argv) {
+    // 1. Your source code as a raw C-string for your Lexer (or a file: luciro [-jN] [--flat] <file>)
     const char* source = R"(
 struct Point {
     int x;
@@ -32,26 +40,141 @@ void main() {
 
     std::cout << "--- [Luciro Compiler Pipeline] ---\n";
 
-    // 2. Initialize Lexer (Corrected to use const char*)
-    Lexer lexer(source);
+    // 2. Initialize Lexer
+    // the source manager owns the buffers (files are mmapped), it has to outlive the AST since names point into it
+    SourceManager sources;
+    FileID file;
+    unsigned jobs = 1; // -jN lexes, parses and checks big files on N threads, -j alone = one per core
+    const char* path = nullptr;
+    bool flatAST = false; // --flat runs sema and irgen over the flat AST ( Parser/FlatAST.h )
+    bool signatures = false; // --signatures only lists structs and function signatures, bodies are never parsed
+    const char* cacheDir = nullptr; // --cache DIR keeps checked flat ASTs there and reuses them ( Parser/ASTCache.h )
+    LayoutMode layout = LayoutMode::Slots; // --layout slots|natural|packed ( SAnalyzer/StructLayout.h )
+    bool layoutReport = false; // --layout-report prints every struct's layout and what it saved over slots (not on a cache hit)
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "-j", 2) == 0) jobs = (unsigned)std::atoi(argv[i] + 2);
+        else if (std::strcmp(argv[i], "--flat") == 0) flatAST = true;
+        else if (std::strcmp(argv[i], "--signatures") == 0) signatures = true;
+        else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cacheDir = argv[++i];
+        else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            if (!parseLayoutMode(argv[++i], layout)) {
+                std::cerr << "[Error] unknown layout " << argv[i] << " (slots, natural or packed)" << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--layout-report") == 0) layoutReport = true;
+        else path = argv[i];
+    }
+    if (path) {
+        file = sources.addFile(path);
+        if (file == InvalidFileID) {
+            std::cerr << "[Error] cannot open " << path << std::endl;
+            return 1;
+        }
+    }
+    else {
+        file = sources.addBuffer("<builtin>", source, std::strlen(source), true);
+    }
+
+    // an unchanged source whose checked AST is in the cache goes straight to IR generation
+    uint64_t sourceHash = 0;
+    std::string cachePath;
+    if (cacheDir) {
+        const SourceFile& src = sources.file(file);
+        sourceHash = hashSource(src.data, src.size);
+        // the side tables hold sizes and offsets for one layout, each mode gets its own entry
+        sourceHash += (uint64_t)layout * 0x9E3779B97F4A7C15ull;
+        cachePath = astCachePath(cacheDir, sourceHash);
+        CachedProgram cached;
+        if (loadASTCache(sources, cachePath, sourceHash, src.size, cached)) {
+            std::cout << "[Step 1] Loaded cached AST. (" << cached.ast.nodeCount() << " nodes, lexing, parsing and semantic analysis skipped)\n";
+            IRgen generator(cached.names);
+            generator.generate(cached.ast);
+            std::cout << "[Step 3] IR Generation Complete.\n";
+            generator.Dump();
+            return 0;
+        }
+        flatAST = true; // what goes into the cache is the flat form (its passes keep their own stacks, a deep source is fine)
+    }
+
+    Lexer lexer(sources.file(file));
+    // the lexer, the parser and sema use it (the flat form is checked serially)
+    std::unique_ptr<ThreadPool> pool(jobs != 1 ? new ThreadPool(jobs) : nullptr);
+    lexer.useThreadPool(pool.get());
 
     // 3. Initialize Parser
     // Your Parser constructor takes Lexer& and internally calls getToken()
-    Parser parser(lexer);
-    ProgramNode* ast = (ProgramNode*)parser.ParseProgram();
+    // the AST lives in the context, the parser is only needed while parsing
+    ASTContext context;
+    ProgramNode* ast;
+    {
+        Parser parser(lexer, context);
+        parser.useThreadPool(pool.get());
+        parser.deferBodies(signatures);
+        ast = (ProgramNode*)parser.ParseProgram();
+    }
     std::cout << "[Step 1] Parsing Complete.\n";
 
+    if (signatures) {
+        for (ASTNode* decl : ast->declarations) {
+            if (decl->kind == NodeKind::StructDecl) {
+                auto* st = static_cast<StructDeclNode*>(decl);
+                std::cout << "struct " << std::string_view(st->name.data, st->name.size) << " (" << st->members.size() << " members)\n";
+            }
+            else if (decl->kind == NodeKind::Function) {
+                auto* fn = static_cast<FunctionDeclNode*>(decl);
+                std::cout << "function " << typeName(fn->returnType) << " " << std::string_view(fn->name.data, fn->name.size) << "(";
+                for (size_t i = 0; i < fn->parameters.size(); i++) {
+                    const Parameter& param = fn->parameters[i];
+                    std::cout << (i ? ", " : "");
+                    if (param.type == TokenType::Struct) std::cout << std::string_view(param.structTypeName.data, param.structTypeName.size);
+                    else std::cout << typeName(param.type);
+                    std::cout << " " << std::string_view(param.name.data, param.name.size);
+                }
+                std::cout << ")\n";
+            }
+        }
+        return 0;
+    }
+
+    FlatAST flat(lexer.interner());
+    if (flatAST && !flatten(ast, flat)) {
+        std::cerr << "[Warning] more than " << NodeRef::indexLimit << " nodes of one kind, too many for --flat, using the tree" << std::endl;
+        flatAST = false;
+    }
+    if (flatAST) {
+        SAnalyzer analyzer(lexer.firstToken, &lexer.lineTable());
+        analyzer.setLayoutMode(layout);
+        analyzer.analyze(flat);
+        std::cout << "[Step 2] Semantic Analysis Complete. (flat, " << flat.nodeCount() << " nodes)\n";
+        if (layoutReport) analyzer.getStructLayouts().report(std::cout);
+        if (cacheDir && analyzer.errorCount() == 0) {
+            const SourceFile& src = sources.file(file);
+            if (!storeASTCache(cachePath, sourceHash, src.size, flat, analyzer.getTypes(), lexer.interner(), lexer.lineTable(), lexer.firstToken)) {
+                std::cerr << "[Warning] could not write " << cachePath << std::endl;
+            }
+        }
+        IRgen generator(lexer.interner());
+        generator.generate(flat);
+        std::cout << "[Step 3] IR Generation Complete.\n";
+        generator.Dump();
+        return 0;
+    }
+
     // 4. Semantic Analysis
     // SAnalyzer takes a bool for 'freedom' (BaJavMode)
     // We can pull the mode directly from your lexer!
-    SAnalyzer analyzer(lexer.firstToken);
-    ast->accept(&analyzer);
+    SAnalyzer analyzer(lexer.firstToken, &lexer.lineTable());
+    analyzer.setLayoutMode(layout);
+    analyzer.useThreadPool(pool.get());
+    analyzer.analyze(ast);
     std::cout << "[Step 2] Semantic Analysis Complete.\n";
+    if (layoutReport) analyzer.getStructLayouts().report(std::cout);
 
     // 5. IR Generation
     // We pass the struct registry harvested by the analyzer
-    IRgen generator(analyzer.getStructRegistry());
-    ast->accept(&generator);
+    IRgen generator(analyzer.getStructLayouts(), lexer.interner());
+    generator.walk(ast);
     std::cout << "[Step 3] IR Generation Complete.\n";
 
     // 6. The Catalogue Dump
@@ -1,4 +1,5 @@
 #include "AST.h"
+#include "Parser.h"
 #include "../SAnalyzer/Visitor.h"
 
 
@@ -29,6 +30,11 @@ void FunctionDeclNode::accept(Visitor* visitor) {
     visitor->visit(this);
 }
 
+BlockNode* FunctionDeclNode::materializeBody() {
+    body = Parser::parseDeferredBody(*deferredIn, bodyFirst, bodyEnd);
+    return body;
+}
+
 void VarDeclNode::accept(Visitor* visitor) {
     visitor->visit(this);
 }
@@ -4,16 +4,33 @@
 */
 // logic for visit function ( so i dont forget ): SAnalyzer calls big visit function, which calls accept on node, which calls visit on specific node type
 #include "../Lexer/Token.h"
+#include "../Lexer/Interner.h"
+#include "../Lexer/Constants.h"
+#include "Types.h"
+#include "../Support/Arena.h"
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
+// every concrete node type, ASTNode::kind says which one a node is
+// (the flat AST reuses it for its NodeRefs, statements first, then expressions)
+enum class NodeKind : uint8_t {
+	// statements
+	Program, Block, If, While, Return, Function, VarDecl, StructDecl, ArrayDecl, ExprStmt,
+	// expressions
+	Assign, Literal, Binary, Unary, Variable, ArrayIndex, MemberAccess, Call,
+	Count
+};
+
 class ExpressionNode;
 class StatementNode;
+class ASTContext;
 class Visitor; // foward declaration so circular depdency doesnt fry my brain
 
 struct StringView {
 	const char* data; // pointer to store data
-	size_t size; // how many characters in data
+	uint32_t size; // how many characters in data
+	uint32_t id = NoSymbol; // interned symbol id for identifiers, this is what every table after the parser keys on
 };
 
 
@@ -27,22 +44,25 @@ struct StructMember { // for structs
 struct Parameter {
 	TokenType type; // could be primitive type or array or even struct type (user defined) :))
 	StringView name; // name of parameter 
+	StringView structTypeName; // "Player" when type is Struct, like a VarDeclNode's
 };
 
 
 // Base class for all AST nodes
+// nodes live in an ASTContext arena and their destructors never run, so lists are ArenaVectors and not std::vector
 class ASTNode {
 	public:
+	explicit ASTNode(NodeKind k) : kind(k) {}
 	virtual ~ASTNode() = default;
 	virtual void accept(Visitor* visitor) = 0; // so doesn't default to nothing
-	int lin = 0;   // line number in source code
-	int col = 0;
+	NodeKind kind; // what the node really is, StackWalker switches on this instead of going through accept
+	uint32_t offset = 0; // where the node starts in the source, line:col comes from the lexer's LineTable
 };
 // Variable expressions :)
 class ExpressionNode : public ASTNode {
 public:
-	StringView resolvedStructName = { "", 0 }; // Add this!
-	TokenType resolvedType = TokenType::UNKNOWN;
+	using ASTNode::ASTNode;
+	TypeId resolvedType = TypeTable::Unknown; // filled in by SAnalyzer, an id in its TypeTable ( Types.h )
 	// get name if applicable (like VariableExprNode), else empty
 	virtual StringView getName() { return { nullptr, 0 }; }
 };
@@ -50,23 +70,24 @@ public:
 class ProgramNode : public ASTNode {
 public:
 	// A list of everything at the top level: Structs, Functions, Globals
-	std::vector<ASTNode*> declarations;
+	ArenaVector<ASTNode*> declarations;
 
-	ProgramNode() = default;
+	ProgramNode() : ASTNode(NodeKind::Program) {}
 	void accept(Visitor* visitor);
 };
 
 // statement node and its children :)
 class StatementNode : public ASTNode {
 public:
+	using ASTNode::ASTNode;
 	virtual void accept(Visitor* visitor) = 0; // pure virtual
 };
 
 class BlockNode : public StatementNode { // block of statements
 public:
-	std::vector <StatementNode*> statements;
-	BlockNode(std::vector<StatementNode*> stmts)
-		: statements(stmts) {
+	ArenaVector<StatementNode*> statements;
+	BlockNode(ArenaVector<StatementNode*> stmts)
+		: StatementNode(NodeKind::Block), statements(stmts) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -77,7 +98,7 @@ public:
 	BlockNode* thenBranch;
 	BlockNode* elseBranch;
 	IfStatementNode(ExpressionNode* cond, BlockNode* thenB, BlockNode* elseB)
-		: condition(cond), thenBranch(thenB), elseBranch(elseB) {
+		: StatementNode(NodeKind::If), condition(cond), thenBranch(thenB), elseBranch(elseB) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -87,7 +108,7 @@ public:
 	ExpressionNode* condition;
 	BlockNode* body;
 	WhileStatementNode(ExpressionNode* cond, BlockNode* b)
-		: condition(cond), body(b) {
+		: StatementNode(NodeKind::While), condition(cond), body(b) {
 	}
 	void accept(Visitor* visitor);
 
@@ -97,7 +118,7 @@ class ReturnStatementNode : public StatementNode { // return statement
 public:
 	ExpressionNode* value;
 	ReturnStatementNode(ExpressionNode* val)
-		:  value(val) {
+		: StatementNode(NodeKind::Return), value(val) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -105,13 +126,21 @@ public:
 class FunctionDeclNode : public StatementNode { // function declaration
 public:
 	StringView name; // name of function
-	std::vector <std::pair<TokenType,StringView>> parameters; // parameters
+	ArenaVector<Parameter> parameters; // parameters
 	TokenType returnType; // return type/ type of function if u want a void funciton just dont make it equal anything  like int x(); just dont make it equal anything when u call it
-	BlockNode* body; // function body
-	FunctionDeclNode(StringView n, std::vector<std::pair<TokenType, StringView>> params, TokenType retType, BlockNode* b)
-		: name(n), parameters(params), returnType(retType), body(b) {
+	BlockNode* body; // function body, nullptr while it's deferred so passes go through getBody()
+	// deferred body ( Parser::deferBodies ): just the token range, parsed the first time someone calls getBody()
+	ASTContext* deferredIn = nullptr;
+	uint32_t bodyFirst = 0, bodyEnd = 0;
+	FunctionDeclNode(StringView n, ArenaVector<Parameter> params, TokenType retType, BlockNode* b)
+		: StatementNode(NodeKind::Function), name(n), parameters(params), returnType(retType), body(b) {
 	}
+	// not thread safe the first time (it parses into the context's arena)
+	BlockNode* getBody() { return body || !deferredIn ? body : materializeBody(); }
+	bool bodyDeferred() const { return deferredIn && !body; }
 	void accept(Visitor* visitor);
+private:
+	BlockNode* materializeBody();
 };
 
 class VarDeclNode : public StatementNode { // variable declaration
@@ -121,10 +150,10 @@ public:
 	StringView structTypeName; // for struct types, to know which struct it is
 	ExpressionNode* initializer;
 	VarDeclNode(TokenType t, StringView n, ExpressionNode* init)
-		: type(t), name(n), initializer(init) {
+		: StatementNode(NodeKind::VarDecl), type(t), name(n), initializer(init) {
 	}
 	VarDeclNode(TokenType t, StringView n, StringView stname, ExpressionNode* init)
-		: type(t), name(n), structTypeName(stname), initializer(init) {
+		: StatementNode(NodeKind::VarDecl), type(t), name(n), structTypeName(stname), initializer(init) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -132,10 +161,10 @@ public:
 class StructDeclNode : public StatementNode {
 public:
 	StringView name;
-	std::vector<StructMember> members;
+	ArenaVector<StructMember> members;
 
-	StructDeclNode(StringView n, std::vector<StructMember> m)
-		: name(n), members(m) {
+	StructDeclNode(StringView n, ArenaVector<StructMember> m)
+		: StatementNode(NodeKind::StructDecl), name(n), members(m) {
 	}
 
 	void accept(Visitor* visitor);
@@ -146,25 +175,25 @@ public:
 	ExpressionNode* target;
 	ExpressionNode* value;
 	AssignmentNode(ExpressionNode* target, ExpressionNode* value)
-		: target(target), value(value) {}
+		: ExpressionNode(NodeKind::Assign), target(target), value(value) {}
 	void accept(Visitor* visitor);
 };
 
 class LiteralNode : public ExpressionNode { // holds raw numbers, bools, chars
 public:
 	TokenType type;
-	StringView value;
-	LiteralNode(TokenType t, StringView val) : type(t), value(val) {}
+	Constant value; // already decoded by the lexer, no digits left to parse
+	LiteralNode(TokenType t, const Constant& val) : ExpressionNode(NodeKind::Literal), type(t), value(val) {}
 	void accept(Visitor* visitor);
 };
 
 class BinaryOpNode : public ExpressionNode { // +, -, *, /, etc.
 public:
 	TokenType op; // operator type
-	ExpressionNode* left; // note: left and right operands MUST be uploaded to clothesline so memoryleak doesn't explode my computer
+	ExpressionNode* left;
 	ExpressionNode* right;
 	BinaryOpNode(TokenType oper, ExpressionNode* lhs, ExpressionNode* rhs)
-		: op(oper), left(lhs), right(rhs) {
+		: ExpressionNode(NodeKind::Binary), op(oper), left(lhs), right(rhs) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -173,7 +202,7 @@ class UnaryOpNode : public ExpressionNode { // !, - (negation)
 public:
 	TokenType op;              // To store TokenType::OpNot (!)
 	ExpressionNode* expression;  // expression gets unary op applied to
-	UnaryOpNode(ExpressionNode* expr, TokenType opp) : expression(expr), op(opp) {}
+	UnaryOpNode(ExpressionNode* expr, TokenType opp) : ExpressionNode(NodeKind::Unary), op(opp), expression(expr) {}
 	void accept(Visitor* visitor);
 };
 
@@ -181,7 +210,7 @@ class VariableExprNode : public ExpressionNode { // get value of variable named
 public:
 	// The name of the variable being referenced (e.g., "truck" or "x")
 	StringView name;
-	VariableExprNode(StringView n) : name(n) {}
+	VariableExprNode(StringView n) : ExpressionNode(NodeKind::Variable), name(n) {}
 	void accept(Visitor* visitor);
 	StringView getName() override { return name; }
 };
@@ -190,7 +219,7 @@ public:
 	ExpressionNode* base;  // This could be a Variable, another Array, or a Function Call
 	ExpressionNode* index; // The value inside the [ ]
 
-	ArrayIndexNode(ExpressionNode* b, ExpressionNode* i) : base(b), index(i) {}
+	ArrayIndexNode(ExpressionNode* b, ExpressionNode* i) : ExpressionNode(NodeKind::ArrayIndex), base(b), index(i) {}
 	void accept(Visitor* visitor);
 };
 
@@ -199,7 +228,7 @@ public:
 	StringView memberName;
 	ExpressionNode* structExpr;
 	MemberAccessNode(ExpressionNode* stpr, StringView mname)
-		: structExpr(stpr), memberName(mname) {
+		: ExpressionNode(NodeKind::MemberAccess), memberName(mname), structExpr(stpr) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -207,10 +236,10 @@ public:
 class FunctionCallNode : public ExpressionNode {
 public:
 	ExpressionNode* callee; // Usually a VariableExprNode for the function name
-	std::vector<ExpressionNode*> arguments;
+	ArenaVector<ExpressionNode*> arguments;
 
-	FunctionCallNode(ExpressionNode* c, std::vector<ExpressionNode*> a)
-		: callee(c), arguments(a) {
+	FunctionCallNode(ExpressionNode* c, ArenaVector<ExpressionNode*> a)
+		: ExpressionNode(NodeKind::Call), callee(c), arguments(a) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -220,12 +249,16 @@ public:
 	TokenType type;      // int, double, etc.
 	StringView name;     // the identifier
 	int size;            // the fixed size (or an ExpressionNode* if dynamic)
-	std::vector<ExpressionNode*> initializers; // optional initial values
-	ArrayDeclNode(TokenType t, StringView n, int s, std::vector<ExpressionNode*> init)
-		: type(t), name(n), size(s) ,initializers(std::move(init)) { // apparenlty std::move is more efficeint so why not
+	ArenaVector<ExpressionNode*> initializers; // optional initial values
+	StringView structTypeName = { nullptr, 0 }; // element struct for arrays of structs
+	ArrayDeclNode(TokenType t, StringView n, int s, ArenaVector<ExpressionNode*> init)
+		: StatementNode(NodeKind::ArrayDecl), type(t), name(n), size(s) ,initializers(init) {
+	}
+	ArrayDeclNode(TokenType t, StringView n, StringView stname, int s, ArenaVector<ExpressionNode*> init)
+		: StatementNode(NodeKind::ArrayDecl), type(t), name(n), size(s), initializers(init), structTypeName(stname) {
 	}
 	ArrayDeclNode(TokenType t, StringView n, int s) // without initializers
-		: type(t), name(n), size(s) {
+		: StatementNode(NodeKind::ArrayDecl), type(t), name(n), size(s) {
 	}
 	void accept(Visitor* visitor);
 };
@@ -233,6 +266,6 @@ public:
 class ExpressionStatementNode : public StatementNode {
 public:
 	ExpressionNode* expression;
-	ExpressionStatementNode(ExpressionNode* expr) : expression(expr) {}
+	ExpressionStatementNode(ExpressionNode* expr) : StatementNode(NodeKind::ExprStmt), expression(expr) {}
 	void accept(Visitor* visitor);
 };
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "ASTCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// every column of a FlatAST in the order they sit in the file, sema's side tables included
+template <typename AST, typename Fn>
+static void forEachColumn(AST& ast, Fn&& fn) {
+    fn(ast.refs);
+    fn(ast.blocks); fn(ast.ifs); fn(ast.whiles); fn(ast.returns); fn(ast.functions); fn(ast.params);
+    fn(ast.varDecls); fn(ast.structDecls); fn(ast.members); fn(ast.arrayDecls); fn(ast.exprStmts);
+    fn(ast.assigns); fn(ast.literals); fn(ast.binaries); fn(ast.unaries); fn(ast.variables);
+    fn(ast.arrayIndexes); fn(ast.memberAccesses); fn(ast.calls);
+    for (auto& table : ast.resolved) fn(table);
+    fn(ast.structSize);
+    fn(ast.structOf);
+    fn(ast.accessOffset);
+    fn(ast.accessSize);
+    fn(ast.indexStride);
+}
+
+const uint32_t columnCount = 20 + (uint32_t)NodeKind::Count + 5;
+// the sections after the columns
+enum : uint32_t { NameEntries = columnCount, NameText, LineStarts, TypeEntries, TypeParams, SectionCount };
+
+struct CacheSection {
+    uint64_t offset;      // from the start of the file, 8 byte aligned
+    uint32_t count;
+    uint32_t elementSize; // sizeof what wrote it, a different build with other layouts won't match
+};
+
+struct NameEntry {
+    uint32_t offset; // into NameText
+    uint32_t length;
+    uint32_t hash;   // the interner's, so loading doesn't hash every name again
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    ListRef declarations;
+    uint32_t BaJavMode;
+    uint32_t layoutMode; // FlatAST::layoutMode
+    uint32_t nameCount;
+    CacheSection sections[SectionCount];
+};
+
+// a file whose sections all fit can still point anywhere: every NodeRef has to name a node that's there and that
+// nothing else points at (a node with two parents could be its own ancestor, the walk wouldn't end), every list,
+// parameter and member range has to lie in its column, every name and resolved type has to be one of the file's
+// and the side tables IRgen reads have to line up with their nodes
+class RefCheck {
+    const FlatAST& ast;
+    uint32_t nameCount;
+    size_t typeCount;
+    std::vector<uint8_t> taken[(int)NodeKind::Count]; // per kind, the nodes something points at already
+
+    size_t columnSize(NodeKind kind) const {
+        switch (kind) {
+        case NodeKind::Block: return ast.blocks.size();
+        case NodeKind::If: return ast.ifs.size();
+        case NodeKind::While: return ast.whiles.size();
+        case NodeKind::Return: return ast.returns.size();
+        case NodeKind::Function: return ast.functions.size();
+        case NodeKind::VarDecl: return ast.varDecls.size();
+        case NodeKind::StructDecl: return ast.structDecls.size();
+        case NodeKind::ArrayDecl: return ast.arrayDecls.size();
+        case NodeKind::ExprStmt: return ast.exprStmts.size();
+        case NodeKind::Assign: return ast.assigns.size();
+        case NodeKind::Literal: return ast.literals.size();
+        case NodeKind::Binary: return ast.binaries.size();
+        case NodeKind::Unary: return ast.unaries.size();
+        case NodeKind::Variable: return ast.variables.size();
+        case NodeKind::ArrayIndex: return ast.arrayIndexes.size();
+        case NodeKind::MemberAccess: return ast.memberAccesses.size();
+        case NodeKind::Call: return ast.calls.size();
+        default: return 0;
+        }
+    }
+    bool node(NodeRef ref) {
+        if (!ref.valid()) return true;
+        if (ref.kind() >= NodeKind::Count) return false;
+        std::vector<uint8_t>& seen = taken[(int)ref.kind()];
+        if (ref.index() >= seen.size() || seen[ref.index()]) return false;
+        seen[ref.index()] = 1;
+        return true;
+    }
+    bool list(ListRef list) {
+        if ((uint64_t)list.first + list.count > ast.refs.size()) return false;
+        for (uint32_t k = 0; k < list.count; k++) {
+            if (!node(ast.ref(list, k))) return false;
+        }
+        return true;
+    }
+    bool range(uint32_t first, uint32_t count, size_t size) const { return (uint64_t)first + count <= size; }
+    bool name(uint32_t id) const { return id == NoSymbol || id < nameCount; }
+public:
+    RefCheck(const FlatAST& flat, uint32_t names, size_t types) : ast(flat), nameCount(names), typeCount(types) {
+        for (int kind = 0; kind < (int)NodeKind::Count; kind++) taken[kind].assign(columnSize((NodeKind)kind), 0);
+    }
+    bool run() {
+        bool ok = list(ast.declarations);
+        for (const FlatBlock& n : ast.blocks) ok = ok && list(n.statements);
+        for (const FlatIf& n : ast.ifs) ok = ok && node(n.condition) && node(n.thenBranch) && node(n.elseBranch);
+        for (const FlatWhile& n : ast.whiles) ok = ok && node(n.condition) && node(n.body);
+        for (const FlatReturn& n : ast.returns) ok = ok && node(n.value);
+        for (const FlatFunction& n : ast.functions) {
+            ok = ok && name(n.name) && range(n.firstParam, n.paramCount, ast.params.size()) && node(n.body);
+        }
+        for (const FlatParam& n : ast.params) ok = ok && name(n.name) && name(n.structType);
+        for (const FlatVarDecl& n : ast.varDecls) ok = ok && name(n.name) && name(n.structType) && node(n.initializer);
+        for (const FlatStructDecl& n : ast.structDecls) ok = ok && name(n.name) && range(n.firstMember, n.memberCount, ast.members.size());
+        for (const FlatMember& n : ast.members) ok = ok && name(n.name) && name(n.structType);
+        for (const FlatArrayDecl& n : ast.arrayDecls) ok = ok && name(n.name) && name(n.structType) && list(n.initializers);
+        for (const FlatExprStmt& n : ast.exprStmts) ok = ok && node(n.expression);
+        for (const FlatAssign& n : ast.assigns) ok = ok && node(n.target) && node(n.value);
+        for (const FlatBinary& n : ast.binaries) ok = ok && node(n.left) && node(n.right);
+        for (const FlatUnary& n : ast.unaries) ok = ok && node(n.operand);
+        for (const FlatVariable& n : ast.variables) ok = ok && name(n.name);
+        for (const FlatArrayIndex& n : ast.arrayIndexes) ok = ok && node(n.base) && node(n.index);
+        for (const FlatMemberAccess& n : ast.memberAccesses) ok = ok && node(n.base) && name(n.member);
+        for (const FlatCall& n : ast.calls) ok = ok && node(n.callee) && list(n.arguments);
+        if (!ok) return false;
+
+        for (uint32_t entry : ast.structOf) {
+            if (entry != FlatAST::NoStruct && entry >= ast.structDecls.size()) return false;
+        }
+        // one resolved type per expression, none for statements
+        for (int kind = 0; kind < (int)NodeKind::Count; kind++) {
+            const Column<TypeId>& resolved = ast.resolved[kind];
+            if (resolved.size() != (kind >= (int)NodeKind::Assign ? columnSize((NodeKind)kind) : 0)) return false;
+            for (TypeId type : resolved) {
+                if (type >= typeCount) return false;
+            }
+        }
+        return ast.structSize.size() == ast.structDecls.size() && ast.structOf.size() <= nameCount &&
+            ast.accessOffset.size() == ast.memberAccesses.size() && ast.accessSize.size() == ast.memberAccesses.size() &&
+            ast.indexStride.size() == ast.arrayIndexes.size();
+    }
+};
+
+static const char cacheMagic[8] = { 'L', 'U', 'C', 'I', 'A', 'S', 'T', '\0' };
+
+// 8 bytes per step like Interner::hash, a few ms for a big file is nothing next to lexing it
+uint64_t hashSource(const char* data, size_t size) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 29;
+        data += 8;
+        size -= 8;
+    }
+    if (size) {
+        uint64_t word = 0;
+        std::memcpy(&word, data, size);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+    }
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 33);
+}
+
+std::string astCachePath(const std::string& dir, uint64_t sourceHash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.lcc", (unsigned long long)sourceHash);
+    return dir.empty() ? name : dir + "/" + name;
+}
+
+bool storeASTCache(const std::string& path, uint64_t sourceHash, uint64_t sourceSize, const FlatAST& ast,
+    const TypeTable& types, const Interner& names, const LineTable& lines, bool BaJavMode) {
+    CacheHeader header = {};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = ASTCacheVersion;
+    header.sectionCount = SectionCount;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.declarations = ast.declarations;
+    header.BaJavMode = BaJavMode;
+    header.layoutMode = (uint32_t)ast.layoutMode;
+    header.nameCount = names.size();
+
+    std::vector<NameEntry> nameEntries(names.size());
+    std::vector<char> nameText;
+    for (uint32_t id = 0; id < names.size(); id++) {
+        nameEntries[id] = { (uint32_t)nameText.size(), names.length(id), names.hashOf(id) };
+        nameText.insert(nameText.end(), names.text(id), names.text(id) + names.length(id));
+    }
+
+    // lay the sections out, then write them front to back
+    struct Piece { const void* data; size_t bytes; };
+    std::vector<Piece> pieces;
+    uint64_t at = (sizeof(CacheHeader) + 7) & ~7ull;
+    auto place = [&](const void* data, size_t count, uint32_t elementSize) {
+        header.sections[pieces.size()] = { at, (uint32_t)count, elementSize };
+        pieces.push_back({ data, count * elementSize });
+        at = (at + count * elementSize + 7) & ~7ull;
+    };
+    forEachColumn(ast, [&](const auto& column) { place(column.data(), column.size(), sizeof(*column.data())); });
+    place(nameEntries.data(), nameEntries.size(), sizeof(NameEntry));
+    place(nameText.data(), nameText.size(), 1);
+    place(lines.starts().data(), lines.starts().size(), sizeof(uint32_t));
+    place(types.allEntries().data(), types.allEntries().size(), sizeof(TypeTable::Entry));
+    place(types.allParams().data(), types.allParams().size(), sizeof(TypeId));
+
+    // written under a temporary name and renamed, so a reader never maps a half written file
+    std::string temp = path + ".tmp" + std::to_string(std::random_device()());
+    std::FILE* out = std::fopen(temp.c_str(), "wb");
+    if (!out) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    uint64_t written = sizeof(header);
+    static const char zeros[8] = {};
+    for (size_t k = 0; ok && k < pieces.size(); k++) {
+        ok = std::fwrite(zeros, 1, header.sections[k].offset - written, out) == header.sections[k].offset - written;
+        if (ok && pieces[k].bytes) ok = std::fwrite(pieces[k].data, 1, pieces[k].bytes, out) == pieces[k].bytes;
+        written = header.sections[k].offset + pieces[k].bytes;
+    }
+    ok = std::fclose(out) == 0 && ok;
+    if (ok) {
+        std::remove(path.c_str()); // rename won't replace an existing file everywhere
+        ok = std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) std::remove(temp.c_str());
+    return ok;
+}
+
+bool loadASTCache(SourceManager& files, const std::string& path, uint64_t sourceHash, uint64_t sourceSize, CachedProgram& out) {
+    FileID id = files.addFile(path);
+    if (id == InvalidFileID) return false;
+    const SourceFile& file = files.file(id);
+    if (file.size < sizeof(CacheHeader)) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, file.data, sizeof(header));
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != ASTCacheVersion ||
+        header.sectionCount != SectionCount || header.sourceHash != sourceHash || header.sourceSize != sourceSize ||
+        header.layoutMode > (uint32_t)LayoutMode::Packed) {
+        return false;
+    }
+    auto fits = [&](const CacheSection& section, size_t elementSize) {
+        return section.elementSize == elementSize && section.offset % 8 == 0 &&
+            section.offset + (uint64_t)section.count * elementSize <= file.size;
+    };
+
+    // the columns become views of the mapping, nothing is copied
+    uint32_t k = 0;
+    bool ok = true;
+    forEachColumn(out.ast, [&](auto& column) {
+        using T = std::remove_const_t<std::remove_pointer_t<decltype(column.data())>>;
+        const CacheSection& section = header.sections[k++];
+        if (!fits(section, sizeof(T))) ok = false;
+        else column.view((const T*)(file.data + section.offset), section.count);
+    });
+    const CacheSection& entries = header.sections[NameEntries];
+    const CacheSection& text = header.sections[NameText];
+    const CacheSection& lines = header.sections[LineStarts];
+    const CacheSection& typeEntries = header.sections[TypeEntries];
+    const CacheSection& typeParams = header.sections[TypeParams];
+    if (!ok || !fits(entries, sizeof(NameEntry)) || entries.count != header.nameCount || !fits(text, 1) ||
+        !fits(lines, sizeof(uint32_t)) || !fits(typeEntries, sizeof(TypeTable::Entry)) || !fits(typeParams, sizeof(TypeId))) {
+        return false;
+    }
+
+    // the interner takes the names back in id order, the text stays in the mapping
+    const NameEntry* name = (const NameEntry*)(file.data + entries.offset);
+    const char* chars = file.data + text.offset;
+    for (uint32_t i = 0; i < entries.count; i++) {
+        if ((uint64_t)name[i].offset + name[i].length > text.count) return false;
+        if (out.names.intern(chars + name[i].offset, name[i].length, name[i].hash) != i) return false;
+    }
+    // the types go back in id order, each has to come out under the id it had
+    const TypeTable::Entry* type = (const TypeTable::Entry*)(file.data + typeEntries.offset);
+    const TypeId* params = (const TypeId*)(file.data + typeParams.offset);
+    for (uint32_t i = 0; i < typeEntries.count; i++) {
+        const TypeTable::Entry& entry = type[i];
+        if (entry.kind == TypeKind::Struct && entry.a != NoSymbol && entry.a >= entries.count) return false;
+        if (entry.kind == TypeKind::Function && (uint64_t)entry.b + entry.c > typeParams.count) return false;
+        if (!out.types.restore(i, entry, entry.kind == TypeKind::Function ? params + entry.b : nullptr)) return false;
+    }
+    out.lineStarts.view((const uint32_t*)(file.data + lines.offset), lines.count);
+    out.ast.declarations = header.declarations;
+    out.BaJavMode = header.BaJavMode != 0;
+    out.ast.layoutMode = (LayoutMode)header.layoutMode;
+    return RefCheck(out.ast, entries.count, out.types.size()).run(); // a file that fails it is a miss like any other
+}
+
+SourceLoc CachedProgram::location(uint32_t offset) const {
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    if (it == lineStarts.begin()) return { 1, (int)offset + 1 };
+    size_t line = (it - lineStarts.begin()) - 1;
+    return { (int)line + 1, (int)(offset - lineStarts[line]) + 1 };
+}
@@ -0,0 +1,48 @@
+#pragma once
+/*
+	AST cache
+	a flat AST that sema already went over, written to disk so an unchanged source skips lexing, parsing and sema
+	- keyed by a 64 bit hash of the source bytes (and its size), the file is <cache dir>/<hash in hex>.lcc
+	- the file is a header with a section table, then every FlatAST column back to back (8 byte aligned),
+	  the names (interner text, ids unchanged), the line table and sema's TypeTable. Nodes only refer to each other by index
+	  (NodeRef/ListRef), so the mapping is used as it is: loading points the columns at it, nothing is copied. one
+	  pass checks every ref, list and name against the columns first, a file that doesn't line up is a miss
+	- struct sizes, member offsets, array strides, the layout mode and node offsets all come along, so
+	  IRgen::generate can run on it right away. the resolved types come with the TypeTable they're ids in, read
+	  back in id order so every id means what it did (a type that refers past itself or to a missing name is a miss)
+	- ASTCacheVersion goes up whenever a Flat* struct, a side table or Constant changes, and every section records
+	  its element size on top of that, a file from another version or build is just a miss
+	- only programs without semantic errors get stored, a hit never has anything to report
+*/
+#include "FlatAST.h"
+#include "Types.h"
+#include "../Lexer/Interner.h"
+#include "../Lexer/SourceLocation.h"
+#include "../Lexer/SourceManager.h"
+#include <cstdint>
+#include <string>
+
+const uint32_t ASTCacheVersion = 7;
+
+// what a cache hit hands back, the columns and names point into the mapped file (the SourceManager keeps it)
+struct CachedProgram {
+	Interner names;
+	FlatAST ast;
+	TypeTable types; // what ast.resolved's ids mean
+	Column<uint32_t> lineStarts;
+	bool BaJavMode = false;
+
+	CachedProgram() : ast(names) {}
+	CachedProgram(const CachedProgram&) = delete; // ast points at names
+	CachedProgram& operator=(const CachedProgram&) = delete;
+
+	SourceLoc location(uint32_t offset) const; // same answer the lexer's LineTable gives
+};
+
+uint64_t hashSource(const char* data, size_t size);
+std::string astCachePath(const std::string& dir, uint64_t sourceHash);
+// write a checked program, false if the file couldn't be written (a cache is optional, callers just carry on)
+bool storeASTCache(const std::string& path, uint64_t sourceHash, uint64_t sourceSize, const FlatAST& ast,
+	const TypeTable& types, const Interner& names, const LineTable& lines, bool BaJavMode);
+// map path and check it belongs to this source, false on a miss (no file, other source, other version)
+bool loadASTCache(SourceManager& files, const std::string& path, uint64_t sourceHash, uint64_t sourceSize, CachedProgram& out);
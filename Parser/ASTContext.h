@@ -0,0 +1,58 @@
+#pragma once
+/*
+	ASTContext
+	owns the AST, every node and every node list is made in its arena, so the tree lives exactly as long as the context
+	(not as long as the Parser, the parser can go away right after ParseProgram and sema/irgen keep working)
+	tearing it down is one free per arena block, no walk over the nodes
+	a parallel parse gives every worker an arena of its own (newArena), they all die with the context
+	with deferred function bodies the token stream moves in here too, so bodies can still be parsed after the
+	Parser is gone (the Lexer has to stay around as long as that can happen, the tokens point into its source)
+*/
+#include "AST.h"
+#include "../Lexer/Token.h"
+#include "../Support/Arena.h"
+#include <memory>
+#include <vector>
+
+class Lexer;
+
+class ASTContext {
+	Arena arena;
+	std::vector<std::unique_ptr<Arena>> workerArenas;
+public:
+	ProgramNode* root = nullptr; // set by Parser::ParseProgram
+	// what deferred function bodies are parsed from, set by Parser::ParseProgram when bodies were deferred
+	struct DeferredSource {
+		Lexer* lexer = nullptr;
+		std::vector<Token> tokens;
+		bool BaJavMode = false;
+	} deferred;
+
+	ASTContext() = default;
+	ASTContext(const ASTContext&) = delete;
+	ASTContext& operator=(const ASTContext&) = delete;
+
+	template <typename T, typename... Args>
+	T* make(Args&&... args) { return arena.make<T>(std::forward<Args>(args)...); }
+
+	// a finished list (block statements, arguments ..) copied into the arena
+	template <typename T>
+	ArenaVector<T> list(const std::vector<T>& items) { return ArenaVector<T>(arena, items); }
+
+	Arena& getArena() { return arena; }
+	// one more arena owned by the context, not thread safe, hand them out before the workers start
+	Arena& newArena() {
+		workerArenas.push_back(std::make_unique<Arena>());
+		return *workerArenas.back();
+	}
+	size_t bytesUsed() const {
+		size_t total = arena.bytesUsed();
+		for (const auto& extra : workerArenas) total += extra->bytesUsed();
+		return total;
+	}
+	size_t blocks() const {
+		size_t total = arena.blocks();
+		for (const auto& extra : workerArenas) total += extra->blocks();
+		return total;
+	}
+};
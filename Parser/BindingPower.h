@@ -0,0 +1,57 @@
+#pragma once
+/*
+	Binding powers for the Pratt expression parser ( Parser::parseExpression )
+	every infix operator has a left and a right power, the parser keeps eating operators while their left power
+	is at least the minimum it was called with, and parses the right side with the right power as the new minimum
+	- left < right  -> left associative   (a - b - c is (a - b) - c)
+	- left > right  -> right associative  (a = b = c is a = (b = c))
+	- 0 means "not an infix operator", that's what ends an expression
+	prefix ! and - bind tighter than every infix operator, postfix . [] () are part of the primary and bind tighter still
+	built at compile time like the lexer tables
+*/
+#include "../Lexer/Token.h"
+#include <cstdint>
+
+struct BindingPower {
+	uint8_t left;
+	uint8_t right;
+};
+
+struct BindingPowers {
+	BindingPower infix[256];
+	uint8_t prefix[256]; // 0 = not a prefix operator
+};
+
+constexpr BindingPowers makeBindingPowers() {
+	BindingPowers t{};
+	auto set = [&](TokenType type, uint8_t left, uint8_t right) { t.infix[(uint8_t)type] = { left, right }; };
+
+	set(TokenType::OpAssign, 2, 1); // lowest, right associative
+	set(TokenType::OpOr, 3, 4);
+	set(TokenType::OpAnd, 5, 6);
+	set(TokenType::OpIsEqual, 7, 8);
+	set(TokenType::OpIsNotEqual, 7, 8);
+	set(TokenType::OpLess, 9, 10);
+	set(TokenType::OpGreater, 9, 10);
+	set(TokenType::OpIsLessEqual, 9, 10);
+	set(TokenType::OpIsGreaterEqual, 9, 10);
+	set(TokenType::OpPlus, 11, 12);
+	set(TokenType::OpMinus, 11, 12);
+	set(TokenType::OpStar, 13, 14);
+	set(TokenType::OpSlash, 13, 14);
+	set(TokenType::OpMod, 13, 14);
+
+	t.prefix[(uint8_t)TokenType::Not] = 15;
+	t.prefix[(uint8_t)TokenType::OpMinus] = 15;
+	return t;
+}
+
+inline constexpr BindingPowers bindingPowers = makeBindingPowers();
+
+inline BindingPower infixPower(TokenType type) {
+	return bindingPowers.infix[(uint8_t)type];
+}
+
+inline uint8_t prefixPower(TokenType type) {
+	return bindingPowers.prefix[(uint8_t)type];
+}
@@ -0,0 +1,222 @@
+#include "FlatAST.h"
+#include "../SAnalyzer/StackWalker.h"
+
+// walks the tree once and appends every node to its kind's array, children first. a StackWalker, so a 1M term sum
+// flattens like any other: a finished node leaves its ref on built, its parent takes them back off when it's done
+class FlatBuilder final : public StackWalker<FlatBuilder> {
+    friend class StackWalker<FlatBuilder>;
+    FlatAST& ast;
+    std::vector<NodeRef> built; // refs of finished nodes whose parent isn't done yet (nested ones stack on top)
+    uint32_t limit;             // nodes per kind
+
+    template <typename T>
+    ASTNode* add(NodeKind kind, Column<T>& array, const T& node) {
+        if (array.size() >= limit) {
+            // its index wouldn't fit in a NodeRef, the walk finishes (the refs stay balanced) but the result is thrown away
+            overflow = true;
+            built.push_back(NodeRef());
+            return nullptr;
+        }
+        array.push_back(node);
+        built.push_back(NodeRef::make(kind, (uint32_t)array.size() - 1));
+        return nullptr;
+    }
+    // a child's ref back off built, take them last child first (a missing child never left one)
+    NodeRef take(ASTNode* child) {
+        if (!child) return NodeRef();
+        NodeRef ref = built.back();
+        built.pop_back();
+        return ref;
+    }
+    // the refs built since mark, as a list
+    ListRef takeList(int mark) {
+        ListRef list = { (uint32_t)ast.refs.size(), (uint32_t)(built.size() - mark) };
+        ast.refs.append(built.data() + mark, built.size() - mark);
+        built.resize(mark);
+        return list;
+    }
+    // the items of a list one by one, frame.saved[0] is where built was before the first
+    template <typename Node>
+    ASTNode* items(WalkFrame& frame, const ArenaVector<Node*>& nodes) {
+        if (frame.step == 0) frame.saved[0] = (int)built.size();
+        while (frame.step < nodes.size()) {
+            Node* node = nodes[frame.step++];
+            if (pending(node)) return node;
+        }
+        return nullptr;
+    }
+
+    ASTNode* resume(ProgramNode* node, WalkFrame& frame) {
+        if (ASTNode* decl = items(frame, node->declarations)) return decl;
+        ast.declarations = takeList(frame.saved[0]);
+        return nullptr;
+    }
+    ASTNode* resume(BlockNode* node, WalkFrame& frame) {
+        if (ASTNode* statement = items(frame, node->statements)) return statement;
+        return add(NodeKind::Block, ast.blocks, { node->offset, takeList(frame.saved[0]) });
+    }
+    ASTNode* resume(IfStatementNode* node, WalkFrame& frame) {
+        if (ASTNode* child = next(frame, { node->condition, node->thenBranch, node->elseBranch })) return child;
+        NodeRef elseBranch = take(node->elseBranch);
+        NodeRef thenBranch = take(node->thenBranch);
+        NodeRef condition = take(node->condition);
+        return add(NodeKind::If, ast.ifs, { node->offset, condition, thenBranch, elseBranch });
+    }
+    ASTNode* resume(WhileStatementNode* node, WalkFrame& frame) {
+        if (ASTNode* child = next(frame, { node->condition, node->body })) return child;
+        NodeRef body = take(node->body);
+        NodeRef condition = take(node->condition);
+        return add(NodeKind::While, ast.whiles, { node->offset, condition, body });
+    }
+    ASTNode* resume(ReturnStatementNode* node, WalkFrame& frame) {
+        if (ASTNode* value = next(frame, { node->value })) return value;
+        return add(NodeKind::Return, ast.returns, { node->offset, take(node->value) });
+    }
+    ASTNode* resume(FunctionDeclNode* node, WalkFrame& frame) {
+        if (frame.step == 0) {
+            frame.step = 1;
+            frame.saved[0] = (int)ast.params.size();
+            for (auto& param : node->parameters) ast.params.push_back({ param.type, param.name.id, param.structTypeName.id });
+            BlockNode* body = node->getBody();
+            if (pending(body)) return body;
+        }
+        uint32_t firstParam = (uint32_t)frame.saved[0];
+        return add(NodeKind::Function, ast.functions,
+            { node->offset, node->name.id, node->returnType, firstParam, (uint32_t)node->parameters.size(), take(node->getBody()) });
+    }
+    ASTNode* resume(VarDeclNode* node, WalkFrame& frame) {
+        if (ASTNode* init = next(frame, { node->initializer })) return init;
+        return add(NodeKind::VarDecl, ast.varDecls,
+            { node->offset, node->type, node->name.id, node->structTypeName.id, take(node->initializer) });
+    }
+    ASTNode* resume(StructDeclNode* node, WalkFrame&) {
+        uint32_t firstMember = (uint32_t)ast.members.size();
+        for (auto& member : node->members) ast.members.push_back({ member.type, member.name.id, member.structTypeName.id });
+        return add(NodeKind::StructDecl, ast.structDecls,
+            { node->offset, node->name.id, firstMember, (uint32_t)node->members.size() });
+    }
+    ASTNode* resume(ArrayDeclNode* node, WalkFrame& frame) {
+        if (ASTNode* init = items(frame, node->initializers)) return init;
+        return add(NodeKind::ArrayDecl, ast.arrayDecls,
+            { node->offset, node->type, node->name.id, node->structTypeName.id, node->size, takeList(frame.saved[0]) });
+    }
+    ASTNode* resume(ExpressionStatementNode* node, WalkFrame& frame) {
+        if (ASTNode* expression = next(frame, { node->expression })) return expression;
+        return add(NodeKind::ExprStmt, ast.exprStmts, { node->offset, take(node->expression) });
+    }
+
+    ASTNode* resume(AssignmentNode* node, WalkFrame& frame) {
+        if (ASTNode* child = next(frame, { node->target, node->value })) return child;
+        NodeRef value = take(node->value);
+        NodeRef target = take(node->target);
+        return add(NodeKind::Assign, ast.assigns, { node->offset, target, value });
+    }
+    ASTNode* resume(LiteralNode* node, WalkFrame&) {
+        return add(NodeKind::Literal, ast.literals, { node->offset, node->value });
+    }
+    ASTNode* resume(BinaryOpNode* node, WalkFrame& frame) {
+        if (ASTNode* child = next(frame, { node->left, node->right })) return child;
+        NodeRef right = take(node->right);
+        NodeRef left = take(node->left);
+        return add(NodeKind::Binary, ast.binaries, { node->offset, node->op, left, right });
+    }
+    ASTNode* resume(UnaryOpNode* node, WalkFrame& frame) {
+        if (ASTNode* operand = next(frame, { node->expression })) return operand;
+        return add(NodeKind::Unary, ast.unaries, { node->offset, node->op, take(node->expression) });
+    }
+    ASTNode* resume(VariableExprNode* node, WalkFrame&) {
+        return add(NodeKind::Variable, ast.variables, { node->offset, node->name.id });
+    }
+    ASTNode* resume(ArrayIndexNode* node, WalkFrame& frame) {
+        if (ASTNode* child = next(frame, { node->base, node->index })) return child;
+        NodeRef index = take(node->index);
+        NodeRef base = take(node->base);
+        return add(NodeKind::ArrayIndex, ast.arrayIndexes, { node->offset, base, index });
+    }
+    ASTNode* resume(MemberAccessNode* node, WalkFrame& frame) {
+        if (ASTNode* base = next(frame, { node->structExpr })) return base;
+        return add(NodeKind::MemberAccess, ast.memberAccesses, { node->offset, take(node->structExpr), node->memberName.id });
+    }
+    ASTNode* resume(FunctionCallNode* node, WalkFrame& frame) {
+        // step 0 is the callee, then the arguments (their list starts above the callee's ref)
+        if (frame.step == 0) {
+            frame.step = 1;
+            if (pending(node->callee)) return node->callee;
+        }
+        if (frame.step == 1) frame.saved[0] = (int)built.size();
+        while (frame.step - 1 < node->arguments.size()) {
+            ASTNode* arg = node->arguments[frame.step++ - 1];
+            if (pending(arg)) return arg;
+        }
+        ListRef arguments = takeList(frame.saved[0]);
+        return add(NodeKind::Call, ast.calls, { node->offset, take(node->callee), arguments });
+    }
+public:
+    bool overflow = false;
+
+    FlatBuilder(FlatAST& target, uint32_t nodeLimit) : ast(target), limit(nodeLimit) {}
+};
+
+bool flatten(ProgramNode* program, FlatAST& ast, uint32_t nodeLimit) {
+    FlatBuilder builder(ast, nodeLimit < NodeRef::indexLimit ? nodeLimit : NodeRef::indexLimit);
+    builder.walk(program);
+    if (builder.overflow) return false;
+
+    // one side table entry per expression, same index as the node
+    ast.resolved[(int)NodeKind::Assign].resize(ast.assigns.size());
+    ast.resolved[(int)NodeKind::Literal].resize(ast.literals.size());
+    ast.resolved[(int)NodeKind::Binary].resize(ast.binaries.size());
+    ast.resolved[(int)NodeKind::Unary].resize(ast.unaries.size());
+    ast.resolved[(int)NodeKind::Variable].resize(ast.variables.size());
+    ast.resolved[(int)NodeKind::ArrayIndex].resize(ast.arrayIndexes.size());
+    ast.resolved[(int)NodeKind::MemberAccess].resize(ast.memberAccesses.size());
+    ast.resolved[(int)NodeKind::Call].resize(ast.calls.size());
+    ast.structSize.assign(ast.structDecls.size(), 0);
+    ast.structOf.assign(ast.names->size(), FlatAST::NoStruct);
+    ast.accessOffset.assign(ast.memberAccesses.size(), -1);
+    ast.accessSize.assign(ast.memberAccesses.size(), 8);
+    ast.indexStride.assign(ast.arrayIndexes.size(), 8);
+    return true;
+}
+
+uint32_t FlatAST::offsetOf(NodeRef node) const {
+    uint32_t i = node.index();
+    switch (node.kind()) {
+    case NodeKind::Block: return blocks[i].offset;
+    case NodeKind::If: return ifs[i].offset;
+    case NodeKind::While: return whiles[i].offset;
+    case NodeKind::Return: return returns[i].offset;
+    case NodeKind::Function: return functions[i].offset;
+    case NodeKind::VarDecl: return varDecls[i].offset;
+    case NodeKind::StructDecl: return structDecls[i].offset;
+    case NodeKind::ArrayDecl: return arrayDecls[i].offset;
+    case NodeKind::ExprStmt: return exprStmts[i].offset;
+    case NodeKind::Assign: return assigns[i].offset;
+    case NodeKind::Literal: return literals[i].offset;
+    case NodeKind::Binary: return binaries[i].offset;
+    case NodeKind::Unary: return unaries[i].offset;
+    case NodeKind::Variable: return variables[i].offset;
+    case NodeKind::ArrayIndex: return arrayIndexes[i].offset;
+    case NodeKind::MemberAccess: return memberAccesses[i].offset;
+    case NodeKind::Call: return calls[i].offset;
+    default: return 0;
+    }
+}
+
+size_t FlatAST::nodeCount() const {
+    return blocks.size() + ifs.size() + whiles.size() + returns.size() + functions.size() + varDecls.size() +
+        structDecls.size() + arrayDecls.size() + exprStmts.size() + assigns.size() + literals.size() +
+        binaries.size() + unaries.size() + variables.size() + arrayIndexes.size() + memberAccesses.size() + calls.size();
+}
+
+size_t FlatAST::bytes() const {
+    size_t total = refs.size() * sizeof(NodeRef) + params.size() * sizeof(FlatParam) + members.size() * sizeof(FlatMember);
+    total += blocks.size() * sizeof(FlatBlock) + ifs.size() * sizeof(FlatIf) + whiles.size() * sizeof(FlatWhile) +
+        returns.size() * sizeof(FlatReturn) + functions.size() * sizeof(FlatFunction) + varDecls.size() * sizeof(FlatVarDecl) +
+        structDecls.size() * sizeof(FlatStructDecl) + arrayDecls.size() * sizeof(FlatArrayDecl) + exprStmts.size() * sizeof(FlatExprStmt);
+    total += assigns.size() * sizeof(FlatAssign) + literals.size() * sizeof(FlatLiteral) + binaries.size() * sizeof(FlatBinary) +
+        unaries.size() * sizeof(FlatUnary) + variables.size() * sizeof(FlatVariable) + arrayIndexes.size() * sizeof(FlatArrayIndex) +
+        memberAccesses.size() * sizeof(FlatMemberAccess) + calls.size() * sizeof(FlatCall);
+    for (const auto& table : resolved) total += table.size() * sizeof(TypeId);
+    return total + structSize.size() * sizeof(int) + structOf.size() * sizeof(uint32_t) + (accessOffset.size() + accessSize.size() + indexStride.size()) * sizeof(int);
+}
@@ -0,0 +1,156 @@
+#pragma once
+/*
+	Flat AST
+	the same program as the ProgramNode tree, but every kind of node sits in its own contiguous array and nodes point
+	at each other with 32 bit NodeRefs (kind in the top 5 bits, index in that kind's array in the rest)
+	- no vtables, no 8 byte child pointers, names are just symbol ids (the interner has the text)
+	- child lists (block statements, call arguments ..) are ranges into one shared refs array
+	- what sema works out (resolved types, struct sizes, member offsets, array strides) lives in side tables next to
+	  the node arrays instead of in every expression node
+	build one from a parsed tree with flatten(), SAnalyzer::analyze and IRgen::generate walk it
+	nothing in here holds a pointer, so the arrays can be written to disk as they are and used straight from a
+	mapping again ( Parser/ASTCache.h ), that's what Column is for
+*/
+#include "AST.h"
+#include "../Lexer/Constants.h"
+#include "../Lexer/Interner.h"
+#include "../SAnalyzer/StructLayout.h"
+#include <cstdint>
+#include <vector>
+
+// one node array: owns its elements while the flat AST is built and checked, or is a view of someone else's
+// (a mapped cache file), reads are the same either way, don't write to a viewed column
+template <typename T>
+class Column {
+	std::vector<T> storage;
+	T* items = nullptr;
+	uint32_t count = 0;
+	void sync() { items = storage.data(); count = (uint32_t)storage.size(); }
+public:
+	Column() = default;
+	Column(const Column&) = delete;
+	Column& operator=(const Column&) = delete;
+	Column(Column&&) = default; // the vector keeps its buffer, so items stays valid
+	Column& operator=(Column&&) = default;
+
+	void push_back(const T& value) { storage.push_back(value); sync(); }
+	void append(const T* first, size_t n) { storage.insert(storage.end(), first, first + n); sync(); }
+	void resize(size_t n) { storage.resize(n); sync(); }
+	void assign(size_t n, const T& value) { storage.assign(n, value); sync(); }
+	void view(const T* first, size_t n) {
+		std::vector<T>().swap(storage);
+		items = const_cast<T*>(first);
+		count = (uint32_t)n;
+	}
+
+	size_t size() const { return count; }
+	T& operator[](size_t i) { return items[i]; }
+	const T& operator[](size_t i) const { return items[i]; }
+	const T* data() const { return items; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+};
+
+// NodeKind (AST.h) is the kind part of a NodeRef, there are no Program nodes in here
+struct NodeRef {
+	uint32_t bits = UINT32_MAX; // default is "no node"
+
+	static const uint32_t indexBits = 27;
+	static const uint32_t indexLimit = 1u << indexBits; // most nodes one kind can have, flatten() checks it
+	static NodeRef make(NodeKind kind, uint32_t index) { return { ((uint32_t)kind << indexBits) | index }; }
+	NodeKind kind() const { return (NodeKind)(bits >> indexBits); }
+	uint32_t index() const { return bits & ((1u << indexBits) - 1); }
+	bool valid() const { return bits != UINT32_MAX; }
+};
+
+struct ListRef {
+	uint32_t first = 0; // into FlatAST::refs
+	uint32_t count = 0;
+};
+
+// --- statements ---
+struct FlatBlock { uint32_t offset; ListRef statements; };
+struct FlatIf { uint32_t offset; NodeRef condition, thenBranch, elseBranch; };
+struct FlatWhile { uint32_t offset; NodeRef condition, body; };
+struct FlatReturn { uint32_t offset; NodeRef value; };
+struct FlatParam { TokenType type; uint32_t name, structType; };
+struct FlatFunction { uint32_t offset; uint32_t name; TokenType returnType; uint32_t firstParam, paramCount; NodeRef body; };
+struct FlatVarDecl { uint32_t offset; TokenType type; uint32_t name, structType; NodeRef initializer; };
+struct FlatMember { TokenType type; uint32_t name, structType; };
+struct FlatStructDecl { uint32_t offset; uint32_t name; uint32_t firstMember, memberCount; };
+struct FlatArrayDecl { uint32_t offset; TokenType type; uint32_t name, structType; int size; ListRef initializers; };
+struct FlatExprStmt { uint32_t offset; NodeRef expression; };
+
+// --- expressions ---
+struct FlatAssign { uint32_t offset; NodeRef target, value; };
+struct FlatLiteral { uint32_t offset; Constant value; };
+struct FlatBinary { uint32_t offset; TokenType op; NodeRef left, right; };
+struct FlatUnary { uint32_t offset; TokenType op; NodeRef operand; };
+struct FlatVariable { uint32_t offset; uint32_t name; };
+struct FlatArrayIndex { uint32_t offset; NodeRef base, index; };
+struct FlatMemberAccess { uint32_t offset; NodeRef base; uint32_t member; };
+struct FlatCall { uint32_t offset; NodeRef callee; ListRef arguments; };
+
+class FlatAST {
+public:
+	const Interner* names = nullptr;
+	ListRef declarations; // the top level, in source order
+	Column<NodeRef> refs;
+
+	Column<FlatBlock> blocks;
+	Column<FlatIf> ifs;
+	Column<FlatWhile> whiles;
+	Column<FlatReturn> returns;
+	Column<FlatFunction> functions;
+	Column<FlatParam> params;
+	Column<FlatVarDecl> varDecls;
+	Column<FlatStructDecl> structDecls;
+	Column<FlatMember> members;
+	Column<FlatArrayDecl> arrayDecls;
+	Column<FlatExprStmt> exprStmts;
+
+	Column<FlatAssign> assigns;
+	Column<FlatLiteral> literals;
+	Column<FlatBinary> binaries;
+	Column<FlatUnary> unaries;
+	Column<FlatVariable> variables;
+	Column<FlatArrayIndex> arrayIndexes;
+	Column<FlatMemberAccess> memberAccesses;
+	Column<FlatCall> calls;
+
+	// --- side tables (sema) ---
+	Column<TypeId> resolved[(int)NodeKind::Count];       // per expression kind, same index as the node (sema's TypeTable)
+	Column<int> structSize;                              // per structDecls entry, bytes
+	Column<uint32_t> structOf;                           // symbol id -> structDecls index (NoStruct for anything else)
+	Column<int> accessOffset;                            // per memberAccesses entry, bytes into the struct (-1 = base isn't one)
+	Column<int> accessSize;                              // per memberAccesses entry, bytes a store writes there
+	Column<int> indexStride;                             // per arrayIndexes entry, bytes from one element to the next
+	LayoutMode layoutMode = LayoutMode::Slots;           // the mode sema laid the program out in, IRgen sizes primitives by it
+	static constexpr uint32_t NoStruct = UINT32_MAX;
+
+	explicit FlatAST(const Interner& symbols) : names(&symbols) {}
+
+	NodeRef ref(ListRef list, uint32_t i) const { return refs[list.first + i]; }
+	// the struct declared under a name, NoStruct if there's none (or the name is NoSymbol)
+	uint32_t structIndex(uint32_t name) const { return name < structOf.size() ? structOf[name] : NoStruct; }
+	TypeId& type(NodeRef node) { return resolved[(int)node.kind()][node.index()]; }
+	TypeId type(NodeRef node) const { return resolved[(int)node.kind()][node.index()]; }
+	// a symbol id back as a StringView (what the symbol table and error messages work with)
+	StringView name(uint32_t id) const {
+		if (id == NoSymbol) return { "", 0 };
+		return { names->text(id), names->length(id), id };
+	}
+	// the name of a plain variable expression, empty for anything else (like ExpressionNode::getName)
+	StringView nameOf(NodeRef node) const {
+		if (node.valid() && node.kind() == NodeKind::Variable) return name(variables[node.index()].name);
+		return { nullptr, 0 };
+	}
+	uint32_t offsetOf(NodeRef node) const;
+	size_t nodeCount() const;
+	size_t bytes() const; // memory held by the node arrays and side tables
+};
+
+// builds the flat form of a parsed program into out, the tree can be thrown away afterwards
+// false if some kind has more than nodeLimit nodes (a NodeRef can't index past NodeRef::indexLimit), out is no
+// use then and the program has to go through the tree passes
+bool flatten(ProgramNode* program, FlatAST& out, uint32_t nodeLimit = NodeRef::indexLimit);
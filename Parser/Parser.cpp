@@ -1,9 +1,10 @@
 #include "Parser.h" // for Parser class
-#include <vector> // for clothesline
-#include <stack> // for shunting yard algorithm
-#include <queue> // for shunting yard algorithm
+#include "../Support/ThreadPool.h" // parallel parsing of top level declarations
+#include <vector> // pre-scan and run lists of a parallel parse
 #include <iostream> // for error output
 #include <string> // for some shenanigans
+#include <climits> // INT_MAX for array sizes
+#include <algorithm> // lower_bound over declaration starts
 
 /*
     HELPER FUNCTIONS
@@ -18,19 +19,27 @@ bool Parser::match(TokenType type) {
 }
 
 Token Parser::Peek(int n) {
-    if (pos + n >= tokens.size()) return tokens.back();
-    return tokens[pos + n];
+    if (pos + n >= end) return tokenAt(end);
+    return stream[pos + n];
 }
 
 void Parser::advance() {
-    if (pos < tokens.size() - 1) {
+    if (pos < end) {
         pos++;
-        currentToken = tokens[pos];
+        currentToken = tokenAt(pos);
     }
 }
 
 void Parser::error(const char* message) {
-    std::cerr << "[Parser Error] Line " << currentToken.line << ", Column " << currentToken.column << ": " << message << std::endl;
+    if (deferErrors) {
+        // a worker: give up on this range, running into Eof makes every loop above us stop
+        failed = true;
+        pos = end;
+        currentToken = tokenAt(end);
+        return;
+    }
+    SourceLoc loc = lexer.location(currentToken.offset);
+    std::cerr << "[Parser Error] Line " << loc.line << ", Column " << loc.column << ": " << message << std::endl;
     exit(1);
 }
 
@@ -51,51 +60,7 @@ Token Parser::consume(TokenType Tok) {
     }
     error("Unexpected token");
 
-    return Token(TokenType::UNKNOWN, "", 0, -1, -1);
-}
-
-int Parser::getPrec(TokenType type) {
-    if (type == TokenType::Not) return 5;
-    if (type == TokenType::OpStar || type == TokenType::OpSlash) return 4;
-    if (type == TokenType::OpPlus || type == TokenType::OpMinus) return 3;
-
-    if (type == TokenType::OpLess || type == TokenType::OpGreater ||
-        type == TokenType::OpIsLessEqual || type == TokenType::OpIsGreaterEqual) {
-        return 2;
-    }
-
-    if (type == TokenType::OpIsEqual || type == TokenType::OpIsNotEqual) {
-        return 1;
-    }
-
-    if (type == TokenType::OpAssign) return 0; // Assignment is lowest
-
-    return -1;
-}
-
-bool Parser::isOperator(TokenType type) {
-    return type == TokenType::OpPlus || type == TokenType::OpMinus ||
-        type == TokenType::OpStar || type == TokenType::OpSlash ||
-        type == TokenType::OpMod || type == TokenType::OpLess ||
-        type == TokenType::OpGreater || type == TokenType::Not ||
-        type == TokenType::OpIsLessEqual || type == TokenType::OpIsGreaterEqual ||
-        type == TokenType::OpIsEqual || type == TokenType::OpIsNotEqual ||
-        type == TokenType::OpAssign;
-
-}
-
-queue <Token> Parser::exprHelp(queue <Token> outputQueue, stack <Token> operatorStack) {
-    while (operatorStack.size() > 0) {
-        Token BufferToken = operatorStack.top();
-        if (BufferToken.type == TokenType::LParen || BufferToken.type == TokenType::RParen) {
-            error("Mismatched parentheses");
-        }
-        else {
-            outputQueue.push(BufferToken);
-            operatorStack.pop();
-        }
-    }
-    return outputQueue;
+    return Token(TokenType::UNKNOWN, 0, 0);
 }
 
 /*
@@ -111,109 +76,151 @@ b) {
     return pos.x;
 }
 */
-ExpressionNode* Parser::parsePrimary() {
+ExpressionNode* Parser::ExpressionParse() {
+    return parseExpression(0);
+}
+
+/*
+    Pratt parser: a prefix part (unary ops or a primary), then keep folding infix operators into it
+    as long as they bind at least as tight as minPower (table in BindingPower.h)
+    no recursion: everything still waiting for an operand is a frame on an explicit stack, so a 100k term sum,
+    1M nested parentheses or a 1M long a = b = ... chain only cost heap
+    - Prefix / Infix: an operator waiting for its operand, Paren / Index / Call: a primary waiting for what's inside
+    - a frame keeps the minPower of the level that pushed it, finishing the frame goes back to that level
+    - primaries: ( expr ), literals, names, then any number of postfix . [] () (those bind tightest)
+*/
+struct ExprFrame {
+    enum Kind : uint8_t { Prefix, Infix, Paren, Index, Call } kind;
+    TokenType op;
+    uint8_t minPower;       // of the level waiting on this frame
+    uint32_t offset;        // of the operator, errors point at it
+    ExpressionNode* node;   // Infix: the left side, Index: the base, Call: the callee
+    uint32_t mark;          // Call: where its arguments start on scratch
+};
+
+ExpressionNode* Parser::parseExpression(int minPower) {
+    SmallVector<ExprFrame, 32> frames;
+    enum { Operand, Postfix, Operator, Finished } step = Operand;
     ExpressionNode* node = nullptr;
-    // 1. Parse the "Base"
-    if (match(TokenType::LParen)) {
-        node = ExpressionParse();
-        consume(TokenType::RParen);
-    }
-    else if (currentToken.type == TokenType::Integer || currentToken.type == TokenType::Double) {
-        node = makeNode<LiteralNode>(currentToken.type, StringView{ currentToken.value, currentToken.Vsize });
-        advance();
-    }
-    else if (currentToken.type == TokenType::Identifier) {
-        node = makeNode<VariableExprNode>(StringView{ currentToken.value, currentToken.Vsize });
-        advance();
-    }
-    // 2. The "Chaining" Loop (Crucial for pos.x)
+    uint8_t level = (uint8_t)minPower; // minPower of the innermost level still being parsed
+
     while (true) {
-        if (match(TokenType::Dot)) {
-            // After a '.', we MUST find an identifier (the member name)
-            Token member = consume(TokenType::Identifier);
-            node = makeNode<MemberAccessNode>(node, StringView{ member.value, member.Vsize });
-        }
-        else if (match(TokenType::LBrack)) {
-            ExpressionNode* index = ExpressionParse();
-            consume(TokenType::RBrack);
-            node = makeNode<ArrayIndexNode>(node, index);
-        }
-        else if (match(TokenType::LParen)) {
-            std::vector<ExpressionNode*> args;
-            if (currentToken.type != TokenType::RParen) {
-                do { args.push_back(ExpressionParse()); } while (match(TokenType::Comma));
+        switch (step) {
+        case Operand: // prefix operators, then the base of a primary
+            if (uint8_t power = prefixPower(currentToken.type)) { // !x  -x
+                frames.push_back({ ExprFrame::Prefix, currentToken.type, level, currentToken.offset, nullptr, 0 });
+                advance();
+                level = power;
+                break;
             }
-            consume(TokenType::RParen);
-            node = makeNode<FunctionCallNode>(node, args);
-        }
-        else {
-            break; // No more dots or brackets, exit loop
-        }
-    }
-    return node;
-}
-ExpressionNode* Parser::ExpressionParse() {
-    std::stack<ExpressionNode*> nodeStack;
-    std::stack<Token> operatorStack;
-
-    auto processOperator = [&]() {
-        if (operatorStack.empty()) return;
-        Token op = operatorStack.top();
-        operatorStack.pop();
-
-        if (op.type == TokenType::Not) {
-            if (nodeStack.empty()) { error("Expected operand for '!'"); return; }
-            ExpressionNode* child = nodeStack.top(); nodeStack.pop();
-            nodeStack.push(makeNode<UnaryOpNode>(child, op.type));
-        }
-        else {
-            if (nodeStack.size() < 2) { error("Insufficient operands for operator"); return; }
-            ExpressionNode* right = nodeStack.top(); nodeStack.pop();
-            ExpressionNode* left = nodeStack.top(); nodeStack.pop();
+            if (match(TokenType::LParen)) {
+                frames.push_back({ ExprFrame::Paren, TokenType::UNKNOWN, level, 0, nullptr, 0 });
+                level = 0;
+                break;
+            }
+            node = nullptr;
+            if (currentToken.isLiteral()) { // 5, 2.5, 'c' (the lexer already decoded the value)
+                node = makeNode<LiteralNode>(currentToken.type, lexer.constant(currentToken));
+                advance();
+            }
+            else if (currentToken.type == TokenType::Identifier) {
+                node = makeNode<VariableExprNode>(textOf(currentToken));
+                advance();
+            }
+            step = Postfix;
+            break;
 
-            // FIXED: Only one check for OpAssign, and we only pop once for 'left' and 'right'
-            if (op.type == TokenType::OpAssign) {
-                nodeStack.push(static_cast<ExpressionNode*>(makeNode<AssignmentNode>(left, right)));
+        case Postfix: // the "chaining" loop (crucial for pos.x)
+            if (match(TokenType::Dot)) {
+                // After a '.', we MUST find an identifier (the member name)
+                Token member = consume(TokenType::Identifier);
+                node = makeNode<MemberAccessNode>(node, textOf(member));
+            }
+            else if (match(TokenType::LBrack)) {
+                frames.push_back({ ExprFrame::Index, TokenType::UNKNOWN, level, 0, node, 0 });
+                level = 0;
+                step = Operand;
+            }
+            else if (match(TokenType::LParen)) {
+                // arguments pile up on the shared scratch list (nested calls just stack on top), then get copied out
+                uint32_t mark = (uint32_t)scratch.size();
+                if (currentToken.type != TokenType::RParen) {
+                    frames.push_back({ ExprFrame::Call, TokenType::UNKNOWN, level, 0, node, mark });
+                    level = 0;
+                    step = Operand;
+                    break;
+                }
+                consume(TokenType::RParen);
+                node = makeNode<FunctionCallNode>(node, ArenaVector<ExpressionNode*>(*arena, scratch.data() + mark, 0));
             }
             else {
-                nodeStack.push(makeNode<BinaryOpNode>(op.type, left, right));
+                step = node ? Operator : Finished; // no expression here at all, callers deal with that
             }
-        }
-        };
-
-    while (currentToken.type != TokenType::Semicolon &&
-        currentToken.type != TokenType::RParen &&
-        currentToken.type != TokenType::Comma &&
-        currentToken.type != TokenType::Eof) {
-        if (currentToken.type == TokenType::Identifier ||
-            currentToken.type == TokenType::Integer ||
-            currentToken.type == TokenType::Double ||
-            currentToken.type == TokenType::Char ||
-            currentToken.type == TokenType::LParen) {
-
-            // parsePrimary correctly handles pos.x before returning here
-            nodeStack.push(parsePrimary());
-            continue;
-        }
-        else if (isOperator(currentToken.type)) {
-            while (!operatorStack.empty() &&
-                operatorStack.top().type != TokenType::LParen &&
-                getPrec(operatorStack.top().type) >= getPrec(currentToken.type)) {
-                processOperator();
+            break;
+
+        case Operator: {
+            BindingPower power = infixPower(currentToken.type);
+            if (power.left == 0 || power.left < level) {
+                step = Finished;
+                break;
             }
-            operatorStack.push(currentToken);
+            frames.push_back({ ExprFrame::Infix, currentToken.type, level, currentToken.offset, node, 0 });
             advance();
-        }
-        else {
+            level = power.right;
+            step = Operand;
             break;
         }
-    }
 
-    while (!operatorStack.empty()) {
-        processOperator();
+        case Finished: { // node is done, hand it to whoever was waiting for it
+            if (frames.empty()) return node;
+            ExprFrame& frame = frames.back();
+            level = frame.minPower;
+            switch (frame.kind) {
+            case ExprFrame::Prefix:
+                if (!node) error("Expected operand after unary operator");
+                node = makeNode<UnaryOpNode>(node, frame.op);
+                node->offset = frame.offset;
+                step = Operator;
+                break;
+            case ExprFrame::Infix:
+                if (!node) error("Expected expression after operator");
+                if (frame.op == TokenType::OpAssign) {
+                    node = makeNode<AssignmentNode>(frame.node, node);
+                }
+                else {
+                    node = makeNode<BinaryOpNode>(frame.op, frame.node, node);
+                }
+                node->offset = frame.offset; // errors point at the operator
+                step = Operator;
+                break;
+            case ExprFrame::Paren:
+                consume(TokenType::RParen);
+                step = Postfix;
+                break;
+            case ExprFrame::Index:
+                consume(TokenType::RBrack);
+                node = makeNode<ArrayIndexNode>(frame.node, node);
+                step = Postfix;
+                break;
+            case ExprFrame::Call:
+                scratch.push_back(node);
+                if (match(TokenType::Comma)) { // next argument, the frame stays
+                    level = 0;
+                    step = Operand;
+                    continue;
+                }
+                consume(TokenType::RParen);
+                node = makeNode<FunctionCallNode>(frame.node,
+                    ArenaVector<ExpressionNode*>(*arena, scratch.data() + frame.mark, scratch.size() - frame.mark));
+                scratch.resize(frame.mark);
+                step = Postfix;
+                break;
+            }
+            frames.pop_back();
+            break;
+        }
+        }
     }
-
-    return nodeStack.empty() ? nullptr : nodeStack.top();
 }
 
 /*
@@ -225,7 +232,7 @@ StatementNode* Parser::ParseDeclaration() {
     advance();
 
     Token nameToken = consume(TokenType::Identifier);
-    StringView nameView = { nameToken.value, (size_t)nameToken.Vsize };
+    StringView nameView = textOf(nameToken);
 
     // Determine if this is a primitive or a custom struct
     StringView structTypeName = { nullptr, 0 };
@@ -233,7 +240,7 @@ StatementNode* Parser::ParseDeclaration() {
 
     if (typeToken.type == TokenType::Identifier) {
         finalType = TokenType::Struct;
-        structTypeName = { typeToken.value, (size_t)typeToken.Vsize };
+        structTypeName = textOf(typeToken);
     }
 
     int size = -1;
@@ -241,8 +248,12 @@ StatementNode* Parser::ParseDeclaration() {
 
     // Handle Array Brackets: int list[5]
     if (match(TokenType::LBrack)) {
-        if (currentToken.type == TokenType::Integer) {
-            size = std::stoi(std::string(currentToken.value, currentToken.Vsize));
+        if (currentToken.type == TokenType::Integer && currentToken.isLiteral()) {
+            int64_t value = lexer.constant(currentToken).i;
+            if (value > INT_MAX) {
+                error("Array size is too large");
+            }
+            size = (int)value;
             advance();
         }
         else if (currentToken.type == TokenType::RBrack) {
@@ -255,7 +266,7 @@ StatementNode* Parser::ParseDeclaration() {
     }
 
     ExpressionNode* singleInitializer = nullptr;
-    std::vector<ExpressionNode*> arrayInitializers;
+    SmallVector<ExpressionNode*, 8> arrayInitializers;
 
     // Handle Initialization: = ...
     if (match(TokenType::OpAssign)) {
@@ -286,7 +297,7 @@ StatementNode* Parser::ParseDeclaration() {
     consume(TokenType::Semicolon);
 
     if (size != -1 || inferredSize) {
-        return makeNode<ArrayDeclNode>(finalType, nameView, size, arrayInitializers);
+        return makeNode<ArrayDeclNode>(finalType, nameView, structTypeName, size, list(arrayInitializers));
     }
     else {
         // Pass structTypeName so SAnalyzer can look up the blueprint
@@ -294,54 +305,104 @@ StatementNode* Parser::ParseDeclaration() {
     }
 }
 
-StatementNode* Parser::ParseBlock() {
-    consume(TokenType::LBrace);
-    std::vector<StatementNode*> blockStatements;
-
-    while (currentToken.type != TokenType::RBrace && currentToken.type != TokenType::Eof) {
-        StatementNode* stmt = ParseStatement();
-        if (stmt) {
-            blockStatements.push_back(stmt);
-        }
-        else {
-            advance();
-        }
-    }
-
-    if (currentToken.type == TokenType::RBrace) {
-        consume(TokenType::RBrace);
-    }
-    else {
-        error("Expected '}' at end of block");
-    }
+/*
+    blocks, ifs and whiles nest without recursion either: every block that's still open is a frame and the
+    statements parsed so far pile up on one list (like call arguments on scratch), closing a block builds it
+    and whatever it belongs to, and hands that to the block below as its next statement
+    only simple statements go through ParseStatement, so 1M nested blocks cost heap, not stack
+*/
+struct OpenBlock {
+    enum Role : uint8_t { Block, Then, Else, Body } role; // a bare { }, an if's branches, a while's body
+    uint32_t mark;               // where its statements start
+    ExpressionNode* condition;   // of the if / while
+    BlockNode* thenBranch;       // Else only
+};
 
-    return makeNode<BlockNode>(blockStatements);
+StatementNode* Parser::ParseBlock() {
+    return parseNested(TokenType::LBrace);
 }
 
 StatementNode* Parser::ParseIfStatement() {
-    consume(TokenType::If);
-    consume(TokenType::LParen);
-    ExpressionNode* condition = ExpressionParse();
-    consume(TokenType::RParen);
+    return parseNested(TokenType::If);
+}
 
-    BlockNode* thenBranch = static_cast<BlockNode*>(ParseBlock());
+StatementNode* Parser::ParseWhileStatement() {
+    return parseNested(TokenType::While);
+}
 
-    BlockNode* elseBranch = nullptr;
-    if (currentToken.type == TokenType::Else) {
-        advance();
-        elseBranch = static_cast<BlockNode*>(ParseBlock());
-    }
+// at is what the statement has to start with ('{', if or while), the header gets parsed, its block is opened
+StatementNode* Parser::parseNested(TokenType at) {
+    SmallVector<OpenBlock, 16> open;
+    SmallVector<StatementNode*, 32> statements;
+
+    auto openBlock = [&](OpenBlock::Role role, ExpressionNode* condition, BlockNode* thenBranch) {
+        consume(TokenType::LBrace);
+        open.push_back({ role, (uint32_t)statements.size(), condition, thenBranch });
+    };
+    auto openStatement = [&](TokenType type) {
+        if (type == TokenType::If || type == TokenType::While) {
+            consume(type);
+            consume(TokenType::LParen);
+            ExpressionNode* condition = ExpressionParse();
+            consume(TokenType::RParen);
+            openBlock(type == TokenType::If ? OpenBlock::Then : OpenBlock::Body, condition, nullptr);
+        }
+        else {
+            openBlock(OpenBlock::Block, nullptr, nullptr);
+        }
+    };
 
-    return makeNode<IfStatementNode>(condition, thenBranch, elseBranch);
-}
+    openStatement(at);
+    while (true) {
+        TokenType type = currentToken.type;
+        if (type != TokenType::RBrace && type != TokenType::Eof) {
+            if (type == TokenType::LBrace || type == TokenType::If || type == TokenType::While) {
+                openStatement(type);
+                continue;
+            }
+            StatementNode* stmt = ParseStatement();
+            if (stmt) {
+                statements.push_back(stmt);
+            }
+            else {
+                advance();
+            }
+            continue;
+        }
 
-StatementNode* Parser::ParseWhileStatement() {
-    consume(TokenType::While);
-    consume(TokenType::LParen);
-    ExpressionNode* condition = ExpressionParse();
-    consume(TokenType::RParen);
-    BlockNode* body = static_cast<BlockNode*>(ParseBlock());
-    return makeNode<WhileStatementNode>(condition, body);
+        if (currentToken.type == TokenType::RBrace) {
+            consume(TokenType::RBrace);
+        }
+        else {
+            error("Expected '}' at end of block");
+        }
+        OpenBlock closed = open.back();
+        open.pop_back();
+        BlockNode* block = makeNode<BlockNode>(
+            ArenaVector<StatementNode*>(*arena, statements.data() + closed.mark, statements.size() - closed.mark));
+        statements.truncate(closed.mark);
+
+        StatementNode* done;
+        if (closed.role == OpenBlock::Then) {
+            if (currentToken.type == TokenType::Else) {
+                advance();
+                openBlock(OpenBlock::Else, closed.condition, block);
+                continue;
+            }
+            done = makeNode<IfStatementNode>(closed.condition, block, nullptr);
+        }
+        else if (closed.role == OpenBlock::Else) {
+            done = makeNode<IfStatementNode>(closed.condition, closed.thenBranch, block);
+        }
+        else if (closed.role == OpenBlock::Body) {
+            done = makeNode<WhileStatementNode>(closed.condition, block);
+        }
+        else {
+            done = block;
+        }
+        if (open.empty()) return done;
+        statements.push_back(done);
+    }
 }
 
 StatementNode* Parser::ParseReturnStatement() {
@@ -357,10 +418,10 @@ StatementNode* Parser::ParseReturnStatement() {
 StructDeclNode* Parser::ParseStructDeclaration() {
     consume(TokenType::Struct);
     Token nameToken = consume(TokenType::Identifier);
-    StringView nameView = { nameToken.value, (size_t)nameToken.Vsize };
+    StringView nameView = textOf(nameToken);
 
     consume(TokenType::LBrace);
-    std::vector<StructMember> members;
+    SmallVector<StructMember, 8> members;
 
     while (currentToken.type != TokenType::RBrace && currentToken.type != TokenType::Eof) {
         // If the first token is an Identifier, it's a nested struct (e.g., Vec2 pos;)
@@ -372,8 +433,8 @@ StructDeclNode* Parser::ParseStructDeclaration() {
 
             members.push_back({
                 TokenType::Struct,
-                { varToken.value, (size_t)varToken.Vsize },
-                { typeToken.value, (size_t)typeToken.Vsize }
+                textOf(varToken),
+                textOf(typeToken)
                 });
         }
         // Otherwise, it's a primitive (e.g., int x;)
@@ -385,7 +446,7 @@ StructDeclNode* Parser::ParseStructDeclaration() {
 
             members.push_back({
                 pType,
-                { varToken.value, (size_t)varToken.Vsize },
+                textOf(varToken),
                 { nullptr, 0 } // No struct type name for primitives
                 });
         }
@@ -394,7 +455,7 @@ StructDeclNode* Parser::ParseStructDeclaration() {
     match(TokenType::Semicolon);
 
     // This calls the constructor we just added to AST.h
-    return makeNode<StructDeclNode>(nameView, members);
+    return makeNode<StructDeclNode>(nameView, list(members));
 }
 
 StatementNode* Parser::ParseFunctionDeclaration() {
@@ -404,20 +465,60 @@ StatementNode* Parser::ParseFunctionDeclaration() {
     Token nameToken = consume(TokenType::Identifier);
     consume(TokenType::LParen);
 
-    std::vector<std::pair<TokenType, StringView>> params;
+    SmallVector<Parameter, 8> params;
     if (currentToken.type != TokenType::RParen) {
         do {
-            TokenType pType = currentToken.type;
+            Token pType = currentToken;
             advance();
             Token pName = consume(TokenType::Identifier);
-            params.emplace_back(pType, StringView{ pName.value, pName.Vsize });
+            // a type that is an identifier names a struct (Player p), same as in ParseDeclaration
+            if (pType.type == TokenType::Identifier) params.push_back({ TokenType::Struct, textOf(pName), textOf(pType) });
+            else params.push_back({ pType.type, textOf(pName), { nullptr, 0 } });
         } while (match(TokenType::Comma));
     }
     consume(TokenType::RParen);
 
+    if (lazyBodies) {
+        int bodyFirst = pos;
+        skipBlock();
+        FunctionDeclNode* node = makeNode<FunctionDeclNode>(textOf(nameToken), list(params), typeToken.type, nullptr);
+        node->deferredIn = &context;
+        node->bodyFirst = (uint32_t)bodyFirst;
+        node->bodyEnd = (uint32_t)pos;
+        return node;
+    }
+
     BlockNode* body = static_cast<BlockNode*>(ParseBlock());
 
-    return makeNode<FunctionDeclNode>(StringView{ nameToken.value, nameToken.Vsize }, params, typeToken.type, body);
+    return makeNode<FunctionDeclNode>(textOf(nameToken), list(params), typeToken.type, body);
+}
+
+void Parser::skipBlock() {
+    consume(TokenType::LBrace);
+    int depth = 1;
+    int i = pos;
+    for (; i < end; i++) {
+        TokenType type = stream[i].type;
+        if (type == TokenType::LBrace) depth++;
+        else if (type == TokenType::RBrace && --depth == 0) break;
+    }
+    pos = i;
+    currentToken = tokenAt(i);
+    if (i == end) {
+        error("Expected '}' at end of block");
+        return;
+    }
+    advance(); // the closing '}'
+}
+
+/*
+    a deferred body is parsed by a parser that sees only its tokens, [first, end) is '{' .. '}' and end reads as Eof
+    with the real offset there, so the BlockNode comes out exactly like the one an eager parse makes
+*/
+BlockNode* Parser::parseDeferredBody(ASTContext& context, uint32_t first, uint32_t end) {
+    ASTContext::DeferredSource& source = context.deferred;
+    Parser parser(*source.lexer, context, context.getArena(), source.tokens.data(), (int)first, (int)end, source.BaJavMode);
+    return static_cast<BlockNode*>(parser.ParseBlock());
 }
 
 StatementNode* Parser::ParseStatement() {
@@ -428,7 +529,8 @@ StatementNode* Parser::ParseStatement() {
 
     // NEW LOGIC:
     // A declaration is: (A primitive type) OR (An identifier followed by another identifier)
-    bool isPrimitive = (currentToken.type == TokenType::Integer ||
+    bool isPrimitive = !currentToken.isLiteral() && // "5;" is an expression, "int x;" isn't
+        (currentToken.type == TokenType::Integer ||
         currentToken.type == TokenType::Double ||
         currentToken.type == TokenType::Char ||
         currentToken.type == TokenType::Bool);
@@ -446,32 +548,120 @@ StatementNode* Parser::ParseStatement() {
     return makeNode<ExpressionStatementNode>(expr);
 }
 
+StatementNode* Parser::ParseTopLevel() {
+    if (currentToken.type == TokenType::Struct) {
+        TRACE_LOG(Parser, 2, "struct at line " << lexer.location(currentToken.offset).line);
+        return ParseStructDeclaration();
+    }
+    else if ((isType(currentToken.type) && Peek(2).type == TokenType::LParen) ||
+        (currentToken.type == TokenType::Identifier && Peek(1).type == TokenType::LParen)) {
+
+        TRACE_LOG(Parser, 2, "function at line " << lexer.location(currentToken.offset).line);
+        return ParseFunctionDeclaration();
+    }
+    else if (isType(currentToken.type)) {
+        return ParseDeclaration();
+    }
+    ExpressionNode* expr = ExpressionParse();
+    if (expr) {
+        consume(TokenType::Semicolon);
+        return makeNode<ExpressionStatementNode>(expr);
+    }
+    advance();
+    return nullptr;
+}
+
 ASTNode* Parser::ParseProgram() {
     auto* program = makeNode<ProgramNode>();
 
-    while (currentToken.type != TokenType::Eof) {
-
-        if (currentToken.type == TokenType::Struct) {
-            program->declarations.push_back(ParseStructDeclaration());
+    if (!pool || pool->size() < 2 || !parseParallel(program)) {
+        while (currentToken.type != TokenType::Eof) {
+            StatementNode* decl = ParseTopLevel();
+            if (decl) program->declarations.push_back(*arena, decl);
         }
-        else if ((isType(currentToken.type) && Peek(2).type == TokenType::LParen) ||
-            (currentToken.type == TokenType::Identifier && Peek(1).type == TokenType::LParen)) {
+    }
+    if (lazyBodies) context.deferred = { &lexer, std::move(tokens), BaJavMode }; // stream still points at them
+    context.root = program;
+    TRACE_LOG(Parser, 1, "ast arena " << context.bytesUsed() << " bytes in " << context.blocks() << " blocks");
+    return program;
+}
 
-            program->declarations.push_back(ParseFunctionDeclaration());
-        }
-        else if (isType(currentToken.type)) {
-            program->declarations.push_back(ParseDeclaration());
+/*
+    Parallel parsing
+    top level declarations only share the token stream, so a big program is cut into runs of whole declarations
+    and each run is parsed by a worker Parser with its own arena, then the runs are stitched back in source order
+    - a pre-scan over the tokens counts braces and notes every place a new top level declaration may start:
+      depth 0, right after a '}' or ';', and not on a ';' (a struct's optional trailing ';' stays with the struct)
+    - a worker reads its last token as Eof, the serial parser only ever looks past the end of a declaration
+      when that declaration is broken, so a run that parses without errors is exactly what the serial parse makes
+      (offsets included, the Eof a worker sees has the offset of the real token there)
+    - any error in any run throws all of it away and the program is parsed serially, which reports it as always
+*/
+static const int minChunkTokens = 64 * 1024;
+
+Parser::Parser(Lexer& l, ASTContext& ctx, Arena& a, const Token* tokens, int first, int last, bool bajav)
+    : lexer(l), context(ctx), arena(&a), stream(tokens), end(last), BaJavMode(bajav), pos(first) {
+    currentToken = tokenAt(first);
+}
+
+Parser::Parser(const Parser& parent, Arena& workerArena, int first, int last)
+    : Parser(parent.lexer, parent.context, workerArena, parent.stream, first, last, parent.BaJavMode) {
+    deferErrors = true;
+    lazyBodies = parent.lazyBodies;
+}
+
+bool Parser::parseParallel(ProgramNode* program) {
+    if (pos != 0 || end < 2 * minChunkTokens) return false;
+
+    std::vector<int> starts; // every token a top level declaration could start at
+    int depth = 0;
+    for (int i = 0; i < end; i++) {
+        TokenType type = stream[i].type;
+        if (depth == 0 && i > 0 && type != TokenType::Semicolon &&
+            (stream[i - 1].type == TokenType::RBrace || stream[i - 1].type == TokenType::Semicolon)) {
+            starts.push_back(i);
         }
-        else {
-            ExpressionNode* expr = ExpressionParse();
-            if (expr) {
-                consume(TokenType::Semicolon);
-                program->declarations.push_back(makeNode<ExpressionStatementNode>(expr));
-            }
-            else {
-                advance();
-            }
+        if (type == TokenType::LBrace) depth++;
+        else if (type == TokenType::RBrace && --depth < 0) return false; // stray '}', not worth being clever about
+    }
+
+    // a few runs per thread so one huge function doesn't leave the others idle
+    size_t count = std::min<size_t>((size_t)pool->size() * 4, (size_t)end / minChunkTokens);
+    std::vector<int> bounds = { 0 };
+    for (size_t k = 1; k < count; k++) {
+        auto next = std::lower_bound(starts.begin(), starts.end(), (int)((int64_t)end * k / count));
+        if (next == starts.end()) break;
+        if (*next > bounds.back()) bounds.push_back(*next);
+    }
+    bounds.push_back(end);
+    count = bounds.size() - 1;
+    if (count < 2) return false;
+
+    struct Run {
+        Arena* arena;
+        std::vector<ASTNode*> declarations;
+        bool failed = false;
+    };
+    std::vector<Run> runs(count);
+    for (Run& run : runs) run.arena = &context.newArena();
+
+    pool->run(count, [&](size_t k) {
+        Parser worker(*this, *runs[k].arena, bounds[k], bounds[k + 1]);
+        while (worker.currentToken.type != TokenType::Eof) {
+            StatementNode* decl = worker.ParseTopLevel();
+            if (decl) runs[k].declarations.push_back(decl);
         }
+        runs[k].failed = worker.failed;
+    });
+
+    std::vector<ASTNode*> declarations;
+    for (const Run& run : runs) {
+        if (run.failed) return false;
+        declarations.insert(declarations.end(), run.declarations.begin(), run.declarations.end());
     }
-    return program;
+    program->declarations = list(declarations);
+    TRACE_LOG(Parser, 1, "parsed " << declarations.size() << " declarations in " << count << " runs");
+    pos = end;
+    currentToken = tokenAt(end);
+    return true;
 }
\ No newline at end of file
@@ -2,62 +2,89 @@
 #include "../Lexer/Lexer.h"
 #include "../Lexer/Token.h"
 #include "AST.h"
+#include "ASTContext.h"
+#include "BindingPower.h"
+#include "../Support/SmallVector.h"
+#include "../Support/Trace.h"
 #include <vector>
 #include <iostream>
-#include <queue>
-#include <stack>
 
 // In Parser.h (private)
 
 
+class ThreadPool;
+
 class Parser {
 	private:
 		/*
 		Variables
 		*/
 	Lexer& lexer;
+	ASTContext& context; // the nodes go here, it outlives the parser
+	Arena* arena;        // which of the context's arenas this parser allocates from
 	Token currentToken;
-	std::vector<Token> tokens;
+	std::vector<Token> tokens; // ends with the Eof token (empty in a worker, it reads its parent's)
+	const Token* stream;       // the tokens being parsed
+	int end;                   // index of the last token this parser may see, it always reads as Eof
 	bool BaJavMode;
 	int pos = 0;
+	ThreadPool* pool = nullptr; // set -> big programs get their top level declarations parsed on it
+	// worker parsers only: an error marks the worker failed and jumps to its end, the whole program
+	// is then parsed again serially to report it
+	bool deferErrors = false;
+	bool failed = false;
+	bool lazyBodies = false; // skip function bodies, see deferBodies
 	template <typename T, typename... Args>
 	T* makeNode(Args&&... args) {
-		T* node = new T(std::forward<Args>(args)...);
-		clothesline.push_back(node);
-		// Grab line/col from the token currently being processed
-		node->lin = currentToken.line;
-		node->col = currentToken.column;
+		T* node = arena->make<T>(std::forward<Args>(args)...);
+		// Grab the source position from the token currently being processed
+		node->offset = currentToken.offset;
 		return node;
 	}
+	template <typename T>
+	ArenaVector<T> list(const std::vector<T>& items) { return ArenaVector<T>(*arena, items); }
+	template <typename T, size_t N>
+	ArenaVector<T> list(const SmallVector<T, N>& items) { return ArenaVector<T>(*arena, items.data(), items.size()); }
+	Token tokenAt(int i) const { return i < end ? stream[i] : Token(TokenType::Eof, stream[end].offset, 0); }
 	/*
 	Expression Parsing
 	*/
-	std::vector<ASTNode*> clothesline; // to hold allocated nodes for cleanup
-	ExpressionNode* ExpressionParse(); // shunting yard algorithm to parse expressions
+	std::vector<ExpressionNode*> scratch; // call arguments while they're parsed, reused so expressions don't allocate
+	ExpressionNode* ExpressionParse(); // a whole expression (assignment included)
+	ExpressionNode* parseExpression(int minPower); // Pratt parser with an explicit stack, see BindingPower.h
 	StatementNode* AssignmentParse(); // parse assignments also calls on ExpressionParse
 	StatementNode* ParseDeclaration(); // parse variable declarations 
 	Token consume(TokenType Tok); // consume expected token or error
-	ExpressionNode* parsePrimary(); // parse primary expressions (identifiers, literals)
 
 	/*
 	Statements
 	*/
 	StatementNode* ParseBlock();
+	StatementNode* parseNested(TokenType at); // a block, if or while and everything nested in it, without recursion
 	StatementNode* ParseIfStatement();
 	StatementNode* ParseWhileStatement();
 	StatementNode* ParseFunctionDeclaration();
 	StatementNode* ParseReturnStatement();
 	StructDeclNode* ParseStructDeclaration();
 	StatementNode* ParseStatement(); // general statement parser
+	StatementNode* ParseTopLevel(); // one top level declaration, nullptr if a stray token got skipped
+	void skipBlock(); // jump over a { ... } by counting braces, nothing gets parsed
+	/*
+	Parallel parsing
+	*/
+	Parser(Lexer& l, ASTContext& ctx, Arena& a, const Token* tokens, int first, int last, bool bajav); // parses [first, last) of tokens
+	Parser(const Parser& parent, Arena& workerArena, int first, int last); // a worker parsing [first, last) of parent's tokens
+	bool parseParallel(ProgramNode* program);
 	/*
 	Helper functions and destructors and error handling function
 	*/
 	bool isType(TokenType type);
-	int getPrec(TokenType type); // get operator precedence
-	queue <Token> exprHelp(queue <Token> tokenQueue, stack <Token> operatorStack); // helps make shunting yard more readable
-	bool isOperator(TokenType type); // check if token is operator
 	void advance();
 	Token Peek(int n);
+	// token text as a view into the source, identifiers also carry their symbol id
+	StringView textOf(const Token& tok) const {
+		return { lexer.text(tok), tok.length, tok.type == TokenType::Identifier ? tok.payload : NoSymbol };
+	}
 	bool Check(TokenType Tok) { return currentToken.type == Tok; }// check current token type
 	bool match(TokenType type); // match and advance if token matches
 	void error(const char* message); // error handling
@@ -65,27 +92,22 @@ class Parser {
 	Parser Constructor
 	*/
 public:
-	Parser(Lexer& l) : lexer(l), pos(0) { 
-		Token t = lexer.getToken(); 
+	Parser(Lexer& l, ASTContext& ctx) : lexer(l), context(ctx), arena(&ctx.getArena()), pos(0) { 
+		lexer.tokenize(tokens); // ends with the Eof token
 		this->BaJavMode = lexer.firstToken;
+		TRACE_LOG(Parser, 1, "lexed " << tokens.size() << " tokens");
 
-		while (t.type != TokenType::Eof) {
-			tokens.push_back(t);
-			t = lexer.getToken();
-		}
-		tokens.push_back(t);
-
+		stream = tokens.data();
+		end = (int)tokens.size() - 1;
 		if (!tokens.empty()) {
 			currentToken = tokens[0];
 		}
 	}
-	ASTNode* ParseProgram();
-	// destructor to clean up clothesline	
-	~Parser() {
-		// destructor to clean up clothesline
-		for (ASTNode* node : clothesline) {
-			delete node;
-		}
-		clothesline.clear();
-	}
+	// let ParseProgram split big programs at top level declarations and parse them on this pool (nullptr = always serial)
+	void useThreadPool(ThreadPool* threads) { pool = threads; }
+	// leave function bodies unparsed: the parser only records their token range and skips them by brace counting,
+	// FunctionDeclNode::getBody() parses one the first time a pass asks for it (syntax errors in a body show up then)
+	void deferBodies(bool on) { lazyBodies = on; }
+	ASTNode* ParseProgram(); // the tree belongs to the ASTContext, not to us
+	static BlockNode* parseDeferredBody(ASTContext& context, uint32_t first, uint32_t end);
 };
@@ -0,0 +1,89 @@
+#include "Types.h"
+
+TypeTable::TypeTable() {
+	for (TypeId& id : primitives) id = NoType;
+	for (TokenType token : { TokenType::UNKNOWN, TokenType::Integer, TokenType::Double, TokenType::Char, TokenType::Bool }) {
+		primitive(token);
+	}
+}
+
+TypeId TypeTable::add(const Entry& entry) {
+	entries.push_back(entry);
+	return (TypeId)entries.size() - 1;
+}
+
+TypeId TypeTable::primitive(TokenType token) {
+	TypeId& id = primitives[(uint8_t)token];
+	if (id == NoType) id = add({ TypeKind::Primitive, token, 0, 0, 0 });
+	return id;
+}
+
+TypeId TypeTable::structType(uint32_t name) {
+	auto found = structs.find(name);
+	if (found != structs.end()) return found->second;
+	TypeId id = add({ TypeKind::Struct, TokenType::Struct, name, 0, 0 });
+	structs.emplace(name, id);
+	return id;
+}
+
+TypeId TypeTable::arrayOf(TypeId element, int length) {
+	uint64_t key = (uint64_t)element << 32 | (uint32_t)length;
+	auto found = arrays.find(key);
+	if (found != arrays.end()) return found->second;
+	TypeId id = add({ TypeKind::Array, TokenType::List, element, (uint32_t)length, 0 });
+	arrays.emplace(key, id);
+	return id;
+}
+
+TypeId TypeTable::function(TypeId returns, const TypeId* parameters, uint32_t count) {
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ returns;
+	for (uint32_t i = 0; i < count; i++) hash = (hash ^ parameters[i]) * 0xFF51AFD7ED558CCDull;
+	hash ^= count;
+	auto range = functions.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		const Entry& entry = entries[it->second];
+		if (entry.a != returns || entry.c != count) continue;
+		bool same = true;
+		for (uint32_t i = 0; i < count && same; i++) same = params[entry.b + i] == parameters[i];
+		if (same) return it->second;
+	}
+	TypeId id = add({ TypeKind::Function, TokenType::Function, returns, (uint32_t)params.size(), count });
+	params.insert(params.end(), parameters, parameters + count);
+	functions.emplace(hash, id);
+	return id;
+}
+
+bool TypeTable::restore(TypeId id, const Entry& entry, const TypeId* parameters) {
+	if (id > entries.size()) return false;
+	switch (entry.kind) {
+	case TypeKind::Primitive: return primitive(entry.token) == id;
+	case TypeKind::Struct:    return structType(entry.a) == id;
+	case TypeKind::Array:     return entry.a < id && arrayOf(entry.a, (int)entry.b) == id;
+	case TypeKind::Function:
+		if (entry.a >= id) return false;
+		for (uint32_t i = 0; i < entry.c; i++) {
+			if (parameters[i] >= id) return false;
+		}
+		return function(entry.a, parameters, entry.c) == id;
+	default: return false;
+	}
+}
+
+void TypeTable::merge(const TypeTable& other, TypeId first, std::vector<TypeId>& map) {
+	map.clear();
+	auto here = [&](TypeId type) { return type < first ? type : map[type - first]; };
+	std::vector<TypeId> parameters;
+	for (TypeId id = first; id < other.size(); id++) {
+		const Entry& entry = other.entries[id];
+		switch (entry.kind) {
+		case TypeKind::Primitive: map.push_back(primitive(entry.token)); break;
+		case TypeKind::Struct:    map.push_back(structType(entry.a)); break;
+		case TypeKind::Array:     map.push_back(arrayOf(here(entry.a), (int)entry.b)); break;
+		case TypeKind::Function:
+			parameters.clear();
+			for (uint32_t i = 0; i < entry.c; i++) parameters.push_back(here(other.params[entry.b + i]));
+			map.push_back(function(here(entry.a), parameters.data(), entry.c));
+			break;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+/*
+	Type table
+	every type sema meets is interned once and from then on it's a TypeId, a plain index: two types are the same
+	exactly when their ids match, so checking a struct or array type costs an integer compare and not a name compare
+	- primitives get one id per TokenType (the common ones at fixed ids), a struct type is keyed by the symbol id
+	  of its name, an array by its element type and length (so arrays of structs and arrays of arrays work), a
+	  function by its return type and parameter types
+	- the AST's resolved types and the symbol table carry TypeIds, what they mean comes from the table that made them
+	  (SAnalyzer::getTypes())
+	usage: TypeTable types; TypeId grid = types.arrayOf(types.arrayOf(TypeTable::Integer, 4), 4);
+	       types.element(grid) == types.arrayOf(TypeTable::Integer, 4)
+*/
+#include "../Lexer/Token.h"
+#include "../Lexer/Interner.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using TypeId = uint32_t;
+
+enum class TypeKind : uint8_t { Primitive, Struct, Array, Function };
+
+class TypeTable {
+public:
+	struct Entry {
+		TypeKind kind;
+		TokenType token; // the primitive, Struct, List or Function for the rest
+		uint32_t a;      // struct: name id, array: element type, function: return type
+		uint32_t b;      // array: length, function: first parameter in params
+		uint32_t c;      // function: parameter count
+	};
+private:
+	std::vector<Entry> entries; // indexed by TypeId
+	std::vector<TypeId> params; // function parameter lists back to back
+	TypeId primitives[256];     // by TokenType, NoType until first asked for
+	std::unordered_map<uint32_t, TypeId> structs;       // name id -> type
+	std::unordered_map<uint64_t, TypeId> arrays;        // element << 32 | length -> type
+	std::unordered_multimap<uint64_t, TypeId> functions; // signature hash -> types with that hash
+
+	TypeId add(const Entry& entry);
+public:
+	static const TypeId NoType = UINT32_MAX;
+	// interned up front in this order, so they're the same ids in every table
+	static const TypeId Unknown = 0, Integer = 1, Double = 2, Char = 3, Bool = 4;
+
+	TypeTable();
+
+	TypeId primitive(TokenType token);
+	TypeId structType(uint32_t name);
+	TypeId arrayOf(TypeId element, int length);
+	TypeId function(TypeId returns, const TypeId* parameters, uint32_t count);
+	// what a declaration names: the struct called structName for TokenType::Struct, the primitive otherwise
+	TypeId of(TokenType token, uint32_t structName = NoSymbol) {
+		return token == TokenType::Struct ? structType(structName) : primitive(token);
+	}
+
+	TypeKind kind(TypeId type) const { return entries[type].kind; }
+	TokenType token(TypeId type) const { return entries[type].token; }
+	bool isArray(TypeId type) const { return entries[type].kind == TypeKind::Array; }
+	bool isStruct(TypeId type) const { return entries[type].kind == TypeKind::Struct; }
+	bool isNumber(TypeId type) const { return type == Integer || type == Double; }
+	// the parts of a type, the answer for a type of another kind is in brackets
+	uint32_t structName(TypeId type) const { return isStruct(type) ? entries[type].a : NoSymbol; } // (NoSymbol)
+	TypeId element(TypeId type) const { return isArray(type) ? entries[type].a : Unknown; }        // (Unknown)
+	int length(TypeId type) const { return isArray(type) ? (int)entries[type].b : 0; }            // (0)
+	TypeId returns(TypeId type) const {                                                             // (Unknown)
+		return entries[type].kind == TypeKind::Function ? entries[type].a : Unknown;
+	}
+	uint32_t paramCount(TypeId type) const { return entries[type].kind == TypeKind::Function ? entries[type].c : 0; }
+	TypeId param(TypeId type, uint32_t i) const { return params[entries[type].b + i]; }
+
+	size_t size() const { return entries.size(); }
+	// the table as it's stored, entries by TypeId and the parameter lists they point into ( Parser/ASTCache.cpp )
+	const std::vector<Entry>& allEntries() const { return entries; }
+	const std::vector<TypeId>& allParams() const { return params; }
+	// interns a stored entry (parameters = its parameter list) and checks it comes out as id. reading a stored table
+	// back in id order that holds for every entry, false means the entry refers to a type after it or the table
+	// it came from wasn't one this code makes
+	bool restore(TypeId id, const Entry& entry, const TypeId* parameters);
+
+	// other started out as a copy of this table when it had first types and then interned on its own (a worker's
+	// in the parallel sema pass): brings over what it added, in its order. map[id - first] is where other's id
+	// ended up in here
+	void merge(const TypeTable& other, TypeId first, std::vector<TypeId>& map);
+};
@@ -0,0 +1,252 @@
+/*
+    the same checks as the visit functions in SAnalyzer.cpp, but walking a FlatAST
+    results go into the flat AST's side tables (resolved types, struct sizes, the struct table) instead of into nodes
+    keep the two in step, a program has to get the same errors whichever form it is checked in
+*/
+#include "SAnalyzer.h"
+#include "../Parser/FlatAST.h"
+#include "../Support/Trace.h"
+#include <string>
+#include <string_view>
+
+template class FlatWalker<SAnalyzer>; // like StackWalker<SAnalyzer> in SAnalyzer.cpp, next to the resume it inlines
+
+void SAnalyzer::analyze(FlatAST& ast) {
+    flat = &ast;
+    ast.layoutMode = structLayouts.mode();
+    for (uint32_t i = 0; i < ast.declarations.count; i++) {
+        walk(ast.ref(ast.declarations, i));
+    }
+    flat = nullptr;
+}
+
+// every node kind in one resume, the case does what the node's resume in SAnalyzer.cpp does (see FlatWalker.h)
+NodeRef SAnalyzer::resume(FlatFrame& frame) {
+    FlatAST& ast = *flat;
+    uint32_t i = frame.node.index();
+    switch (frame.node.kind()) {
+    case NodeKind::Block: {
+        const FlatBlock& block = ast.blocks[i];
+        if (frame.step == 0) {
+            frame.saved[0] = this->nextOffset;
+            scopeStack.push();
+        }
+        while (frame.step < block.statements.count) {
+            NodeRef statement = ast.ref(block.statements, frame.step++);
+            if (pending(statement)) return statement;
+        }
+        scopeStack.exit();
+        this->nextOffset = frame.saved[0];
+        break;
+    }
+    case NodeKind::If: {
+        const FlatIf& stmt = ast.ifs[i];
+        return next(frame, { stmt.condition, stmt.thenBranch, stmt.elseBranch });
+    }
+    case NodeKind::While: {
+        const FlatWhile& stmt = ast.whiles[i];
+        return next(frame, { stmt.condition, stmt.body });
+    }
+    case NodeKind::Return:
+        return next(frame, { ast.returns[i].value });
+    case NodeKind::ExprStmt:
+        return next(frame, { ast.exprStmts[i].expression });
+    case NodeKind::Function: {
+        const FlatFunction& fn = ast.functions[i];
+        if (frame.step == 0) {
+            frame.step = 1;
+            paramTypes.clear();
+            for (uint32_t k = 0; k < fn.paramCount; k++) paramTypes.push_back(types.of(ast.params[fn.firstParam + k].type, ast.params[fn.firstParam + k].structType));
+            TypeId signature = types.function(types.primitive(fn.returnType), paramTypes.data(), (uint32_t)paramTypes.size());
+            Symbol sym = { ast.name(fn.name), signature, 0, 0 };
+            scopeStack.declare(sym);
+
+            scopeStack.push();
+            frame.saved[0] = this->nextOffset;
+            this->nextOffset = 0; // Parameters start at offset 0 in the new frame
+            for (uint32_t k = 0; k < fn.paramCount; k++) {
+                const FlatParam& param = ast.params[fn.firstParam + k];
+                Symbol paramSym = { ast.name(param.name), types.of(param.type, param.structType), nextOffset, 0 };
+                scopeStack.declare(paramSym);
+                const StructLayout* layout = layoutOf(paramSym.type);
+                nextOffset += layout ? (layout->totalSize + 7) / 8 * 8 : 8;
+            }
+            if (pending(fn.body)) return fn.body;
+        }
+        TRACE_LOG(Sema, 1, "function '" << std::string_view(ast.names->text(fn.name), ast.names->length(fn.name)) << "' params " << fn.paramCount);
+        scopeStack.exit();
+        this->nextOffset = frame.saved[0];
+        break;
+    }
+    case NodeKind::VarDecl: {
+        const FlatVarDecl& var = ast.varDecls[i];
+        NodeRef init = next(frame, { var.initializer });
+        if (init.valid()) return init;
+
+        int size = 1;
+        if (var.type == TokenType::Struct) {
+            Symbol* def = scopeStack.lookup(ast.name(var.structType));
+            if (def) size = (def->Structsize + 7) / 8;
+        }
+        Symbol sym = { ast.name(var.name), types.of(var.type, var.structType), nextOffset, size * 8 };
+        nextOffset += size;
+        scopeStack.declare(sym);
+        break;
+    }
+    case NodeKind::StructDecl: {
+        const FlatStructDecl& decl = ast.structDecls[i];
+        StructLayout layout(ast.name(decl.name), types.structType(decl.name));
+        for (uint32_t k = 0; k < decl.memberCount; k++) {
+            const FlatMember& member = ast.members[decl.firstMember + k];
+            structLayouts.addMember(layout, ast.name(member.name), member.type, ast.name(member.structType),
+                types.of(member.type, member.structType));
+        }
+        int structTotalSize = structLayouts.add(std::move(layout)).totalSize;
+        ast.structOf[decl.name] = i;
+        ast.structSize[i] = structTotalSize;
+        Symbol sym = { ast.name(decl.name), TypeTable::Unknown, 0, structTotalSize };
+        scopeStack.declare(sym);
+        break;
+    }
+    case NodeKind::ArrayDecl: {
+        const FlatArrayDecl& arr = ast.arrayDecls[i];
+        while (frame.step < arr.initializers.count) {
+            NodeRef init = ast.ref(arr.initializers, frame.step++);
+            if (pending(init)) return init;
+        }
+        int totalElements = arr.initializers.count > 0 ? (int)arr.initializers.count : arr.size;
+        TypeId element = types.of(arr.type, arr.structType);
+        Symbol sym = { ast.name(arr.name), types.arrayOf(element, totalElements), nextOffset, totalElements * 8 };
+        nextOffset += totalElements;
+        scopeStack.declare(sym);
+        break;
+    }
+    case NodeKind::Literal:
+        ast.type(frame.node) = types.primitive(ast.literals[i].value.type);
+        break;
+    case NodeKind::Variable: {
+        Symbol* sym = scopeStack.lookup(ast.name(ast.variables[i].name));
+        if (sym) {
+            ast.type(frame.node) = sym->type;
+        }
+        else {
+            ast.type(frame.node) = TypeTable::Unknown;
+            if (!BaJavMode) Error(ast.variables[i].offset, "Undefined variable.");
+        }
+        break;
+    }
+    case NodeKind::Assign: {
+        const FlatAssign& assign = ast.assigns[i];
+        NodeRef child = next(frame, { assign.target, assign.value });
+        if (child.valid()) return child;
+        TypeId target = ast.type(assign.target);
+        TypeId value = ast.type(assign.value);
+
+        StringView targetName = ast.nameOf(assign.target);
+        if (targetName.data != nullptr) {
+            Symbol* sym = scopeStack.lookup(targetName);
+            if (sym && BaJavMode) sym->type = value;
+        }
+        if (!BaJavMode && !isCompatible(target, value)) {
+            Error(assign.offset, "Type mismatch in assignment.");
+        }
+        ast.type(frame.node) = target;
+        break;
+    }
+    case NodeKind::Binary: {
+        const FlatBinary& bin = ast.binaries[i];
+        NodeRef child = next(frame, { bin.left, bin.right });
+        if (child.valid()) return child;
+        TypeId left = ast.type(bin.left);
+        TypeId right = ast.type(bin.right);
+        ast.type(frame.node) = (left == TypeTable::Double || right == TypeTable::Double) ? TypeTable::Double : TypeTable::Integer;
+        if (!BaJavMode && !isCompatible(left, right)) {
+            Error(bin.offset, "Incompatible types in binary op.");
+        }
+        break;
+    }
+    case NodeKind::Unary: {
+        const FlatUnary& un = ast.unaries[i];
+        NodeRef operand = next(frame, { un.operand });
+        if (operand.valid()) return operand;
+        if (un.operand.valid()) ast.type(frame.node) = ast.type(un.operand);
+        break;
+    }
+    case NodeKind::ArrayIndex: {
+        const FlatArrayIndex& idx = ast.arrayIndexes[i];
+        NodeRef child = next(frame, { idx.base, idx.index });
+        if (child.valid()) return child;
+        TypeId base = ast.type(idx.base);
+        TypeId& result = ast.type(frame.node);
+        if (types.isArray(base)) {
+            result = types.element(base);
+            if (const StructLayout* layout = structLayouts.ofType(result)) ast.indexStride[i] = layout->totalSize;
+            else ast.indexStride[i] = structLayouts.valueSize(result);
+        }
+        else {
+            result = TypeTable::Unknown;
+            if (!BaJavMode) Error(idx.offset, "Base is not an array.");
+        }
+        if (!BaJavMode && ast.type(idx.index) != TypeTable::Integer) {
+            Error(idx.offset, "Array index must be an integer.");
+        }
+        break;
+    }
+    case NodeKind::MemberAccess: {
+        const FlatMemberAccess& access = ast.memberAccesses[i];
+        NodeRef base = next(frame, { access.base });
+        if (base.valid()) return base;
+        TypeId& result = ast.type(frame.node);
+        if (const StructLayout* layout = structLayouts.ofType(ast.type(access.base))) {
+            StringView memberName = ast.name(access.member);
+            if (const MemberLayout* member = layout->member(memberName)) {
+                result = member->typeId;
+                ast.accessOffset[i] = member->offset;
+                if (member->type != TokenType::Struct) ast.accessSize[i] = member->size;
+            }
+            else {
+                ast.accessOffset[i] = layout->totalSize; // BaJav lets it through, IRgen lands just past the struct
+                if (!BaJavMode) {
+                    StringView s = layout->name;
+                    Error(access.offset, "Member '" + std::string(memberName.data, memberName.size) + "' not found in struct '" + std::string(s.data, s.size) + "'");
+                }
+            }
+        }
+        else {
+            if (!BaJavMode) Error(access.offset, "Base is not a struct.");
+            result = TypeTable::Unknown;
+        }
+        break;
+    }
+    case NodeKind::Call: {
+        const FlatCall& call = ast.calls[i];
+        // step 0 is the callee, then the arguments
+        if (frame.step == 0) {
+            frame.step = 1;
+            if (pending(call.callee)) return call.callee;
+        }
+        while (frame.step - 1 < call.arguments.count) {
+            NodeRef arg = ast.ref(call.arguments, frame.step++ - 1);
+            if (pending(arg)) return arg;
+        }
+        StringView funcName = ast.nameOf(call.callee);
+        Symbol* sym = scopeStack.lookup(funcName);
+        TypeId& result = ast.type(frame.node);
+        if (sym && types.kind(sym->type) == TypeKind::Function) {
+            result = types.returns(sym->type);
+        }
+        else if (sym) {
+            result = TypeTable::Unknown;
+            if (!BaJavMode) Error(call.offset, "Not a function: " + std::string(funcName.data, funcName.size));
+        }
+        else {
+            result = TypeTable::Integer;
+            if (!BaJavMode) Error(call.offset, "Undefined function: " + std::string(funcName.data ? funcName.data : "", funcName.size));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return NodeRef();
+}
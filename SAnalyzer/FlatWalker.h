@@ -0,0 +1,81 @@
+#pragma once
+/*
+	FlatWalker
+	StackWalker ( StackWalker.h ) for a FlatAST: the same walk with NodeRefs for nodes, so a flat pass is only as
+	deep as the heap lets it be too (a 1M term sum, 1M nested blocks)
+	- a pass writes one resume(FlatFrame&) that switches on frame.node.kind(), does the work up to the next child and
+	  passes it to pending(), returning it if that says so. an invalid NodeRef back = done with the node
+	- pending(), next() and the nativeDepth fast path work exactly like StackWalker's
+	- a class that walks both forms (SAnalyzer, IRgen) brings the two pending/next/walk in with using declarations,
+	  the frame type or the node type picks which one a call means
+	usage: class Foo final : public FlatWalker<Foo> { friend class FlatWalker<Foo>; NodeRef resume(FlatFrame&); ... };
+	       foo.walk(ref);
+	       instantiated next to the resume function like StackWalker
+*/
+#include "../Parser/FlatAST.h"
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+struct FlatFrame {
+	NodeRef node;
+	uint32_t step;
+	int saved[3];
+};
+
+template <typename Derived>
+class FlatWalker {
+	std::vector<FlatFrame> frames; // the part of a walk that's deeper than nativeDepth
+	unsigned depth = 0;            // children being visited with plain calls right now
+
+	NodeRef resume(FlatFrame& frame) { return static_cast<Derived*>(this)->resume(frame); }
+	// the explicit stack, same as StackWalker::deepWalk
+	void deepWalk(NodeRef root) {
+		size_t base = frames.size();
+		if (frames.size() < base + 64) frames.resize(base + 64);
+		FlatFrame* bottom = frames.data() + base;
+		FlatFrame* top = bottom;
+		*top = { root, 0, {} };
+		while (top >= bottom) {
+			NodeRef child = resume(*top);
+			if (!child.valid()) {
+				top--;
+				continue;
+			}
+			if (top + 1 == frames.data() + frames.size()) {
+				size_t at = top - frames.data();
+				frames.resize(frames.size() * 2);
+				bottom = frames.data() + base;
+				top = frames.data() + at;
+			}
+			*++top = { child, 0, {} };
+		}
+		frames.resize(base);
+	}
+protected:
+	static const unsigned nativeDepth = 512;
+
+	// a child the node wants visited now, false = it was (with a plain call), true = hand it to the walker:
+	//     if (pending(child)) return child;
+	bool pending(NodeRef child) {
+		if (!child.valid()) return false;
+		if (depth == nativeDepth) return true;
+		depth++;
+		FlatFrame frame = { child, 0, {} };
+		for (NodeRef grandchild = resume(frame); grandchild.valid(); grandchild = resume(frame)) deepWalk(grandchild);
+		depth--;
+		return false;
+	}
+	// the next of a node's fixed children that has to go to the walker, missing ones are skipped
+	NodeRef next(FlatFrame& frame, std::initializer_list<NodeRef> children) {
+		while (frame.step < children.size()) {
+			NodeRef child = children.begin()[frame.step++];
+			if (pending(child)) return child;
+		}
+		return NodeRef();
+	}
+public:
+	void walk(NodeRef root) {
+		if (pending(root)) deepWalk(root);
+	}
+};
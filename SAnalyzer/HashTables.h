@@ -1,107 +1,162 @@
 #pragma once
 #include <vector>
 #include <unordered_map>
-#include <cstring> // Required for memcmp
 #include "../Parser/AST.h"
 
 
 // in case i forget what this does: this is the symbol table and scope management system for the semantic analyzer AKA id card for every variable and function :)
 struct Symbol {
     StringView name;
-    TokenType type;
+    TypeId type; // an array's holds its element type and length, a function's its return and parameter types
     int stackOffset;
-    bool isArray;
-    int arraySize;
-	int Structsize; // for struct types, to know total size
-	TokenType BaseType; // for arrays, to know what type of elements it holds
-	TokenType returnType; // for functions, to know what type it returns
-    StringView StructType; // for structures
+	int Structsize; // for struct declarations, to know total size (their type is Unknown, a type name isn't a value)
 };
 
-// Equality operator for StringView so the map can verify keys
+// names are interned by the lexer, two identifiers are the same name exactly when their ids match
+// (only meaningful for identifiers, everything else has id NoSymbol)
 inline bool operator==(const StringView& lhs, const StringView& rhs) {
-    if (lhs.size != rhs.size) return false;
-    return std::memcmp(lhs.data, rhs.data, lhs.size) == 0;
+    return lhs.id == rhs.id;
 }
 
-// Custom Hasher for StringView (FNV-1a Algorithm)
-struct StringViewHasher {
-    size_t operator()(const StringView& sv) const {
-        size_t hash = 2166136261u;
-        for (int i = 0; i < sv.size; ++i) {
-            hash ^= static_cast<size_t>(sv.data[i]);
-            hash *= 16777619u;
-        }
-        return hash;
-    }
-};
-
-// vvvvvvv In case i forget: this is a single scope level in the symbol table stack vvvvvvvv
-// Represents a single scope level AKA stuff between {} or global scope 
+// vvvvv in case i forget vvvvv
+// this is where all scopes are managed: one open addressing table for every scope, keyed by symbol id
 // (Global is 0 ex functoin declarations, just functoins code is 1, things like the code in if/while is 2+)
-struct Scope {
-    Scope* parent = nullptr;
-    int level = 0;
+// - a slot holds the innermost symbol with its name, and that symbol knows the one it shadows (the shadow chain)
+// - declarations go on one list in order, which is also the undo log: exit() pops it back to where the scope
+//   started and puts every shadowed symbol back, so entering and leaving a scope allocates nothing and a lookup
+//   is one probe however deep the scopes go
+// - retainScopes(true) keeps the symbols of every scope that gets left, for analysis after the walk
+// - a Symbol* from lookup stays good until the next declare
+// - over(globals, count) puts a stack on top of another one's global scope, which it only reads: a name it
+//   doesn't have itself is looked up there, among the first count symbols (the parallel sema pass, where each
+//   worker's scopes sit on the program's global scope as it was when the function being checked was declared)
+struct ScopeStack {
+    static const uint32_t None = UINT32_MAX;
 
-    // We MUST pass the Hasher here so the map knows how to handle StringView
-    std::unordered_map<StringView, Symbol, StringViewHasher> symbols;
+    struct Entry {
+        Symbol symbol;
+        uint32_t shadowed; // the entry with the same name this one hides, None if it hides nothing
+        int level;
+    };
+    // a scope that was left while retaining, its symbols are retainedSymbols()[first, first + count)
+    struct RetainedScope {
+        int level;
+        int parent;        // the retained scope it was in, -1 for the global scope (never left) or one not retained
+        uint32_t first;
+        uint32_t count;
+    };
 
-    bool declare(const Symbol& sym) {
-        // emplace returns a pair, .second is true if insertion was successful
-        return symbols.emplace(sym.name, sym).second;
-    }
-	// looks for symbol in current scope only
-    Symbol* lookupLocal(StringView name) {
-        auto it = symbols.find(name);
-        return it == symbols.end() ? nullptr : &it->second;
+private:
+    struct Slot {
+        uint32_t id = NoSymbol; // NoSymbol = empty, a name keeps its slot once it has one
+        uint32_t head = None;   // innermost entry with this name, None when none of its scopes are open
+    };
+    struct Mark {
+        uint32_t start; // entries.size() when the scope was entered
+        int retained;   // its RetainedScope, -1 if not retaining
+    };
+    std::vector<Slot> slots; // power of two, at most half full
+    int shift = 24;          // 32 - log2(slots.size())
+    size_t used = 0;
+    std::vector<Entry> entries; // every symbol in an open scope, innermost scope last
+    std::vector<Mark> marks;    // one per open scope, the global scope first
+    size_t declared = 0;
+    ScopeStack* frozen = nullptr; // see over()
+    uint32_t visible = 0;
+    bool retaining = false;
+    std::vector<RetainedScope> retained;
+    std::vector<Symbol> retainedSyms;
+
+    // the slot of id, or the empty one it would go in
+    Slot& find(uint32_t id) {
+        size_t mask = slots.size() - 1;
+        size_t i = (uint32_t)(id * 0x9E3779B1u) >> shift;
+        while (slots[i].id != id && slots[i].id != NoSymbol) i = (i + 1) & mask;
+        return slots[i];
     }
-    // looks for symbol everywhere in scope chain
-    Symbol* lookup(StringView name) {
-        for (Scope* s = this; s; s = s->parent) {
-            if (auto* sym = s->lookupLocal(name))
-                return sym;
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        shift--;
+        for (const Slot& slot : old) {
+            if (slot.id != NoSymbol) find(slot.id) = slot;
         }
-        return nullptr;
     }
-};
 
-// vvvvv in case i forget vvvvv
-// this is where all scopes are managed as a stack but no popping to preserve memory for later analysis
-struct ScopeStack {
-    std::vector<Scope*> allScopes;
-    Scope* currentScope = nullptr;
+public:
+    ScopeStack() : slots(256) {
+        entries.reserve(256);
+        marks.reserve(64);
+    }
 	// add a scope on top of the stack
     void push() {
-        // Create new scope linked to current
-        Scope* newScope = new Scope();
-        newScope->parent = currentScope;
-
-        // Inherit level (Global is 0, first function is 1, etc.)
-        if (currentScope) {
-            newScope->level = currentScope->level + 1;
+        int record = -1;
+        if (retaining) {
+            record = (int)retained.size();
+            retained.push_back({ level() + 1, marks.empty() ? -1 : marks.back().retained, 0, 0 });
         }
-        else {
-            newScope->level = 0;
-        }
-
-        allScopes.push_back(newScope);
-        currentScope = newScope;
+        marks.push_back({ (uint32_t)entries.size(), record });
     }
-	// exit current scope and go back to parent
+	// exit current scope and go back to parent, undoing its declarations
     void exit() {
-        if (currentScope && currentScope->parent) {
-            currentScope = currentScope->parent;
+        if (marks.size() <= 1) return; // We don't exit the Global scope
+        Mark mark = marks.back();
+        marks.pop_back();
+        if (mark.retained >= 0) {
+            RetainedScope& scope = retained[mark.retained];
+            scope.first = (uint32_t)retainedSyms.size();
+            scope.count = (uint32_t)(entries.size() - mark.start);
+            for (size_t i = mark.start; i < entries.size(); i++) retainedSyms.push_back(entries[i].symbol);
+        }
+        while (entries.size() > mark.start) {
+            const Entry& entry = entries.back();
+            find(entry.symbol.name.id).head = entry.shadowed;
+            entries.pop_back();
         }
-        // Note: We don't exit the Global scope (parent == nullptr)
     }
-	// look up symbol in current scope stack
+	// into the current scope, false (and the first one stays) if the name is already declared in it
+    bool declare(const Symbol& sym) {
+        if (sym.name.id == NoSymbol) return false;
+        if ((used + 1) * 2 > slots.size()) grow();
+        Slot& slot = find(sym.name.id);
+        if (slot.id == NoSymbol) {
+            slot.id = sym.name.id;
+            used++;
+        }
+        else if (slot.head != None && entries[slot.head].level == level()) {
+            return false;
+        }
+        entries.push_back({ sym, slot.head, level() });
+        slot.head = (uint32_t)entries.size() - 1;
+        declared++;
+        return true;
+    }
+	// look up symbol in current scope stack, innermost first
     Symbol* lookup(StringView name) {
-        return currentScope ? currentScope->lookup(name) : nullptr;
+        if (name.id == NoSymbol) return nullptr;
+        Slot& slot = find(name.id);
+        if (slot.head != None) return &entries[slot.head].symbol;
+        return frozen ? frozen->global(name.id, visible) : nullptr;
     }
-
-    ~ScopeStack() {
-        for (Scope* s : allScopes) {
-            delete s;
-        }
+    // a symbol of the global scope, nullptr unless it's one of the first count declared (nothing else may be open,
+    // so every entry is a global one and no global hides another)
+    Symbol* global(uint32_t id, uint32_t count) {
+        Slot& slot = find(id);
+        return slot.head < count ? &entries[slot.head].symbol : nullptr;
+    }
+    void over(ScopeStack* globals, uint32_t count) {
+        frozen = globals;
+        visible = count;
     }
+    // symbols in the open scopes, with just the global scope open that's how many it has (what over() takes)
+    uint32_t openSymbols() const { return (uint32_t)entries.size(); }
+    int level() const { return (int)marks.size() - 1; }
+	// every symbol declared so far, in every scope
+    size_t symbolCount() const { return declared; }
+
+    // scopes entered from now on are kept when they're left
+    void retainScopes(bool on) { retaining = on; }
+    bool retainsScopes() const { return retaining; }
+    const std::vector<RetainedScope>& retainedScopes() const { return retained; }
+    const std::vector<Symbol>& retainedSymbols() const { return retainedSyms; }
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+    Parallel semantic analysis
+    a function body only reads the global scope and writes its own scopes, so a big program is checked in two passes:
+    - the global pass walks every top level declaration in order, but for a function it only declares the symbol
+      and notes how many global symbols there are by then (itself included)
+    - then the function bodies are cut into runs of whole functions and each run is checked by a worker SAnalyzer:
+      its own scope stack sitting on the global scope (which nobody writes any more), its own nextOffset and its own
+      copy of the type table. a body sees only the globals and structs declared before its function, so it gets
+      exactly the errors and types the walk gives it
+    - the workers' tables are merged into ours in run order, a worker notes every node it gave one of its own types
+      (a local array mostly) so those get their ids in our table without another walk over the bodies
+    - the errors all come out by top level declaration, each one's in the order they were found: the same output as
+      walk(program), every time
+    - type ids may differ from the ones a serial walk hands out, the types they stand for don't
+    - BaJav mode (assignments retype symbols, globals too), retained scopes, deferred bodies and a struct declared
+      twice (a later one replaces the layout earlier functions saw) keep the walk serial, so does a small program
+*/
+#include "SAnalyzer.h"
+#include "../Support/ThreadPool.h"
+#include "../Support/Trace.h"
+#include <algorithm>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+static const uint32_t minChunkBytes = 256 * 1024;
+
+// a worker starts with no scopes of its own but the global one (empty, its functions were declared for it)
+SAnalyzer::SAnalyzer(SAnalyzer& shared, std::vector<Diagnostic>* out)
+    : types(shared.types), lines(shared.lines), globals(&shared), held(out), freshFrom((TypeId)shared.types.size()) {
+    scopeStack.push();
+}
+
+void SAnalyzer::analyze(ProgramNode* program) {
+    if (!pool || pool->size() < 2 || !analyzeParallel(program)) walk(program);
+}
+
+bool SAnalyzer::analyzeParallel(ProgramNode* program) {
+    if (BaJavMode || scopeStack.retainsScopes() || scopeStack.level() != 0) return false;
+
+    std::vector<FunctionDeclNode*> functions;
+    std::unordered_set<uint32_t> structNames;
+    for (ASTNode* decl : program->declarations) {
+        if (decl->kind == NodeKind::Function) {
+            auto* function = static_cast<FunctionDeclNode*>(decl);
+            if (function->bodyDeferred()) return false; // parsing it is the parser's business, and serial
+            functions.push_back(function);
+        }
+        else if (decl->kind == NodeKind::StructDecl && !structNames.insert(static_cast<StructDeclNode*>(decl)->name.id).second) {
+            return false;
+        }
+    }
+    if (functions.size() < 2) return false;
+
+    // runs of about the same amount of source, a few per thread so one huge function doesn't leave the others idle
+    uint32_t from = functions.front()->offset, span = functions.back()->offset - from;
+    size_t count = std::min<size_t>((size_t)pool->size() * 4, span / minChunkBytes);
+    std::vector<uint32_t> bounds = { 0 };
+    for (size_t k = 1; k < count; k++) {
+        uint32_t at = from + (uint32_t)((uint64_t)span * k / count);
+        auto next = std::lower_bound(functions.begin(), functions.end(), at,
+            [](const FunctionDeclNode* function, uint32_t offset) { return function->offset < offset; });
+        uint32_t index = (uint32_t)(next - functions.begin());
+        if (index > bounds.back()) bounds.push_back(index);
+    }
+    bounds.push_back((uint32_t)functions.size());
+    count = bounds.size() - 1;
+    if (count < 2) return false;
+
+    // the global pass
+    struct Body {
+        FunctionDeclNode* function;
+        uint32_t decl;
+        uint32_t visible; // global symbols it may see
+    };
+    std::vector<Body> bodies;
+    std::vector<Diagnostic> found;
+    std::vector<std::pair<TypeId, uint32_t>> laidOut;
+    held = &found;
+    for (uint32_t i = 0; i < program->declarations.size(); i++) {
+        ASTNode* decl = program->declarations[i];
+        declIndex = i;
+        if (decl->kind == NodeKind::Function) {
+            auto* function = static_cast<FunctionDeclNode*>(decl);
+            declareFunction(function);
+            bodies.push_back({ function, i, scopeStack.openSymbols() });
+            continue;
+        }
+        walk(decl);
+        if (decl->kind == NodeKind::StructDecl) laidOut.push_back({ types.structType(static_cast<StructDeclNode*>(decl)->name.id), i });
+    }
+    held = nullptr;
+    structDecls.assign(types.size(), UINT32_MAX);
+    for (const auto& entry : laidOut) structDecls[entry.first] = entry.second;
+
+    // the bodies
+    TypeId first = (TypeId)types.size();
+    std::vector<std::unique_ptr<SAnalyzer>> workers(count);
+    std::vector<std::vector<Diagnostic>> runFound(count);
+    pool->run(count, [&](size_t k) {
+        workers[k].reset(new SAnalyzer(*this, &runFound[k]));
+        SAnalyzer& worker = *workers[k];
+        for (uint32_t b = bounds[k]; b < bounds[k + 1]; b++) {
+            worker.declIndex = bodies[b].decl;
+            worker.scopeStack.over(&scopeStack, bodies[b].visible);
+            worker.walk(bodies[b].function);
+        }
+    });
+
+    // their types, in run order, and the nodes that have one of them
+    std::vector<TypeId> map;
+    for (size_t k = 0; k < count; k++) {
+        SAnalyzer& worker = *workers[k];
+        types.merge(worker.types, first, map);
+        for (ExpressionNode* node : worker.fresh) node->resolvedType = map[node->resolvedType - first];
+        errors += worker.errors;
+        workerSymbols += worker.scopeStack.symbolCount();
+        found.insert(found.end(), runFound[k].begin(), runFound[k].end());
+    }
+    structDecls.clear();
+
+    std::stable_sort(found.begin(), found.end(), [](const Diagnostic& a, const Diagnostic& b) { return a.decl < b.decl; });
+    for (const Diagnostic& diagnostic : found) print(diagnostic.offset, diagnostic.message);
+    TRACE_LOG(Sema, 1, "checked " << bodies.size() << " function bodies in " << count << " runs");
+    return true;
+}
@@ -11,87 +11,105 @@
 #include <vector>
 #include "../Parser/AST.h"
 #include "SAnalyzer.h"
+#include "../Support/Trace.h"
 #include <iostream>
 #include <string>
+#include <string_view>
 
-// implicit casting
-bool SAnalyzer::isCompatible(TokenType target, TokenType source) {
+template class StackWalker<SAnalyzer>; // the walk loop lives here, next to the resume functions it inlines
+
+// implicit casting (types are interned, the same type is the same id)
+bool SAnalyzer::isCompatible(TypeId target, TypeId source) {
     if (target == source) return true;
-    if (target == TokenType::Integer && source == TokenType::Double) return true;
-    if (target == TokenType::Double && source == TokenType::Integer) return true;
-    return false;
+    return types.isNumber(target) && types.isNumber(source); // int <-> double
+}
+
+// the layout of a struct type, a worker only sees structs declared before the function it's in (like the walk would)
+const StructLayout* SAnalyzer::layoutOf(TypeId type) const {
+    if (!globals) return structLayouts.ofType(type);
+    const StructLayout* layout = globals->structLayouts.ofType(type);
+    return layout && globals->structDecls[type] < declIndex ? layout : nullptr;
 }
 
 // error reporting
-void SAnalyzer::Error(int line, int col, const std::string& message) {
+void SAnalyzer::Error(uint32_t offset, const std::string& message) {
     if (BaJavMode) return;
-    std::cerr << "Semantic Error at [" << line << ":" << col << "]: " << message << std::endl;
+    errors++;
+    if (held) held->push_back({ declIndex, offset, message });
+    else print(offset, message);
+}
+
+void SAnalyzer::print(uint32_t offset, const std::string& message) const {
+    if (lines) {
+        SourceLoc loc = lines->locate(offset);
+        std::cerr << "Semantic Error at [" << loc.line << ":" << loc.column << "]: " << message << std::endl;
+    }
+    else {
+        std::cerr << "Semantic Error at [offset " << offset << "]: " << message << std::endl;
+    }
 }
 
 // basic visit function that goes through every node of program node
-void SAnalyzer::visit(ProgramNode* node) {
-    for (auto* decl : node->declarations) {
-        if (decl) decl->accept(this);
+// (every resume returns the next child to check, nullptr once the node is done, see StackWalker.h)
+ASTNode* SAnalyzer::resume(ProgramNode* node, WalkFrame& frame) {
+    while (frame.step < node->declarations.size()) {
+        ASTNode* decl = node->declarations[frame.step++];
+        if (pending(decl)) return decl;
     }
+    return nullptr;
 }
 
-void SAnalyzer::visit(IfStatementNode* node) {
-    if (node->condition) node->condition->accept(this);
-    if (node->thenBranch) node->thenBranch->accept(this);
-    if (node->elseBranch) node->elseBranch->accept(this);
+ASTNode* SAnalyzer::resume(IfStatementNode* node, WalkFrame& frame) {
+    return next(frame, { node->condition, node->thenBranch, node->elseBranch });
 }
 
-void SAnalyzer::visit(BlockNode* node) {
-    int prevOffset = this->nextOffset;
-    scopeStack.push();
-    for (auto* statement : node->statements) {
-        statement->accept(this);
+ASTNode* SAnalyzer::resume(BlockNode* node, WalkFrame& frame) {
+    if (frame.step == 0) {
+        frame.saved[0] = this->nextOffset;
+        scopeStack.push();
+    }
+    while (frame.step < node->statements.size()) {
+        ASTNode* statement = node->statements[frame.step++];
+        if (pending(statement)) return statement;
     }
     scopeStack.exit();
-    this->nextOffset = prevOffset;
+    this->nextOffset = frame.saved[0];
+    return nullptr;
 }
 
-void SAnalyzer::visit(VarDeclNode* node) {
-    if (node->initializer) node->initializer->accept(this);
+ASTNode* SAnalyzer::resume(VarDeclNode* node, WalkFrame& frame) {
+    if (ASTNode* init = next(frame, { node->initializer })) return init;
 
-    StringView typeNameString = { "", 0 };
     int size = 1;
 
     if (node->type == TokenType::Struct) {
-        typeNameString = node->structTypeName; // "Player"
-        Symbol* def = scopeStack.lookup(node->structTypeName);
-        if (def) size = def->Structsize / 8;
+        Symbol* def = scopeStack.lookup(node->structTypeName); // "Player"
+        if (def) size = (def->Structsize + 7) / 8; // frame slots are 8 bytes, a natural layout can end in between
     }
 
-    Symbol sym = { node->name, node->type, nextOffset, false, 0, size * 8,
-                   TokenType::UNKNOWN, TokenType::UNKNOWN, typeNameString };
+    Symbol sym = { node->name, types.of(node->type, node->structTypeName.id), nextOffset, size * 8 };
 
+    TRACE_LOG(Sema, 2, "var '" << std::string_view(node->name.data, node->name.size) << "' offset " << nextOffset
+        << " scope " << scopeStack.level());
     nextOffset += size;
-    scopeStack.currentScope->declare(sym);
+    scopeStack.declare(sym);
+    return nullptr;
 }
-void SAnalyzer::visit(StructDeclNode* node) {
-    int structTotalSize = 0;
+ASTNode* SAnalyzer::resume(StructDeclNode* node, WalkFrame&) {
+    StructLayout layout(node->name, types.structType(node->name.id));
     for (auto& member : node->members) {
-        if (member.type == TokenType::Struct) {
-            // Use the specific field for the type name
-            Symbol* nestedDef = scopeStack.lookup(member.structTypeName);
-            if (nestedDef) structTotalSize += nestedDef->Structsize;
-            else structTotalSize += 8;
-        }
-        else {
-            structTotalSize += 8;
-        }
+        structLayouts.addMember(layout, member.name, member.type, member.structTypeName, types.of(member.type, member.structTypeName.id));
     }
-    // put into struct registry 
-    // i had a slight design error in parser so had to improvise a little
-    structRegistry[node->name] = node; 
-    Symbol sym = { node->name, TokenType::Struct, 0, false, 0, structTotalSize };
-    scopeStack.currentScope->declare(sym);
+    // the layout is what IRgen sizes allocations and offsets from
+    int structTotalSize = structLayouts.add(std::move(layout)).totalSize;
+    TRACE_LOG(Sema, 1, "struct '" << std::string_view(node->name.data, node->name.size) << "' size " << structTotalSize);
+    Symbol sym = { node->name, TypeTable::Unknown, 0, structTotalSize };
+    scopeStack.declare(sym);
+    return nullptr;
 }
 
-void SAnalyzer::visit(AssignmentNode* node) {
-    node->target->accept(this);
-    node->value->accept(this);
+ASTNode* SAnalyzer::resume(AssignmentNode* node, WalkFrame& frame) {
+    if (ASTNode* child = next(frame, { node->target, node->value })) return child;
 
     StringView targetName = node->target->getName();
     if (targetName.data != nullptr) {
@@ -102,183 +120,186 @@ void SAnalyzer::visit(AssignmentNode* node) {
     }
 
     if (!BaJavMode && !isCompatible(node->target->resolvedType, node->value->resolvedType)) {
-        Error(node->lin, node->col, "Type mismatch in assignment.");
+        Error(node->offset, "Type mismatch in assignment.");
     }
+    // a = b = c: the outer assignment sees the inner one as a value of the target's type
+    resolve(node, node->target->resolvedType);
+    return nullptr;
 }
 
-void SAnalyzer::visit(ArrayDeclNode* node) {
+ASTNode* SAnalyzer::resume(ArrayDeclNode* node, WalkFrame& frame) {
+    while (frame.step < node->initializers.size()) {
+        ASTNode* init = node->initializers[frame.step++];
+        if (pending(init)) return init;
+    }
     int totalElements = node->initializers.size() > 0 ? node->initializers.size() : node->size;
 
-    for (auto* init : node->initializers) if (init) init->accept(this);
-
     // Arrays take up 'totalElements' slots
-    Symbol sym = { node->name, TokenType::List, nextOffset, true, totalElements, totalElements * 8, node->type, TokenType::UNKNOWN };
+    TypeId element = types.of(node->type, node->structTypeName.id);
+    Symbol sym = { node->name, types.arrayOf(element, totalElements), nextOffset, totalElements * 8 };
     nextOffset += totalElements;
 
-    scopeStack.currentScope->declare(sym);
+    scopeStack.declare(sym);
+    return nullptr;
 }
 
-void SAnalyzer::visit(LiteralNode* node) {
-    node->resolvedType = node->type;
+ASTNode* SAnalyzer::resume(LiteralNode* node, WalkFrame&) {
+    resolve(node, types.primitive(node->type));
+    return nullptr;
 }
 
-void SAnalyzer::visit(BinaryOpNode* node) {
-    node->left->accept(this);
-    node->right->accept(this);
+ASTNode* SAnalyzer::resume(BinaryOpNode* node, WalkFrame& frame) {
+    if (ASTNode* child = next(frame, { node->left, node->right })) return child;
 
-    if (node->left->resolvedType == TokenType::Double || node->right->resolvedType == TokenType::Double) {
-        node->resolvedType = TokenType::Double;
+    if (node->left->resolvedType == TypeTable::Double || node->right->resolvedType == TypeTable::Double) {
+        node->resolvedType = TypeTable::Double;
     }
     else {
-        node->resolvedType = TokenType::Integer;
+        node->resolvedType = TypeTable::Integer;
     }
 
     if (!BaJavMode && !isCompatible(node->left->resolvedType, node->right->resolvedType)) {
-        Error(node->lin, node->col, "Incompatible types in binary op.");
+        Error(node->offset, "Incompatible types in binary op.");
     }
+    return nullptr;
 }
 
-void SAnalyzer::visit(VariableExprNode* node) {
+ASTNode* SAnalyzer::resume(VariableExprNode* node, WalkFrame&) {
     Symbol* sym = scopeStack.lookup(node->name);
     if (sym) {
-        node->resolvedType = sym->type;
-        // This 'seeds' the name "Player" into the node for the next dot to find
-        if (sym->type == TokenType::Struct) {
-            node->resolvedStructName = sym->StructType;
-        }
+        // a struct type 'seeds' the blueprint "Player" into the node for the next dot to find
+        resolve(node, sym->type);
     }
     else {
-        node->resolvedType = TokenType::UNKNOWN;
-        if (!BaJavMode) Error(node->lin, node->col, "Undefined variable.");
+        node->resolvedType = TypeTable::Unknown;
+        if (!BaJavMode) Error(node->offset, "Undefined variable.");
     }
+    return nullptr;
 }
-void SAnalyzer::visit(ArrayIndexNode* node) {
-    node->base->accept(this);
-    node->index->accept(this);
-
-    // We get the name of the base variable to check the table
-    Symbol* sym = scopeStack.lookup(node->base->getName());
-    if (sym && sym->isArray) {
-        node->resolvedType = sym->BaseType; // result of list[i] is the BaseType
+ASTNode* SAnalyzer::resume(ArrayIndexNode* node, WalkFrame& frame) {
+    if (ASTNode* child = next(frame, { node->base, node->index })) return child;
+
+    // the base's type says whether it's an array, so grid[i][j] works as well as list[i]
+    if (types.isArray(node->base->resolvedType)) {
+        // result of list[i] is the element type, a struct one so campus[0].ID can find its blueprint
+        resolve(node, types.element(node->base->resolvedType));
     }
     else {
-        node->resolvedType = TokenType::UNKNOWN;
-        if (!BaJavMode) Error(node->lin, node->col, "Base is not an array.");
+        node->resolvedType = TypeTable::Unknown;
+        if (!BaJavMode) Error(node->offset, "Base is not an array.");
     }
 
-    if (!BaJavMode && node->index->resolvedType != TokenType::Integer) {
-        Error(node->lin, node->col, "Array index must be an integer.");
+    if (!BaJavMode && node->index->resolvedType != TypeTable::Integer) {
+        Error(node->offset, "Array index must be an integer.");
     }
+    return nullptr;
 }
 
-void SAnalyzer::visit(MemberAccessNode* node) {
+ASTNode* SAnalyzer::resume(MemberAccessNode* node, WalkFrame& frame) {
     // 1. Visit the left side of dot
-    node->structExpr->accept(this);
-
-    // 2. Get the blueprint name (e.g., "Player")
-    StringView typeToSearch = node->structExpr->resolvedStructName;
-
-    // 3. Look up the blueprint in our registry
-    if (structRegistry.count(typeToSearch)) {
-        StructDeclNode* blueprint = structRegistry[typeToSearch];
-        bool found = false;
-
-        // 4. Search members
-        for (const auto& member : blueprint->members) {
-            // member.name is now a StringView in your StructMember struct
-            if (member.name == node->memberName) {
-                node->resolvedType = member.type;
-
-                // 5. THE FIX: If it's a struct, pass the structTypeName 
-                if (member.type == TokenType::Struct) {
-                    node->resolvedStructName = member.structTypeName;
-                }
-
-                found = true;
-                break;
-            }
-        }
+    if (ASTNode* base = next(frame, { node->structExpr })) return base;
 
-        if (!found && !BaJavMode) {
+    // 2. Look up the blueprint's layout by the base's type (e.g. struct "Player")
+    if (const StructLayout* layout = layoutOf(node->structExpr->resolvedType)) {
+        // 3. One probe for the member, a struct one carries its own type on to the next dot
+        if (const MemberLayout* member = layout->member(node->memberName)) {
+            resolve(node, member->typeId);
+        }
+        else if (!BaJavMode) {
             // Reconstruct string for error message
             std::string mName(node->memberName.data, node->memberName.size);
-            std::string sName(typeToSearch.data, typeToSearch.size);
-            Error(node->lin, node->col, "Member '" + mName + "' not found in struct '" + sName + "'");
+            std::string sName(layout->name.data, layout->name.size);
+            Error(node->offset, "Member '" + mName + "' not found in struct '" + sName + "'");
         }
     }
     else {
-        if (!BaJavMode) Error(node->lin, node->col, "Base is not a struct.");
-        node->resolvedType = TokenType::UNKNOWN;
+        if (!BaJavMode) Error(node->offset, "Base is not a struct.");
+        node->resolvedType = TypeTable::Unknown;
     }
+    return nullptr;
 }
-void SAnalyzer::visit(FunctionDeclNode* node) {
-    // Register function in the current scope (global)
-    Symbol sym = { node->name, TokenType::Function, 0, false, 0, 0, TokenType::UNKNOWN, node->returnType };
-    scopeStack.currentScope->declare(sym);
-
-    // CREATE THE LOCAL SCOPE
-    scopeStack.push();
-    int savedOffset = this->nextOffset;
-    this->nextOffset = 0; // Parameters start at offset 0 in the new frame
-    StringView nameb = { nullptr,0};
-    //STORE PARAMETERS IN THE LOCAL SCOPE
-    for (auto& param : node->parameters) {
-        Symbol paramSym = { param.second, param.first, nextOffset, false, 0 };
-        scopeStack.currentScope->declare(paramSym);
-        if (paramSym.type == TokenType::Struct) {
-
-            nextOffset += paramSym.Structsize;
-        }
-        else {
-            nextOffset += 8;
+// Register function in the current scope (global), its type is the whole signature
+void SAnalyzer::declareFunction(FunctionDeclNode* node) {
+    paramTypes.clear();
+    for (auto& param : node->parameters) paramTypes.push_back(types.of(param.type, param.structTypeName.id));
+    TypeId signature = types.function(types.primitive(node->returnType), paramTypes.data(), (uint32_t)paramTypes.size());
+    Symbol sym = { node->name, signature, 0, 0 };
+    scopeStack.declare(sym);
+}
+
+ASTNode* SAnalyzer::resume(FunctionDeclNode* node, WalkFrame& frame) {
+    if (frame.step == 0) {
+        frame.step = 1;
+        if (!globals) declareFunction(node); // a worker's function was declared by the global pass
+
+        // CREATE THE LOCAL SCOPE
+        scopeStack.push();
+        frame.saved[0] = this->nextOffset;
+        this->nextOffset = 0; // Parameters start at offset 0 in the new frame
+        //STORE PARAMETERS IN THE LOCAL SCOPE
+        for (auto& param : node->parameters) {
+            Symbol paramSym = { param.name, types.of(param.type, param.structTypeName.id), nextOffset, 0 };
+            scopeStack.declare(paramSym);
+            // a struct is passed whole, in as many 8 byte slots as its layout needs
+            const StructLayout* layout = layoutOf(paramSym.type);
+            nextOffset += layout ? (layout->totalSize + 7) / 8 * 8 : 8;
         }
-    }
 
-    if (node->body) {
-        node->body->accept(this);
+        BlockNode* body = node->getBody();
+        if (pending(body)) return body;
     }
+    TRACE_LOG(Sema, 1, "function '" << std::string_view(node->name.data, node->name.size) << "' params " << node->parameters.size());
 
     scopeStack.exit();
-    this->nextOffset = savedOffset;
+    this->nextOffset = frame.saved[0];
+    return nullptr;
 }
 // skibditoilet(x,y);
-void SAnalyzer::visit(FunctionCallNode* node) {
-    if (node->callee) { node->callee->accept(this); }
-
-    for (auto* arg : node->arguments) {
-        if (arg) arg->accept(this);
+ASTNode* SAnalyzer::resume(FunctionCallNode* node, WalkFrame& frame) {
+    // step 0 is the callee, then the arguments
+    if (frame.step == 0) {
+        frame.step = 1;
+        if (pending(node->callee)) return node->callee;
+    }
+    while (frame.step - 1 < node->arguments.size()) {
+        ASTNode* arg = node->arguments[frame.step++ - 1];
+        if (pending(arg)) return arg;
     }
 
     StringView funcName = node->callee->getName();
     Symbol* sym = scopeStack.lookup(funcName);
 
-    if (sym) {
-        node->resolvedType = sym->returnType;
+    if (sym && types.kind(sym->type) == TypeKind::Function) {
+        resolve(node, types.returns(sym->type));
+    }
+    else if (sym) {
+        // a variable or a struct name, there's no return type to go on
+        node->resolvedType = TypeTable::Unknown;
+        if (!BaJavMode) Error(node->offset, "Not a function: " + std::string(funcName.data, funcName.size));
     }
     else {
-        node->resolvedType = TokenType::Integer;
+        node->resolvedType = TypeTable::Integer;
 
         if (!BaJavMode) {
-            Error(node->lin, node->col, "Undefined function: " + std::string(funcName.data, funcName.size));
+            Error(node->offset, "Undefined function: " + std::string(funcName.data ? funcName.data : "", funcName.size));
         }
     }
+    return nullptr;
 }
-void SAnalyzer::visit(ReturnStatementNode* node) { 
-    if (node->value) 
-        node->value->accept(this); 
+ASTNode* SAnalyzer::resume(ReturnStatementNode* node, WalkFrame& frame) { 
+    return next(frame, { node->value }); 
 }
-void SAnalyzer::visit(ExpressionStatementNode* node) { 
-    if (node->expression) 
-        node->expression->accept(this); 
+ASTNode* SAnalyzer::resume(ExpressionStatementNode* node, WalkFrame& frame) { 
+    return next(frame, { node->expression }); 
 }
-void SAnalyzer::visit(WhileStatementNode* node) {
-    if (node->condition) node->condition->accept(this);
-    if (node->body) node->body->accept(this);
+ASTNode* SAnalyzer::resume(WhileStatementNode* node, WalkFrame& frame) {
+    return next(frame, { node->condition, node->body });
 }
 
-void SAnalyzer::visit(UnaryOpNode* node) {
+ASTNode* SAnalyzer::resume(UnaryOpNode* node, WalkFrame& frame) {
+    if (ASTNode* operand = next(frame, { node->expression })) return operand;
     if (node->expression) {
-        node->expression->accept(this);
-        node->resolvedType = node->expression->resolvedType;
+        resolve(node, node->expression->resolvedType);
     }
+    return nullptr;
 }
\ No newline at end of file
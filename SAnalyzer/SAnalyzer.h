@@ -1,37 +1,107 @@
 #pragma once
 #include "../Parser/AST.h"
+#include "../Parser/FlatAST.h"
+#include "../Lexer/SourceLocation.h"
 #include "HashTables.h"
-#include "Visitor.h"
+#include "StructLayout.h"
+#include "StackWalker.h"
+#include "FlatWalker.h"
+#include <string>
+#include <vector>
 
-class SAnalyzer : public Visitor {
-    std::unordered_map<StringView, StructDeclNode*, StringViewHasher> structRegistry;
+class ThreadPool;
+
+// check a program with analyze(ast): it runs on the pool given to useThreadPool when the program is big enough
+// ( ParallelSema.cpp ) and is walk(ast) otherwise. walk (depth bounded by the heap, see StackWalker.h) and
+// ast->accept(&analyzer) still work too, but they're always serial. a flat program is checked by analyze(flat)
+class SAnalyzer final : public StackWalker<SAnalyzer>, public FlatWalker<SAnalyzer> {
+	friend class StackWalker<SAnalyzer>;
+	friend class FlatWalker<SAnalyzer>;
+	using StackWalker<SAnalyzer>::pending;
+	using FlatWalker<SAnalyzer>::pending;
+	using StackWalker<SAnalyzer>::next;
+	using FlatWalker<SAnalyzer>::next;
+    StructLayouts structLayouts; // every struct declared so far, IRgen reads them after the walk
+	TypeTable types; // every type met so far, resolved types and symbols are ids in here
+	std::vector<TypeId> paramTypes; // a function's parameter types on their way into its signature
 	ScopeStack scopeStack; // to manage scopes and symbol tables
 	bool BaJavMode = false; // to track if BaJav mode is on
 	int nextOffset = 0; // to track stack offsets for variables
+	const LineTable* lines = nullptr; // to turn node offsets into line:col for errors
+	int errors = 0; // reported so far
+	FlatAST* flat = nullptr; // the flat program being checked by analyze() ( FlatSema.cpp )
+	ThreadPool* pool = nullptr; // set -> big programs get their function bodies checked on it ( ParallelSema.cpp )
+	// an error held back until the parallel pass is over, then they all come out in the order the walk would've
+	// made them: by top level declaration, and within one in the order they were found
+	struct Diagnostic {
+		uint32_t decl; // its top level declaration
+		uint32_t offset;
+		std::string message;
+	};
+	SAnalyzer* globals = nullptr; // a worker's: the analyzer whose global pass it carries on, read only
+	std::vector<Diagnostic>* held = nullptr; // set -> Error() goes in here and not to cerr
+	uint32_t declIndex = 0; // the top level declaration being checked, for held errors
+	size_t workerSymbols = 0; // declared by the workers of a parallel pass
+	TypeId freshFrom = TypeTable::NoType; // a worker's: its own types start here, the merge may move them
+	std::vector<ExpressionNode*> fresh; // a worker's: the nodes it gave one of its own types
+	std::vector<uint32_t> structDecls; // parallel pass: struct type -> the top level declaration that laid it out
+	SAnalyzer(SAnalyzer& shared, std::vector<Diagnostic>* out); // a worker
+	bool analyzeParallel(ProgramNode* program);
+	void declareFunction(FunctionDeclNode* node); // its symbol, with the whole signature as its type
+	void print(uint32_t offset, const std::string& message) const;
+	const StructLayout* layoutOf(TypeId type) const; // as far as the walk has got
+	// a resolved type that came from a symbol, the table or another node, the fixed ones are set directly
+	void resolve(ExpressionNode* node, TypeId type) {
+		node->resolvedType = type;
+		if (type >= freshFrom) fresh.push_back(node);
+	}
+	NodeRef resume(FlatFrame& frame); // any flat node ( FlatSema.cpp )
+	// one node's share of the walk, see StackWalker.h
+	ASTNode* resume(ProgramNode* node, WalkFrame& frame);
+	ASTNode* resume(BlockNode* node, WalkFrame& frame);
+	ASTNode* resume(IfStatementNode* node, WalkFrame& frame);
+	ASTNode* resume(WhileStatementNode* node, WalkFrame& frame);
+	ASTNode* resume(ReturnStatementNode* node, WalkFrame& frame);
+	ASTNode* resume(FunctionDeclNode* node, WalkFrame& frame);
+	ASTNode* resume(VarDeclNode* node, WalkFrame& frame);
+	ASTNode* resume(StructDeclNode* node, WalkFrame& frame);
+	ASTNode* resume(AssignmentNode* node, WalkFrame& frame);
+	ASTNode* resume(ArrayDeclNode* node, WalkFrame& frame);
+	ASTNode* resume(ExpressionStatementNode* node, WalkFrame& frame);
+	ASTNode* resume(LiteralNode* node, WalkFrame& frame);
+	ASTNode* resume(BinaryOpNode* node, WalkFrame& frame);
+	ASTNode* resume(UnaryOpNode* node, WalkFrame& frame);
+	ASTNode* resume(VariableExprNode* node, WalkFrame& frame);
+	ASTNode* resume(ArrayIndexNode* node, WalkFrame& frame);
+	ASTNode* resume(MemberAccessNode* node, WalkFrame& frame);
+	ASTNode* resume(FunctionCallNode* node, WalkFrame& frame);
 public:
-    SAnalyzer(bool freedom) : BaJavMode(freedom) {
+    using StackWalker<SAnalyzer>::walk;
+    using FlatWalker<SAnalyzer>::walk;
+    SAnalyzer(bool freedom, const LineTable* lineTable = nullptr) : BaJavMode(freedom), lines(lineTable) {
 		scopeStack.push(); // Start with global scope
     }
+    const StructLayouts& getStructLayouts() const { return structLayouts; }
+    const TypeTable& getTypes() const { return types; }
+    // how structs are laid out (see StructLayout.h), call before walking
+    void setLayoutMode(LayoutMode mode) { structLayouts.setMode(mode); }
+    // checks a flat program, same rules as the visitor, results go into the flat AST's side tables
+    void analyze(FlatAST& ast);
+    // checks a whole program like walk(program) does, but on the pool when one is set and the program is big enough:
+    // globals and function signatures first, then function bodies side by side, see ParallelSema.cpp
+    void analyze(ProgramNode* program);
+    // where analyze(ProgramNode*) may check function bodies (nullptr = always serial)
+    void useThreadPool(ThreadPool* threads) { pool = threads; }
     // Redeclaring the "Function of Doom" checklist
-    void Error(int line, int col, const std::string& message);
-    void visit(ProgramNode* node) override;
-    void visit(BlockNode* node) override;
-    void visit(IfStatementNode* node) override;
-    void visit(WhileStatementNode* node) override;
-    void visit(ReturnStatementNode* node) override;
-    void visit(FunctionDeclNode* node) override;
-    void visit(VarDeclNode* node) override;
-    void visit(StructDeclNode* node) override;
-    void visit(AssignmentNode* node) override;
-    void visit(ArrayDeclNode* node) override;
-    void visit(ExpressionStatementNode* node) override;
-    void visit(LiteralNode* node) override;
-    void visit(BinaryOpNode* node) override;
-    void visit(UnaryOpNode* node) override;
-    void visit(VariableExprNode* node) override;
-    void visit(ArrayIndexNode* node) override;
-    void visit(MemberAccessNode* node) override;
-    void visit(FunctionCallNode* node) override;
+    void Error(uint32_t offset, const std::string& message);
+    int errorCount() const { return errors; }
+    size_t symbolCount() const { return scopeStack.symbolCount() + workerSymbols; }
+    // keep the symbols of every scope the walk leaves (off by default, see ScopeStack), call before walking
+    void retainScopes(bool on) { scopeStack.retainScopes(on); }
+    const ScopeStack& scopes() const { return scopeStack; }
     // helper functions
-    bool isCompatible(TokenType target, TokenType source);
-};
\ No newline at end of file
+    bool isCompatible(TypeId target, TypeId source);
+};
+
+extern template class StackWalker<SAnalyzer>; // instantiated in SAnalyzer.cpp
+extern template class FlatWalker<SAnalyzer>; // instantiated in FlatSema.cpp
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+/*
+	StackWalker
+	a walk whose depth is bounded by the heap and not by the thread's stack (a 1M term sum, 1M nested blocks or calls)
+	- a pass writes every visit as resume(XNode*, WalkFrame&): do the work up to the next child and pass it to
+	  pending(), if that says the walker has to take it return it, the node is resumed with the same frame once
+	  the child is done. nullptr = done with the node
+	- pending() visits the child right away with a plain call while the walk is less than nativeDepth deep, so
+	  ordinary code costs about what a recursive visit does. deeper than that the child goes on the walker's own stack
+	- frame.step is how far the node got, frame.saved keeps what it needs across its children (registers, labels)
+	- the work before, between and after children is the same as a recursive visit and happens in the same order
+	- walk(node) can start anywhere, the Visitor overrides start a walk too so accept() still works
+	- resume must not call walk (the frame it got may be a reference into the stack)
+	usage: class Foo final : public StackWalker<Foo> { friend class StackWalker<Foo>; ASTNode* resume(...); ... };
+	       foo.walk(ast);
+	       instantiate it next to the resume functions (template class StackWalker<Foo>; in Foo.cpp, extern in Foo.h)
+	       so pending() and the walk loop can inline them
+*/
+#include "../Parser/AST.h"
+#include "Visitor.h"
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+struct WalkFrame {
+	ASTNode* node;
+	uint32_t step;
+	int saved[3];
+};
+
+template <typename Derived>
+class StackWalker : public Visitor {
+	std::vector<WalkFrame> frames; // the part of a walk that's deeper than nativeDepth, kept so it only grows once
+	unsigned depth = 0;            // children being visited with plain calls right now
+
+	ASTNode* resume(WalkFrame& frame) {
+		Derived* self = static_cast<Derived*>(this);
+		ASTNode* node = frame.node;
+		switch (node->kind) {
+		case NodeKind::Program:      return self->resume(static_cast<ProgramNode*>(node), frame);
+		case NodeKind::Block:        return self->resume(static_cast<BlockNode*>(node), frame);
+		case NodeKind::If:           return self->resume(static_cast<IfStatementNode*>(node), frame);
+		case NodeKind::While:        return self->resume(static_cast<WhileStatementNode*>(node), frame);
+		case NodeKind::Return:       return self->resume(static_cast<ReturnStatementNode*>(node), frame);
+		case NodeKind::Function:     return self->resume(static_cast<FunctionDeclNode*>(node), frame);
+		case NodeKind::VarDecl:      return self->resume(static_cast<VarDeclNode*>(node), frame);
+		case NodeKind::StructDecl:   return self->resume(static_cast<StructDeclNode*>(node), frame);
+		case NodeKind::ArrayDecl:    return self->resume(static_cast<ArrayDeclNode*>(node), frame);
+		case NodeKind::ExprStmt:     return self->resume(static_cast<ExpressionStatementNode*>(node), frame);
+		case NodeKind::Assign:       return self->resume(static_cast<AssignmentNode*>(node), frame);
+		case NodeKind::Literal:      return self->resume(static_cast<LiteralNode*>(node), frame);
+		case NodeKind::Binary:       return self->resume(static_cast<BinaryOpNode*>(node), frame);
+		case NodeKind::Unary:        return self->resume(static_cast<UnaryOpNode*>(node), frame);
+		case NodeKind::Variable:     return self->resume(static_cast<VariableExprNode*>(node), frame);
+		case NodeKind::ArrayIndex:   return self->resume(static_cast<ArrayIndexNode*>(node), frame);
+		case NodeKind::MemberAccess: return self->resume(static_cast<MemberAccessNode*>(node), frame);
+		case NodeKind::Call:         return self->resume(static_cast<FunctionCallNode*>(node), frame);
+		default: return nullptr;
+		}
+	}
+	// the explicit stack: a node is resumed after each child it returns, until it returns nullptr
+	void deepWalk(ASTNode* root) {
+		size_t base = frames.size();
+		if (frames.size() < base + 64) frames.resize(base + 64);
+		WalkFrame* bottom = frames.data() + base;
+		WalkFrame* top = bottom;
+		*top = { root, 0, {} };
+		while (top >= bottom) {
+			ASTNode* child = resume(*top);
+			if (!child) {
+				top--;
+				continue;
+			}
+			if (top + 1 == frames.data() + frames.size()) {
+				size_t at = top - frames.data();
+				frames.resize(frames.size() * 2);
+				bottom = frames.data() + base;
+				top = frames.data() + at;
+			}
+			*++top = { child, 0, {} };
+		}
+		frames.resize(base);
+	}
+protected:
+	// how deep plain calls go before the rest of a subtree moves to the explicit stack, a few hundred bytes each
+	static const unsigned nativeDepth = 512;
+
+	// a child the node wants visited now. while there's room it's visited with a plain call and false comes back,
+	// the node carries on right where it was (that's the fast path, no frame, no second dispatch of the node).
+	// past nativeDepth it's true and the node hands the child to the walker:
+	//     if (pending(child)) return child;
+	bool pending(ASTNode* child) {
+		if (!child) return false;
+		if (depth == nativeDepth) return true;
+		depth++;
+		WalkFrame frame = { child, 0, {} };
+		while (ASTNode* grandchild = resume(frame)) deepWalk(grandchild); // only once nativeDepth was hit below
+		depth--;
+		return false;
+	}
+	// the next of a node's fixed children that has to go to the walker, missing ones (nullptr) are skipped
+	ASTNode* next(WalkFrame& frame, std::initializer_list<ASTNode*> children) {
+		while (frame.step < children.size()) {
+			ASTNode* child = children.begin()[frame.step++];
+			if (pending(child)) return child;
+		}
+		return nullptr;
+	}
+public:
+	void walk(ASTNode* root) {
+		if (pending(root)) deepWalk(root);
+	}
+
+	void visit(ProgramNode* node) override { walk(node); }
+	void visit(BlockNode* node) override { walk(node); }
+	void visit(IfStatementNode* node) override { walk(node); }
+	void visit(WhileStatementNode* node) override { walk(node); }
+	void visit(ReturnStatementNode* node) override { walk(node); }
+	void visit(FunctionDeclNode* node) override { walk(node); }
+	void visit(VarDeclNode* node) override { walk(node); }
+	void visit(StructDeclNode* node) override { walk(node); }
+	void visit(AssignmentNode* node) override { walk(node); }
+	void visit(ArrayDeclNode* node) override { walk(node); }
+	void visit(ExpressionStatementNode* node) override { walk(node); }
+	void visit(LiteralNode* node) override { walk(node); }
+	void visit(BinaryOpNode* node) override { walk(node); }
+	void visit(UnaryOpNode* node) override { walk(node); }
+	void visit(VariableExprNode* node) override { walk(node); }
+	void visit(ArrayIndexNode* node) override { walk(node); }
+	void visit(MemberAccessNode* node) override { walk(node); }
+	void visit(FunctionCallNode* node) override { walk(node); }
+};
@@ -0,0 +1,144 @@
+#include "StructLayout.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+#include <utility>
+
+static int roundUp(int value, int align) {
+    return (value + align - 1) / align * align;
+}
+
+// what a primitive takes with natural layout, ints and doubles are 64 bit all the way through the IR
+static int naturalSize(TokenType type) {
+    switch (type) {
+    case TokenType::Char:
+    case TokenType::Bool:
+        return 1;
+    default:
+        return 8;
+    }
+}
+
+int primitiveSize(LayoutMode mode, TokenType type) {
+    return mode == LayoutMode::Slots ? 8 : naturalSize(type);
+}
+
+int valueSize(LayoutMode mode, TypeId type) {
+    if (type == TypeTable::Char) return primitiveSize(mode, TokenType::Char);
+    if (type == TypeTable::Bool) return primitiveSize(mode, TokenType::Bool);
+    return 8;
+}
+
+void StructLayout::place(LayoutMode mode) {
+    std::vector<uint32_t> order(members.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    if (mode == LayoutMode::Packed) {
+        // every size is a multiple of its alignment, so biggest alignment first leaves no gaps between members
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return members[a].align > members[b].align; });
+    }
+    int offset = 0;
+    align = 1;
+    for (uint32_t i : order) {
+        MemberLayout& m = members[i];
+        offset = roundUp(offset, m.align);
+        m.offset = offset;
+        offset += m.size;
+        align = std::max(align, m.align);
+    }
+    totalSize = roundUp(offset, align);
+
+    uint32_t capacity = 8;
+    while (capacity < members.size() * 2) capacity *= 2;
+    index.assign(capacity, 0);
+    uint32_t mask = capacity - 1;
+    for (uint32_t position = 0; position < members.size(); position++) {
+        uint32_t i = hash(members[position].name.id) & mask;
+        bool duplicate = false;
+        for (; index[i]; i = (i + 1) & mask) {
+            if (members[index[i] - 1].name == members[position].name) {
+                duplicate = true; // the earlier one stays
+                break;
+            }
+        }
+        if (!duplicate) index[i] = position + 1;
+    }
+}
+
+int StructLayout::padding() const {
+    int used = 0;
+    for (const MemberLayout& m : members) used += m.size;
+    return totalSize - used;
+}
+
+void StructLayouts::addMember(StructLayout& layout, StringView name, TokenType type, StringView structType, TypeId typeId) const {
+    int size = 8, align = 8, slots = 8;
+    if (type == TokenType::Struct) {
+        if (const StructLayout* nested = find(structType.id)) {
+            size = nested->totalSize;
+            align = nested->align;
+            slots = nested->slotSize;
+        }
+    }
+    else if (layoutMode != LayoutMode::Slots) {
+        size = align = primitiveSize(type);
+    }
+    layout.members.push_back({ name, type, structType, typeId, 0, size, align });
+    layout.slotSize += slots;
+}
+
+const StructLayout& StructLayouts::add(StructLayout layout) {
+    layout.place(layoutMode);
+    if (layout.type >= byType.size()) byType.resize(layout.type + 1, 0);
+    auto found = byName.find(layout.name.id);
+    if (found != byName.end()) {
+        byType[layout.type] = found->second + 1;
+        layouts[found->second] = std::move(layout);
+        return layouts[found->second];
+    }
+    byName.emplace(layout.name.id, (uint32_t)layouts.size());
+    byType[layout.type] = (uint32_t)layouts.size() + 1;
+    layouts.push_back(std::move(layout));
+    return layouts.back();
+}
+
+void StructLayouts::report(std::ostream& out) const {
+    long long total = 0, slotTotal = 0;
+    out << "--- struct layouts (" << layoutModeName(layoutMode) << ") ---\n";
+    for (const StructLayout& layout : layouts) {
+        int saved = layout.slotSize - layout.totalSize;
+        out << "struct " << std::string_view(layout.name.data, layout.name.size) << ": " << layout.totalSize
+            << " bytes, align " << layout.align << ", padding " << layout.padding() << " (slots " << layout.slotSize
+            << ", saved " << saved;
+        if (layout.slotSize > 0) out << ", " << std::fixed << std::setprecision(1) << 100.0 * saved / layout.slotSize << "%";
+        out << ")\n";
+        for (const MemberLayout& m : layout.members) {
+            out << "    " << std::setw(6) << m.offset << "  " << std::string_view(m.name.data, m.name.size) << " : ";
+            if (m.type == TokenType::Struct) out << std::string_view(m.structType.data, m.structType.size);
+            else out << typeName(m.type);
+            out << " (" << m.size << ")\n";
+        }
+        total += layout.totalSize;
+        slotTotal += layout.slotSize;
+    }
+    out << layouts.size() << " structs, " << total << " bytes (slots " << slotTotal << ", saved " << slotTotal - total << ")\n";
+}
+
+const char* layoutModeName(LayoutMode mode) {
+    switch (mode) {
+    case LayoutMode::Natural: return "natural";
+    case LayoutMode::Packed:  return "packed";
+    default:                  return "slots";
+    }
+}
+
+bool parseLayoutMode(const char* name, LayoutMode& mode) {
+    for (LayoutMode m : { LayoutMode::Slots, LayoutMode::Natural, LayoutMode::Packed }) {
+        if (std::strcmp(name, layoutModeName(m)) == 0) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+#include "../Parser/AST.h"
+#include "HashTables.h"
+
+// vvvvv in case i forget vvvvv
+// what a struct looks like in memory, worked out once when sema meets the declaration and read by sema and IRgen
+// - the mode decides how members are sized and placed (the same for every struct of a program):
+//   Slots gives every primitive 8 bytes in declaration order (what the backend has always assumed),
+//   Natural gives every member its own size and alignment (char/bool 1, int/double 8, a nested struct its own),
+//   Packed is Natural with the members sorted by alignment, biggest first, so nothing pads between them
+// - a struct's size is padded to its alignment so an array of it keeps every element aligned
+// - member(name) is one probe into a small open addressing index by symbol id, so campus[i].botRight.y costs
+//   one probe per dot instead of a scan of the members (and of every nested struct before it)
+// - offsets are fixed when the struct is declared, a nested struct declared again later doesn't move them
+enum class LayoutMode : uint8_t { Slots, Natural, Packed };
+
+// bytes a primitive local, array element or member takes: a slot (8) with Slots, its natural size otherwise
+int primitiveSize(LayoutMode mode, TokenType type);
+// the same for a resolved type, a char or bool by the mode and anything else a slot (structs go by their layout)
+int valueSize(LayoutMode mode, TypeId type);
+
+struct MemberLayout {
+    StringView name;
+    TokenType type;
+    StringView structType; // for Struct members
+    TypeId typeId;         // what sema resolves name to
+    int offset;            // bytes from the start of the struct
+    int size;
+    int align;
+};
+
+struct StructLayout {
+    StringView name;
+    TypeId type = TypeTable::Unknown; // the struct type with this layout
+    int totalSize = 0;
+    int align = 1;
+    int slotSize = 0;                  // what it would take with LayoutMode::Slots, for the layout report
+    std::vector<MemberLayout> members; // declaration order whatever the mode, the offsets say where they went
+
+    StructLayout() = default;
+    StructLayout(StringView structName, TypeId structType) : name(structName), type(structType) {}
+
+    // nullptr if there's no member with that name, with two of the same name the first one wins
+    const MemberLayout* member(StringView memberName) const {
+        if (index.empty()) return nullptr;
+        uint32_t mask = (uint32_t)index.size() - 1;
+        for (uint32_t i = hash(memberName.id) & mask; index[i]; i = (i + 1) & mask) {
+            const MemberLayout& m = members[index[i] - 1];
+            if (m.name == memberName) return &m;
+        }
+        return nullptr;
+    }
+    int padding() const; // bytes that hold no member
+
+private:
+    friend class StructLayouts;
+    std::vector<uint32_t> index; // member position + 1, 0 = empty. a power of two, at most half full
+
+    static uint32_t hash(uint32_t id) { return id * 0x9E3779B1u; }
+    void place(LayoutMode mode); // offsets, size, alignment and the index, once every member is in
+};
+
+// every struct layout by the symbol id of the struct name, a later declaration of a name replaces the earlier one
+class StructLayouts {
+    std::vector<StructLayout> layouts; // in declaration order
+    std::unordered_map<uint32_t, uint32_t> byName; // symbol id -> layouts index
+    std::vector<uint32_t> byType;                  // struct TypeId -> layouts index + 1, 0 = none
+    LayoutMode layoutMode = LayoutMode::Slots;
+
+public:
+    // before any struct is added
+    void setMode(LayoutMode mode) { layoutMode = mode; }
+    LayoutMode mode() const { return layoutMode; }
+
+    // a member of a struct being declared, sized for the mode (a nested struct by its own layout, 8 bytes if
+    // nobody declared it)
+    void addMember(StructLayout& layout, StringView name, TokenType type, StringView structType, TypeId typeId) const;
+    // places the members and keeps the layout
+    const StructLayout& add(StructLayout layout);
+
+    const StructLayout* find(uint32_t name) const {
+        auto found = byName.find(name);
+        return found == byName.end() ? nullptr : &layouts[found->second];
+    }
+    // the layout of a struct type, nullptr for any other type (so a resolved type can be passed straight in)
+    const StructLayout* ofType(TypeId type) const {
+        return type < byType.size() && byType[type] ? &layouts[byType[type] - 1] : nullptr;
+    }
+    // bytes a value of the named struct takes, fallback if nothing by that name was declared
+    int sizeOf(uint32_t name, int fallback = 8) const {
+        const StructLayout* layout = find(name);
+        return layout ? layout->totalSize : fallback;
+    }
+    // primitiveSize and valueSize below in this mode
+    int primitiveSize(TokenType type) const { return ::primitiveSize(layoutMode, type); }
+    int valueSize(TypeId type) const { return ::valueSize(layoutMode, type); }
+    size_t size() const { return layouts.size(); }
+
+    // every struct with its size next to what Slots would have made of it, then the members where they landed
+    void report(std::ostream& out) const;
+};
+
+const char* layoutModeName(LayoutMode mode);
+// "slots", "natural" or "packed", false for anything else
+bool parseLayoutMode(const char* name, LayoutMode& mode);
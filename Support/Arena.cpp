@@ -0,0 +1,37 @@
+#include "Arena.h"
+#include <cstdlib>
+
+void* Arena::grow(size_t size, size_t align) {
+    // header is padded so the data after it starts max aligned
+    const size_t header = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    size_t want = size + align; // room for the round up
+    bool oversized = want > nextBlockSize;
+    size_t blockSize = oversized ? want : nextBlockSize;
+
+    Block* block = (Block*)std::malloc(header + blockSize);
+    if (!block) throw std::bad_alloc();
+    block->prev = head;
+    block->size = blockSize;
+    head = block;
+    reserved += blockSize;
+    blockCount++;
+
+    char* data = (char*)block + header;
+    if (oversized) {
+        // this block is only for this one allocation, keep bumping in the current one
+        used += size;
+        return (void*)(((uintptr_t)data + align - 1) & ~(uintptr_t)(align - 1));
+    }
+    if (nextBlockSize < maxBlockSize) nextBlockSize *= 2;
+    cursor = data;
+    limit = data + blockSize;
+    return allocate(size, align);
+}
+
+Arena::~Arena() {
+    while (head) {
+        Block* prev = head->prev;
+        std::free(head);
+        head = prev;
+    }
+}
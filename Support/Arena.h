@@ -0,0 +1,107 @@
+#pragma once
+/*
+	Arena
+	bump pointer allocator, memory comes out of big blocks and is only given back all at once when the arena dies
+	- allocate() is a pointer bump plus an alignment round up, no per object header and no free list
+	- blocks start at 64 KB and double up to 1 MB, something bigger than a block gets a block of its own
+	- destructors of things made in here never run, so only put stuff in that doesn't own heap memory
+	  (AST nodes keep their lists in ArenaVectors for exactly that reason)
+
+	ArenaVector
+	a vector whose storage lives in an arena, it doesn't own anything so copying one just copies the view
+	growing leaves the old storage behind in the arena, the parser mostly builds lists at their final size anyway
+*/
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Arena {
+	struct Block {
+		Block* prev;
+		size_t size; // usable bytes after the header
+	};
+	Block* head = nullptr;
+	char* cursor = nullptr;
+	char* limit = nullptr;
+	size_t nextBlockSize;
+	size_t used = 0;     // bytes handed out (without alignment padding)
+	size_t reserved = 0; // bytes of all blocks together
+	size_t blockCount = 0;
+
+	void* grow(size_t size, size_t align); // slow path, starts a new block
+public:
+	static const size_t firstBlockSize = 64 * 1024;
+	static const size_t maxBlockSize = 1024 * 1024;
+
+	Arena() : nextBlockSize(firstBlockSize) {}
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	~Arena(); // one free per block
+
+	void* allocate(size_t size, size_t align) {
+		uintptr_t p = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+		if (cursor && p + size <= (uintptr_t)limit) {
+			cursor = (char*)(p + size);
+			used += size;
+			return (void*)p;
+		}
+		return grow(size, align);
+	}
+
+	template <typename T, typename... Args>
+	T* make(Args&&... args) {
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	template <typename T>
+	T* allocateArray(size_t count) {
+		return (T*)allocate(sizeof(T) * count, alignof(T));
+	}
+
+	size_t bytesUsed() const { return used; }
+	size_t bytesReserved() const { return reserved; }
+	size_t blocks() const { return blockCount; }
+};
+
+template <typename T>
+class ArenaVector {
+	static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+	T* items = nullptr;
+	uint32_t count = 0;
+	uint32_t capacity = 0;
+public:
+	ArenaVector() = default;
+	// copies a finished list into the arena, exactly as big as it needs to be
+	ArenaVector(Arena& arena, const std::vector<T>& from) : ArenaVector(arena, from.data(), from.size()) {}
+	ArenaVector(Arena& arena, const T* from, size_t n) {
+		if (n == 0) return;
+		items = arena.allocateArray<T>(n);
+		std::uninitialized_copy(from, from + n, items);
+		count = capacity = (uint32_t)n;
+	}
+
+	void push_back(Arena& arena, const T& value) {
+		if (count == capacity) {
+			uint32_t bigger = capacity ? capacity * 2 : 8;
+			T* moved = arena.allocateArray<T>(bigger);
+			std::uninitialized_copy(items, items + count, moved);
+			items = moved;
+			capacity = bigger;
+		}
+		new (items + count) T(value);
+		count++;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T& operator[](size_t i) { return items[i]; }
+	const T& operator[](size_t i) const { return items[i]; }
+	T* begin() { return items; }
+	T* end() { return items + count; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+};
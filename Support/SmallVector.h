@@ -0,0 +1,93 @@
+#pragma once
+/*
+	SmallVector
+	a vector with room for N elements inside itself, only a list that outgrows that touches the heap
+	- meant for the short lists the parser collects (block statements, parameters, members, initializers)
+	  before they're copied into the arena at their final size, most of them never leave the inline buffer
+	- elements are moved around with memcpy and never destroyed, so T has to be trivially copyable/destructible
+	  (pointers and the small PODs the AST uses)
+	- also the parser's explicit stacks (open blocks, pending operators), shallow ones stay inline
+	- moving one steals a heap buffer, an inline one gets copied
+*/
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename T, size_t N>
+class SmallVector {
+	static_assert(std::is_trivially_copy_constructible<T>::value && std::is_trivially_destructible<T>::value,
+		"SmallVector moves its elements with memcpy");
+	T* items;
+	uint32_t count = 0;
+	uint32_t capacity = N;
+	alignas(T) unsigned char inlineBuffer[N * sizeof(T)];
+
+	bool isInline() const { return items == (const T*)inlineBuffer; }
+	void grow() {
+		uint32_t bigger = capacity * 2;
+		T* moved = (T*)std::malloc(sizeof(T) * bigger);
+		if (!moved) throw std::bad_alloc();
+		std::memcpy((void*)moved, (const void*)items, sizeof(T) * count);
+		if (!isInline()) std::free(items);
+		items = moved;
+		capacity = bigger;
+	}
+	void take(SmallVector& other) {
+		if (other.isInline()) {
+			items = (T*)inlineBuffer;
+			std::memcpy((void*)items, (const void*)other.items, sizeof(T) * other.count);
+		}
+		else {
+			items = other.items; // steal the heap buffer
+			capacity = other.capacity;
+			other.items = (T*)other.inlineBuffer;
+			other.capacity = N;
+		}
+		count = other.count;
+		other.count = 0;
+	}
+public:
+	SmallVector() : items((T*)inlineBuffer) {}
+	SmallVector(const SmallVector&) = delete; // nothing copies these, a copy is almost always a mistake
+	SmallVector& operator=(const SmallVector&) = delete;
+	SmallVector(SmallVector&& other) noexcept : items((T*)inlineBuffer) { take(other); }
+	SmallVector& operator=(SmallVector&& other) noexcept {
+		if (this != &other) {
+			if (!isInline()) std::free(items);
+			capacity = N;
+			take(other);
+		}
+		return *this;
+	}
+	~SmallVector() { if (!isInline()) std::free(items); }
+
+	void push_back(const T& value) {
+		if (count == capacity) grow();
+		new (&items[count++]) T(value);
+	}
+	template <typename... Args>
+	void emplace_back(Args&&... args) {
+		if (count == capacity) grow();
+		new (&items[count++]) T(std::forward<Args>(args)...);
+	}
+	void pop_back() { count--; }
+	void truncate(size_t n) { count = (uint32_t)n; } // shrink to the first n
+	void clear() { count = 0; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	bool onHeap() const { return !isInline(); }
+	T* data() { return items; }
+	const T* data() const { return items; }
+	T& operator[](size_t i) { return items[i]; }
+	const T& operator[](size_t i) const { return items[i]; }
+	T& back() { return items[count - 1]; }
+	T* begin() { return items; }
+	T* end() { return items + count; }
+	const T* begin() const { return items; }
+	const T* end() const { return items + count; }
+};
@@ -0,0 +1,44 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) return; // stopping and nothing left
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        guard.unlock();
+        job();
+        guard.lock();
+        if (--pending == 0) finished.notify_all();
+    }
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    std::unique_lock<std::mutex> guard(lock);
+    for (size_t i = 0; i < count; i++) {
+        jobs.emplace_back([&fn, i] { fn(i); });
+    }
+    pending += count;
+    wake.notify_all();
+    finished.wait(guard, [this] { return pending == 0; });
+}
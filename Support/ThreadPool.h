@@ -0,0 +1,37 @@
+#pragma once
+/*
+	ThreadPool
+	a fixed set of worker threads and one shared job queue, nothing fancy
+	- run(count, fn) calls fn(0) .. fn(count - 1) on the workers and waits until all of them are done
+	- the caller only waits, so a pool of N threads really is N threads working (benchmarks rely on that)
+	- jobs must not throw and must not call run themselves
+*/
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex lock;
+	std::condition_variable wake;     // a job was queued (or we're shutting down)
+	std::condition_variable finished; // a job ran to the end
+	size_t pending = 0;               // queued + running
+	bool stopping = false;
+
+	void workerLoop();
+public:
+	// 0 threads = one per hardware thread
+	explicit ThreadPool(unsigned threads = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	unsigned size() const { return (unsigned)workers.size(); }
+
+	void run(size_t count, const std::function<void(size_t)>& fn);
+};
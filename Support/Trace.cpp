@@ -0,0 +1,106 @@
+#include "Trace.h"
+
+#if LUCIRO_TRACE
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <streambuf>
+
+int Trace::levels[(int)TraceSys::Count] = {};
+
+static const char* sysNames[(int)TraceSys::Count] = { "lexer", "parser", "sema", "irgen" };
+static FILE* traceSink = stderr;
+static std::mutex sinkLock; // threads write their buffers out whole, so lines never get mixed
+
+// fixed size buffer that only touches the sink when it fills up or is flushed
+class TraceBuffer : public std::streambuf {
+    char data[64 * 1024];
+public:
+    std::ostream out;
+    TraceBuffer() : out(this) {
+        setp(data, data + sizeof(data));
+    }
+    ~TraceBuffer() {
+        writeOut();
+    }
+    void writeOut() {
+        size_t used = pptr() - pbase();
+        if (used == 0) return;
+        {
+            std::lock_guard<std::mutex> guard(sinkLock);
+            fwrite(pbase(), 1, used, traceSink);
+            fflush(traceSink);
+        }
+        setp(data, data + sizeof(data));
+    }
+protected:
+    int_type overflow(int_type c) override {
+        writeOut();
+        if (c != traits_type::eof()) {
+            *pptr() = (char)c;
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    int sync() override {
+        writeOut();
+        return 0;
+    }
+};
+
+static TraceBuffer& threadBuffer() {
+    thread_local TraceBuffer buffer;
+    return buffer;
+}
+
+void Trace::setLevel(TraceSys sys, int level) {
+    levels[(int)sys] = level;
+}
+
+void Trace::configure(const char* spec) {
+    if (!spec) return;
+    while (*spec) {
+        const char* end = spec;
+        while (*end && *end != ',') end++;
+        const char* eq = spec;
+        while (eq < end && *eq != '=') eq++;
+        size_t nameLen = eq - spec;
+        int level = eq < end ? std::atoi(eq + 1) : 1;
+
+        bool all = nameLen == 3 && std::strncmp(spec, "all", 3) == 0;
+        for (int i = 0; i < (int)TraceSys::Count; i++) {
+            if (all || (std::strlen(sysNames[i]) == nameLen && std::strncmp(spec, sysNames[i], nameLen) == 0)) {
+                levels[i] = level;
+            }
+        }
+        spec = *end ? end + 1 : end;
+    }
+}
+
+void Trace::setSink(FILE* file) {
+    flush();
+    std::lock_guard<std::mutex> guard(sinkLock);
+    traceSink = file ? file : stderr;
+}
+
+std::ostream& Trace::begin(TraceSys sys) {
+    std::ostream& out = threadBuffer().out;
+    out << '[' << sysNames[(int)sys] << "] ";
+    return out;
+}
+
+void Trace::end() {
+    threadBuffer().out << '\n';
+}
+
+void Trace::flush() {
+    threadBuffer().writeOut();
+}
+
+// pick up LUCIRO_TRACE from the environment before main runs
+static struct TraceEnvInit {
+    TraceEnvInit() { Trace::configure(std::getenv("LUCIRO_TRACE")); }
+} traceEnvInit;
+
+#endif
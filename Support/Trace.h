@@ -0,0 +1,79 @@
+#pragma once
+/*
+	Debug tracing for the compiler phases
+	- every phase (lexer/parser/sema/irgen) has its own level, 0 = off, higher = chattier
+	- levels are set at runtime with Trace::setLevel / Trace::configure or the LUCIRO_TRACE environment variable
+	  e.g.  LUCIRO_TRACE=lexer=2,irgen=1   or   LUCIRO_TRACE=all=3
+	- output goes into a per thread buffer that is written out in big pieces, never a flush per line
+	- release builds (NDEBUG) compile every TRACE_LOG away completely, arguments are not even evaluated
+	  define LUCIRO_TRACE=1 to keep tracing in an optimized build, or LUCIRO_TRACE=0 to drop it from a debug one
+
+	usage:
+		TRACE_LOG(Lexer, 2, "word='" << word << "'");
+		if (TRACE_ON(IRgen, 3)) { ...build something expensive to print... }
+*/
+#include <cstdio>
+#include <ostream>
+
+#ifndef LUCIRO_TRACE
+#ifdef NDEBUG
+#define LUCIRO_TRACE 0
+#else
+#define LUCIRO_TRACE 1
+#endif
+#endif
+
+enum class TraceSys {
+	Lexer,
+	Parser,
+	Sema,
+	IRgen,
+	Count
+};
+
+#if LUCIRO_TRACE
+
+class Trace {
+	static int levels[(int)TraceSys::Count];
+public:
+	static bool enabled(TraceSys sys, int level) {
+		return levels[(int)sys] >= level;
+	}
+	static void setLevel(TraceSys sys, int level);
+	// "lexer=2,parser=1,sema=0,irgen=3" or "all=2", a name without a level means level 1
+	static void configure(const char* spec);
+	// where flushed output goes (stderr by default)
+	static void setSink(FILE* file);
+	// start a line for sys, the caller streams the message and TRACE_LOG ends it
+	static std::ostream& begin(TraceSys sys);
+	static void end();
+	// write out everything this thread has buffered
+	static void flush();
+};
+
+#define TRACE_ON(sys, level) (Trace::enabled(TraceSys::sys, level))
+#define TRACE_LOG(sys, level, msg) \
+	do { if (TRACE_ON(sys, level)) { Trace::begin(TraceSys::sys) << msg; Trace::end(); } } while (0)
+
+#else
+
+// tracing compiled out: same API so callers don't need #ifs, everything folds to nothing
+class Trace {
+public:
+	static constexpr bool enabled(TraceSys, int) { return false; }
+	static void setLevel(TraceSys, int) {}
+	static void configure(const char*) {}
+	static void setSink(FILE*) {}
+	// only reachable from inside a dead "if (TRACE_ON(...))" block
+	static std::ostream& begin(TraceSys) {
+		static std::ostream nowhere(nullptr);
+		return nowhere;
+	}
+	static void end() {}
+	static void flush() {}
+};
+
+#define TRACE_ON(sys, level) (false)
+#define TRACE_LOG(sys, level, msg) do { } while (0)
+
+#endif